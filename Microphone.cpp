@@ -0,0 +1,84 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Microphone.h"
+
+Microphone::Microphone(PinName pin)
+{
+    analogin_init(&_adc, pin);
+    _fill = 0;
+    _pos = 0;
+    _full = false;
+    _overruns = 0;
+}
+/*
+ *  Start Sampling
+ *  Ready is called from interrupt context with each full block
+ */
+void Microphone::start(uint32_t rate_hz, const Callback<void()> &ready)
+{
+    _ready = ready;
+    _pos = 0;
+    _full = false;
+    _ticker.attach_us(callback(this, &Microphone::sample), 1000000 / rate_hz);
+}
+/*
+ *  Stop Sampling
+ */
+void Microphone::stop(void)
+{
+    _ticker.detach();
+}
+/*
+ *  Full Block
+ *  Stays valid until release() is called
+ */
+const int16_t *Microphone::block(void)
+{
+    if(!_full) {
+        return NULL;
+    }
+    return _buf[_fill ^ 1];
+}
+/*
+ *  Release Block
+ *  Hands the buffer of the last full block back to the interrupt
+ */
+void Microphone::release(void)
+{
+    _full = false;
+}
+/*
+ *  Sample
+ *  Ticker interrupt, converts one sample
+ */
+void Microphone::sample(void)
+{
+    _buf[_fill][_pos++] = (int16_t)(analogin_read_u16(&_adc) - 0x8000);
+    if(_pos < MIC_BLOCK_SAMPLES) {
+        return;
+    }
+
+    _pos = 0;
+    if(_full) {
+        // the previous block is still in use, refill the same buffer
+        _overruns++;
+        return;
+    }
+    _fill ^= 1;
+    _full = true;
+    _ready();
+}
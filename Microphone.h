@@ -0,0 +1,64 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MICROPHONE_H
+#define MICROPHONE_H
+
+#include "mbed.h"
+
+// samples per block, 32 ms at 8 kHz
+#define MIC_BLOCK_SAMPLES   (256)
+
+/*
+ *  Analog microphone sampled by a timer
+ *
+ *  A Ticker interrupt converts one sample at a time into one of two
+ *  buffers.  Once a buffer is full the interrupt switches to the other
+ *  one and calls the ready callback, still in interrupt context, which
+ *  should defer the processing of the full block.  A block has to be
+ *  released before the next one fills up, otherwise the next one is
+ *  dropped and counted as an overrun.
+ *
+ *  The conversion goes through the analogin HAL directly, as AnalogIn
+ *  takes a mutex, which can't be done from an interrupt.  Samples are
+ *  signed, with mid-scale of the ADC at 0.
+ */
+class Microphone
+{
+    public:
+    Microphone(PinName pin);
+    void start(uint32_t rate_hz, const Callback<void()> &ready);
+    void stop(void);
+    // the last full block, or NULL if there is none to process
+    const int16_t *block(void);
+    void release(void);
+    uint32_t overruns(void) const { return _overruns; }
+
+    protected:
+    analogin_t                  _adc;
+    Ticker                      _ticker;
+    Callback<void()>            _ready;
+    int16_t                     _buf[2][MIC_BLOCK_SAMPLES];
+    // buffer being filled by the interrupt
+    volatile uint8_t            _fill;
+    volatile uint16_t           _pos;
+    // set while the other buffer holds a block that hasn't been released
+    volatile bool               _full;
+    volatile uint32_t           _overruns;
+    void                        sample(void);
+};
+
+#endif
@@ -0,0 +1,117 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SHT3x.h"
+
+SHT3x::SHT3x (I2C& sht3x_i2c, uint8_t sht3x_addr):
+    _i2c(sht3x_i2c), _addr(sht3x_addr<<1)
+{
+    temperature = 0.0f;
+    humidity = 0.0f;
+    _cmd[0] = SHT3X_CMD_FETCH_DATA >> 8;
+    _cmd[1] = SHT3X_CMD_FETCH_DATA & 0xFF;
+}
+/*
+ *  Send Command
+ */
+bool SHT3x::command(uint16_t cmd)
+{
+    char write[] = {(char)(cmd >> 8), (char)(cmd & 0xFF)};
+    return _i2c.write(_addr, write, 2, 0) == 0;
+}
+/*
+ *  Initialize SHT3x
+ *  Resets the sensor and starts periodic measurements
+ */
+bool SHT3x::init(void)
+{
+    // a soft reset is ignored while in periodic mode
+    command(SHT3X_CMD_BREAK);
+    wait_ms(1);
+    if(!command(SHT3X_CMD_SOFT_RESET)) {
+        return false;
+    }
+    wait_ms(2);
+    return command(SHT3X_CMD_PERIODIC_1MPS);
+}
+/*
+ *  CRC-8
+ *  Polynomial 0x31, initialized to 0xFF, as in the datasheet
+ */
+uint8_t SHT3x::crc8(const char *data, int len)
+{
+    uint8_t crc = SHT3X_CRC_INIT;
+    for(int i = 0; i < len; i++) {
+        crc ^= (uint8_t)data[i];
+        for(int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ SHT3X_CRC_POLY) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+/*
+ *  Parse Measurement
+ */
+bool SHT3x::parse(void)
+{
+    uint16_t raw_t, raw_h;
+    if(crc8(&_data[0], 2) != (uint8_t)_data[2] ||
+       crc8(&_data[3], 2) != (uint8_t)_data[5]) {
+        return false;
+    }
+    raw_t = ((uint8_t)_data[0]<<8)|(uint8_t)_data[1];
+    raw_h = ((uint8_t)_data[3]<<8)|(uint8_t)_data[4];
+    temperature = -45.0f + 175.0f * raw_t / 65535.0f;
+    humidity = 100.0f * raw_h / 65535.0f;
+    return true;
+}
+/*
+ *  Read Measurement
+ *  Fetches the last measurement in one write-then-repeated-start read
+ */
+bool SHT3x::read(void)
+{
+    if(_i2c.write(_addr, _cmd, 2, true) != 0 ||
+       _i2c.read(_addr, _data, sizeof(_data), false) != 0) {
+        return false;
+    }
+    return parse();
+}
+#if DEVICE_I2C_ASYNCH
+/*
+ *  Start Read
+ *  Same transfer as read(), but returns straight away.  The callback is
+ *  called from interrupt context once the transfer is done, after which
+ *  finishRead() parses the result.
+ */
+int SHT3x::startRead(const event_callback_t &callback)
+{
+    return _i2c.transfer(_addr, _cmd, 2, _data, sizeof(_data),
+                         callback, I2C_EVENT_ALL, false);
+}
+/*
+ *  Finish Read
+ *  Takes the event passed to the startRead() callback
+ */
+bool SHT3x::finishRead(int event)
+{
+    if(!(event & I2C_EVENT_TRANSFER_COMPLETE) ||
+       (event & (I2C_EVENT_ERROR|I2C_EVENT_ERROR_NO_SLAVE|I2C_EVENT_TRANSFER_EARLY_NACK))) {
+        return false;
+    }
+    return parse();
+}
+#endif
@@ -0,0 +1,66 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SHT3X_H
+#define SHT3X_H
+
+#include "mbed.h"
+
+#define SHT3X_ADDR          (0x44)
+
+// commands, sent MSB first
+#define SHT3X_CMD_SOFT_RESET    (0x30A2)
+#define SHT3X_CMD_BREAK         (0x3093)
+// periodic mode, 1 measurement per second, high repeatability
+#define SHT3X_CMD_PERIODIC_1MPS (0x2130)
+#define SHT3X_CMD_FETCH_DATA    (0xE000)
+
+#define SHT3X_CRC_POLY      (0x31)
+#define SHT3X_CRC_INIT      (0xFF)
+
+/*
+ *  Sensirion SHT3x temperature and humidity sensor
+ *
+ *  The sensor runs in periodic mode, so a reading is the last completed
+ *  measurement, fetched in one write-then-repeated-start read.  The sensor
+ *  NACKs a fetch when there is no new measurement since the last one.
+ */
+class SHT3x
+{
+    public:
+    SHT3x(I2C& sht3x_i2c, uint8_t sht3x_addr=SHT3X_ADDR);
+    bool init(void);
+    bool read(void);
+#if DEVICE_I2C_ASYNCH
+    int startRead(const event_callback_t &callback);
+    bool finishRead(int event);
+#endif
+    // degrees Celsius and percent relative humidity of the last read
+    float                       temperature;
+    float                       humidity;
+
+    protected:
+    I2C                         &_i2c;
+    uint8_t                     _addr;
+    char                        _cmd[2];
+    // temperature, humidity, each 2 bytes and a CRC
+    char                        _data[6];
+    bool                        command(uint16_t cmd);
+    bool                        parse(void);
+    static uint8_t              crc8(const char *data, int len);
+};
+
+#endif
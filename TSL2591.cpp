@@ -20,6 +20,8 @@ TSL2591::TSL2591 (I2C& tsl2591_i2c, uint8_t tsl2591_addr):
     _i2c(tsl2591_i2c), _addr(tsl2591_addr<<1)
 {
     _init = false;
+    _enabled = false;
+    _cmd = TSL2591_CMD_BIT|TSL2591_REG_STATUS;
     _integ = TSL2591_INTT_100MS;
     _gain = TSL2591_GAIN_LOW;
 }
@@ -45,11 +47,13 @@ bool TSL2591::init(void)
 }
 /*
  *  Power On TSL2591
+ *  The ALS integrates continuously until disabled
  */
 void TSL2591::enable(void)
 {
     char write[] = {(TSL2591_CMD_BIT|TSL2591_REG_ENABLE), (TSL2591_EN_PON|TSL2591_EN_AEN|TSL2591_EN_AIEN|TSL2591_EN_NPIEN)};
     _i2c.write(_addr, write, 2, 0);
+    _enabled = true;
 }
 /*
  *  Power Off TSL2591
@@ -58,6 +62,7 @@ void TSL2591::disable(void)
 {
     char write[] = {(TSL2591_CMD_BIT|TSL2591_REG_ENABLE), (TSL2591_EN_POFF)};
     _i2c.write(_addr, write, 2, 0);
+    _enabled = false;
 }
 /*
  *  Set Gain and Write
@@ -65,11 +70,14 @@ void TSL2591::disable(void)
  */
 void TSL2591::setGain(tsl2591Gain_t gain)
 {
+    bool enabled = _enabled;
     enable();
     _gain = gain;
     char write[] = {(TSL2591_CMD_BIT|TSL2591_REG_CONTROL), (char)(_integ|_gain)};
     _i2c.write(_addr, write, 2, 0);
-    disable();
+    if(!enabled) {
+        disable();
+    }
 }
 /*
  *  Set Integration Time and Write
@@ -77,89 +85,108 @@ void TSL2591::setGain(tsl2591Gain_t gain)
  */
 void TSL2591::setTime(tsl2591IntegrationTime_t integ)
 {
+    bool enabled = _enabled;
     enable();
     _integ = integ;
     char write[] = {(TSL2591_CMD_BIT|TSL2591_REG_CONTROL), (char)(_integ|_gain)};
     _i2c.write(_addr, write, 2, 0);
-    disable();
+    if(!enabled) {
+        disable();
+    }
 }
 /*
- *  Read ALS
- *  Read full spectrum, infrared, and visible
+ *  Parse ALS
+ *  Status and both channels, as read from the status register on
+ *  Returns false until the first integration after enable() has completed
  */
-void TSL2591::getALS(void)
+bool TSL2591::parseALS(void)
 {
-    enable();
-    for(uint8_t t=0; t<=_integ+1; t++) {
-        wait(0.12);
+    if(!(_data[0] & TSL2591_STATUS_AVALID)) {
+        return false;
     }
-    char write1[] = {(TSL2591_CMD_BIT|TSL2591_REG_CHAN1_L)};
-    _i2c.write(_addr, write1, 1, 0);
-    char read1[2];
-    _i2c.read(_addr, read1, 2, 0);
-    char write2[] = {(TSL2591_CMD_BIT|TSL2591_REG_CHAN0_L)};
-    _i2c.write(_addr, write2, 1, 0);
-    char read2[2];
-    _i2c.read(_addr, read2, 2, 0);
-    rawALS = (((read1[1]<<8)|read1[0])<<16)|((read2[1]<<8)|read2[0]);
-    disable();
-    full = rawALS & 0xFFFF;
-    ir = rawALS >> 16;
+    full = ((uint8_t)_data[2]<<8)|(uint8_t)_data[1];
+    ir = ((uint8_t)_data[4]<<8)|(uint8_t)_data[3];
+    rawALS = ((uint32_t)ir<<16)|full;
     visible = full - ir;
+    return true;
+}
+/*
+ *  Read ALS
+ *  Read full spectrum, infrared, and visible of the last completed
+ *  integration in one write-then-repeated-start read, without waiting
+ */
+bool TSL2591::getALS(void)
+{
+    if(_i2c.write(_addr, &_cmd, 1, true) != 0 ||
+       _i2c.read(_addr, _data, sizeof(_data), false) != 0) {
+        return false;
+    }
+    return parseALS();
+}
+#if DEVICE_I2C_ASYNCH
+/*
+ *  Start ALS Read
+ *  Same transfer as getALS(), but returns straight away.  The callback is
+ *  called from interrupt context once the transfer is done, after which
+ *  finishALS() parses the result.
+ */
+int TSL2591::startALS(const event_callback_t &callback)
+{
+    return _i2c.transfer(_addr, &_cmd, 1, _data, sizeof(_data),
+                         callback, I2C_EVENT_ALL, false);
 }
+/*
+ *  Finish ALS Read
+ *  Takes the event passed to the startALS() callback
+ */
+bool TSL2591::finishALS(int event)
+{
+    if(!(event & I2C_EVENT_TRANSFER_COMPLETE) ||
+       (event & (I2C_EVENT_ERROR|I2C_EVENT_ERROR_NO_SLAVE|I2C_EVENT_TRANSFER_EARLY_NACK))) {
+        return false;
+    }
+    return parseALS();
+}
+#endif
+/*
+ *  Lux per count for each gain (rows) and integration time (columns),
+ *  as 2^32 * TSL2591_LUX_DF / (100 * atime * again).  The extra factor of
+ *  100 is taken out by the channel coefficients, which are scaled by 100.
+ */
+static const uint32_t lux_per_count[4][6] = {
+    /* TSL2591_GAIN_LOW,  again = 1 */
+    {175234666U, 87617333U, 58411555U, 43808666U, 35046933U, 29205778U},
+    /* TSL2591_GAIN_MED,  again = 25 */
+    {7009387U, 3504693U, 2336462U, 1752347U, 1401877U, 1168231U},
+    /* TSL2591_GAIN_HIGH, again = 428 */
+    {409427U, 204713U, 136476U, 102357U, 81885U, 68238U},
+    /* TSL2591_GAIN_MAX,  again = 9876 */
+    {17743U, 8872U, 5914U, 4436U, 3549U, 2957U},
+};
 /*
  *  Calculate Lux
+ *  Integer only, within 1 lux of the floating point formula
  */
 void TSL2591::calcLux(void)
 {
-    float atime, again, cpl, lux1, lux2, lux3;
+    int32_t lux1, lux2;
+    uint32_t k;
     if((full == 0xFFFF)|(ir == 0xFFFF)) {
-        lux3 = 0;
         return;
     }
-    switch(_integ) {
-        case TSL2591_INTT_100MS:
-            atime = 100.0F;
-            break;
-        case TSL2591_INTT_200MS:
-            atime = 200.0F;
-            break;
-        case TSL2591_INTT_300MS:
-            atime = 300.0F;
-            break;
-        case TSL2591_INTT_400MS:
-            atime = 400.0F;
-            break;
-        case TSL2591_INTT_500MS:
-            atime = 500.0F;
-            break;
-        case TSL2591_INTT_600MS:
-            atime = 600.0F;
-            break;
-        default:
-            atime = 100.0F;
-            break;
+    if(_gain > TSL2591_GAIN_MAX || _integ > TSL2591_INTT_600MS) {
+        k = lux_per_count[TSL2591_GAIN_LOW][TSL2591_INTT_100MS];
+    } else {
+        k = lux_per_count[_gain][_integ];
     }
-    switch(_gain) {
-        case TSL2591_GAIN_LOW:
-            again = 1.0F;
-            break;
-        case TSL2591_GAIN_MED:
-            again = 25.0F;
-            break;
-        case TSL2591_GAIN_HIGH:
-            again = 428.0F;
-            break;
-        case TSL2591_GAIN_MAX:
-            again = 9876.0F;
-            break;
-        default:
-            again = 1.0F;
-            break;
+    lux1 = (TSL2591_LUX_FULL_X100 * (int32_t)full) -
+           (TSL2591_LUX_COEFB_X100 * (int32_t)ir);
+    lux2 = (TSL2591_LUX_COEFC_X100 * (int32_t)full) -
+           (TSL2591_LUX_COEFD_X100 * (int32_t)ir);
+    lux1 = lux1 > lux2 ? lux1 : lux2;
+    if(lux1 <= 0) {
+        lux = 0;
+        return;
     }
-    cpl = (atime * again) / TSL2591_LUX_DF;
-    lux1 = ((float)full - (TSL2591_LUX_COEFB * (float)ir)) / cpl;
-    lux2 = (( TSL2591_LUX_COEFC * (float)full ) - ( TSL2591_LUX_COEFD * (float)ir)) / cpl;
-    lux3 = lux1 > lux2 ? lux1 : lux2;
-    lux = (uint32_t)lux3;
+    lux = (uint32_t)(((uint64_t)lux1 * k) >> 32);
 }
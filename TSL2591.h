@@ -31,11 +31,19 @@
 #define TSL2591_EN_PON      (0x01)
 #define TSL2591_EN_POFF     (0x00)
 
+#define TSL2591_STATUS_AVALID (0x01)
+
 #define TSL2591_LUX_DF      (408.0F)
 #define TSL2591_LUX_COEFB   (1.64F)  // CH0 coefficient 
 #define TSL2591_LUX_COEFC   (0.59F)  // CH1 coefficient A
 #define TSL2591_LUX_COEFD   (0.86F)  // CH2 coefficient B
 
+// the coefficients above scaled by 100, used by calcLux()
+#define TSL2591_LUX_FULL_X100       (100)
+#define TSL2591_LUX_COEFB_X100      (164)
+#define TSL2591_LUX_COEFC_X100      (59)
+#define TSL2591_LUX_COEFD_X100      (86)
+
 enum {
     TSL2591_REG_ENABLE          = 0x00,
     TSL2591_REG_CONTROL         = 0x01,
@@ -101,7 +109,11 @@ class TSL2591
     void disable(void);
     void setGain(tsl2591Gain_t gain);
     void setTime(tsl2591IntegrationTime_t integ);
-    void getALS(void);
+    bool getALS(void);
+#if DEVICE_I2C_ASYNCH
+    int startALS(const event_callback_t &callback);
+    bool finishALS(int event);
+#endif
     void calcLux(void);
     volatile uint32_t           rawALS;
     volatile uint16_t           ir;
@@ -113,6 +125,11 @@ class TSL2591
     I2C                         &_i2c;
     uint8_t                     _addr;
     bool                        _init;
+    bool                        _enabled;
+    // status and both channels, read in one transfer
+    char                        _cmd;
+    char                        _data[5];
+    bool                        parseALS(void);
     tsl2591Gain_t               _gain;
     tsl2591IntegrationTime_t    _integ;
 };
@@ -0,0 +1,111 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "calibration.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+void calibration_identity(struct calibration *cal)
+{
+    memset(cal, 0, sizeof(*cal));
+    cal->segments = 1;
+    cal->slope[0] = 1.0f;
+    cal->offset[0] = 0.0f;
+}
+
+int calibration_parse(struct calibration *cal, const char *str)
+{
+    char *end;
+    int count = 0;
+    float x[CALIBRATION_MAX_POINTS];
+    float y[CALIBRATION_MAX_POINTS];
+    struct calibration tmp;
+
+    /* a single number is a gain */
+    x[0] = strtof(str, &end);
+    if (end != str && '\0' == *end) {
+        if (!isfinite(x[0])) {
+            return -1;
+        }
+        memset(&tmp, 0, sizeof(tmp));
+        tmp.segments = 1;
+        tmp.slope[0] = x[0];
+        tmp.offset[0] = 0.0f;
+        *cal = tmp;
+        return 0;
+    }
+
+    while ('\0' != *str) {
+        if (count == CALIBRATION_MAX_POINTS) {
+            return -1;
+        }
+
+        x[count] = strtof(str, &end);
+        if (end == str || ':' != *end) {
+            return -1;
+        }
+        str = end + 1;
+
+        y[count] = strtof(str, &end);
+        if (end == str || (',' != *end && '\0' != *end)) {
+            return -1;
+        }
+        str = ',' == *end ? end + 1 : end;
+
+        /* strtof() takes "nan" and "inf", which would pass the order check */
+        if (!isfinite(x[count]) || !isfinite(y[count])) {
+            return -1;
+        }
+        if (count > 0 && x[count] <= x[count - 1]) {
+            return -1;
+        }
+        count++;
+    }
+
+    if (count < 2) {
+        return -1;
+    }
+
+    memset(&tmp, 0, sizeof(tmp));
+    tmp.segments = count - 1;
+    for (int i = 0; i < tmp.segments; i++) {
+        tmp.slope[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]);
+        tmp.offset[i] = y[i] - tmp.slope[i] * x[i];
+        /* points too close together for a float slope */
+        if (!isfinite(tmp.slope[i]) || !isfinite(tmp.offset[i])) {
+            return -1;
+        }
+        if (i > 0) {
+            tmp.bound[i - 1] = x[i];
+        }
+    }
+    *cal = tmp;
+
+    return 0;
+}
+
+float calibration_apply(const struct calibration *cal, float raw)
+{
+    uint8_t i = 0;
+
+    while (i + 1 < cal->segments && raw >= cal->bound[i]) {
+        i++;
+    }
+
+    return cal->offset[i] + cal->slope[i] * raw;
+}
@@ -0,0 +1,54 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdint.h>
+
+/* maximum number of points in a calibration table */
+#define CALIBRATION_MAX_POINTS 8
+
+/*
+ * Piecewise-linear calibration of a raw sensor reading.
+ *
+ * A table is written as comma separated raw:calibrated pairs with
+ * increasing raw values, e.g. "0:-1.5,20:19.2,40:40.1".  Readings outside
+ * the table are extrapolated from the first or last segment.  A single
+ * number is shorthand for a plain gain, so "0.68" is the same as "0:0,1:0.68".
+ *
+ * The slope and offset of every segment are computed when the table is
+ * parsed, so applying it costs a short scan of the segment bounds and one
+ * multiply-add.
+ */
+struct calibration {
+    uint8_t segments;
+    /* raw value at which each segment after the first starts */
+    float bound[CALIBRATION_MAX_POINTS - 2];
+    float slope[CALIBRATION_MAX_POINTS - 1];
+    float offset[CALIBRATION_MAX_POINTS - 1];
+};
+
+/* sets a calibration that returns readings unchanged */
+void calibration_identity(struct calibration *cal);
+
+/* parses a table, returns 0 on success.  cal is unchanged on failure. */
+int calibration_parse(struct calibration *cal, const char *str);
+
+/* returns the calibrated value of a raw reading */
+float calibration_apply(const struct calibration *cal, float raw);
+
+#endif /* CALIBRATION_H */
@@ -0,0 +1,97 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fixedfmt.h"
+
+static const int32_t fixed_scales[FIXED_MAX_PRECISION + 1] = {
+    1, 10, 100, 1000, 10000
+};
+
+static int fixed_clamp_precision(int precision)
+{
+    if (precision < 0) {
+        return 0;
+    }
+    if (precision > FIXED_MAX_PRECISION) {
+        return FIXED_MAX_PRECISION;
+    }
+    return precision;
+}
+
+int32_t fixed_scale(int precision)
+{
+    return fixed_scales[fixed_clamp_precision(precision)];
+}
+
+int32_t fixed_from_float(float val, int precision)
+{
+    val *= fixed_scale(precision);
+
+    /* saturate rather than overflow */
+    if (val >= 2147483647.0f) {
+        return 2147483647;
+    }
+    if (val <= -2147483647.0f) {
+        return -2147483647;
+    }
+
+    return (int32_t)(val < 0.0f ? val - 0.5f : val + 0.5f);
+}
+
+int fixed_format(char *buf, size_t size, int32_t val, int precision)
+{
+    int i;
+    int len;
+    uint32_t mag;
+    char tmp[FIXED_STRLEN];
+
+    precision = fixed_clamp_precision(precision);
+    mag = val < 0 ? -(uint32_t)val : (uint32_t)val;
+
+    /* build the string backwards, least significant digit first */
+    len = 0;
+    for (i = 0; i < precision; i++) {
+        tmp[len++] = '0' + mag % 10;
+        mag /= 10;
+    }
+    if (precision > 0) {
+        tmp[len++] = '.';
+    }
+    do {
+        tmp[len++] = '0' + mag % 10;
+        mag /= 10;
+    } while (mag > 0);
+    if (val < 0) {
+        tmp[len++] = '-';
+    }
+
+    if (0 == size) {
+        return len;
+    }
+
+    for (i = 0; i < len && (size_t)i < size - 1; i++) {
+        buf[i] = tmp[len - 1 - i];
+    }
+    buf[i] = '\0';
+
+    return len;
+}
+
+int fixed_format_float(char *buf, size_t size, float val, int precision)
+{
+    return fixed_format(buf, size, fixed_from_float(val, precision),
+                        precision);
+}
@@ -0,0 +1,54 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FIXEDFMT_H
+#define FIXEDFMT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* highest number of decimal places supported */
+#define FIXED_MAX_PRECISION 4
+
+/* large enough for any int32_t with a sign and decimal point */
+#define FIXED_STRLEN 13
+
+/*
+ * Decimal formatting of fixed point values.
+ *
+ * Sensor values are formatted with a known number of decimal places.
+ * Doing that with integer arithmetic avoids the float support in printf,
+ * which is large, slow and needs a lot of stack.
+ */
+
+/* returns val scaled by 10^precision, rounded to the nearest integer */
+int32_t fixed_from_float(float val, int precision);
+
+/* returns 10^precision */
+int32_t fixed_scale(int precision);
+
+/*
+ * formats val, scaled by 10^precision, as a decimal number.
+ *
+ * like snprintf, the output is always terminated and truncated to fit,
+ * and the length of the full string is returned.
+ */
+int fixed_format(char *buf, size_t size, int32_t val, int precision);
+
+/* rounds val to precision decimal places and formats it */
+int fixed_format_float(char *buf, size_t size, float val, int precision);
+
+#endif /* FIXEDFMT_H */
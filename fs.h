@@ -18,7 +18,10 @@
 #include <FATFileSystem.h>
 
 #define FS_NAME "sd"
+/* the host tests keep their files in a directory of the host */
+#ifndef FS_MOUNT_POINT
 #define FS_MOUNT_POINT "/" FS_NAME
+#endif
 
 int fs_init();
 int fs_test();
@@ -0,0 +1,119 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "hampel.h"
+
+#include <math.h>
+#include <string.h>
+
+/* scales the MAD of normally distributed samples to their stddev */
+#define HAMPEL_MAD_SCALE 1.4826f
+
+void hampel_reset(struct hampel *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+float hampel_median(const struct hampel *h)
+{
+    if (0 == h->count) {
+        return 0.0f;
+    }
+
+    return (h->sorted[(h->count - 1) / 2] + h->sorted[h->count / 2]) / 2.0f;
+}
+
+/*
+ * The deviations from the median are in increasing order when walking
+ * outwards from the middle of the sorted window, so their median is found
+ * by merging the left and right halves up to the middle.
+ */
+static float hampel_mad(const struct hampel *h, float median)
+{
+    int i;
+    int left;
+    int right;
+    float dev;
+    float lower = 0.0f;
+    int n = h->count;
+
+    left = (n - 1) / 2;
+    right = left + 1;
+    for (i = 0; i <= n / 2; i++) {
+        if (right >= n ||
+            (left >= 0 && median - h->sorted[left] <=
+                          h->sorted[right] - median)) {
+            dev = median - h->sorted[left--];
+        } else {
+            dev = h->sorted[right++] - median;
+        }
+
+        if (i == (n - 1) / 2) {
+            lower = dev;
+        }
+    }
+
+    return (lower + dev) / 2.0f;
+}
+
+static void hampel_remove_sorted(struct hampel *h, float val)
+{
+    int i;
+
+    for (i = 0; i < h->count - 1 && h->sorted[i] != val; i++) {
+    }
+    memmove(&h->sorted[i], &h->sorted[i + 1],
+            (h->count - 1 - i) * sizeof(h->sorted[0]));
+    h->count--;
+}
+
+static void hampel_insert_sorted(struct hampel *h, float val)
+{
+    int i;
+
+    for (i = h->count; i > 0 && h->sorted[i - 1] > val; i--) {
+        h->sorted[i] = h->sorted[i - 1];
+    }
+    h->sorted[i] = val;
+    h->count++;
+}
+
+bool hampel_add(struct hampel *h, float val, float k, float min_dev)
+{
+    float dev;
+    float median;
+    bool outlier = false;
+
+    /* failed reads, kept out of the window */
+    if (val != val) {
+        return true;
+    }
+
+    if (h->count >= HAMPEL_MIN_SAMPLES) {
+        median = hampel_median(h);
+        dev = fabsf(val - median);
+        outlier = dev > min_dev &&
+                  dev > k * HAMPEL_MAD_SCALE * hampel_mad(h, median);
+    }
+
+    if (HAMPEL_WINDOW == h->count) {
+        hampel_remove_sorted(h, h->ring[h->head]);
+    }
+    hampel_insert_sorted(h, val);
+    h->ring[h->head] = val;
+    h->head = (h->head + 1) % HAMPEL_WINDOW;
+
+    return outlier;
+}
@@ -0,0 +1,59 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HAMPEL_H
+#define HAMPEL_H
+
+#include <stdint.h>
+
+/* number of previous samples a new sample is compared to */
+#ifndef HAMPEL_WINDOW
+#define HAMPEL_WINDOW 5
+#endif
+
+/* samples needed before any are rejected */
+#define HAMPEL_MIN_SAMPLES 3
+
+/*
+ * Streaming Hampel identifier for a single sensor channel.
+ *
+ * A sample is an outlier if it is further from the median of the previous
+ * HAMPEL_WINDOW samples than k times their median absolute deviation,
+ * scaled to a standard deviation.  The window is kept both in arrival
+ * order and sorted, so each sample costs one sorted removal and insertion
+ * and one merge over the window, all O(HAMPEL_WINDOW) without allocation.
+ */
+struct hampel {
+    /* the window in arrival order, head is the oldest once full */
+    float ring[HAMPEL_WINDOW];
+    float sorted[HAMPEL_WINDOW];
+    uint8_t head;
+    uint8_t count;
+};
+
+void hampel_reset(struct hampel *h);
+
+/*
+ * adds a sample to the window and returns true if it is an outlier.  a
+ * sample is never an outlier if its distance from the median is within
+ * min_dev, which keeps steady signals with a MAD of 0 from rejecting
+ * every small change.  NaN is always an outlier and is not added.
+ */
+bool hampel_add(struct hampel *h, float val, float k, float min_dev);
+
+/* returns the median of the window, 0 if it is empty */
+float hampel_median(const struct hampel *h);
+
+#endif /* HAMPEL_H */
@@ -0,0 +1,451 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "history.h"
+#include "fs.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#define HISTORY_BLOCK_MARKER 0xA5
+
+/* channels are tracked in a bitmask while flushing */
+#define HISTORY_MAX_CHANNELS 32
+
+/* worst case is two 5-byte varints per sample */
+#define HISTORY_MAX_SAMPLE_BYTES 10
+
+/* marker, channel and two varints */
+#define HISTORY_MAX_HEADER_BYTES 12
+
+/* holds the blocks of all channels of a flush */
+static uint8_t block_buf[HISTORY_RAM_SAMPLES * HISTORY_MAX_SAMPLE_BYTES +
+                         HISTORY_MAX_CHANNELS * HISTORY_MAX_HEADER_BYTES];
+
+static size_t varint_put(uint8_t *buf, uint32_t val)
+{
+    size_t len = 0;
+
+    while (val >= 0x80) {
+        buf[len++] = (uint8_t)(val | 0x80);
+        val >>= 7;
+    }
+    buf[len++] = (uint8_t)val;
+
+    return len;
+}
+
+static size_t varint_get(const uint8_t *buf, size_t avail, uint32_t *val)
+{
+    size_t len = 0;
+    uint32_t shift = 0;
+
+    *val = 0;
+    while (len < avail && shift < 35) {
+        *val |= (uint32_t)(buf[len] & 0x7F) << shift;
+        if (0 == (buf[len++] & 0x80)) {
+            return len;
+        }
+        shift += 7;
+    }
+
+    /* truncated or malformed */
+    return 0;
+}
+
+static int varint_read(FILE *fp, uint32_t *val)
+{
+    int c;
+    uint32_t shift = 0;
+
+    *val = 0;
+    while (shift < 35) {
+        c = fgetc(fp);
+        if (EOF == c) {
+            return -1;
+        }
+        *val |= (uint32_t)(c & 0x7F) << shift;
+        if (0 == (c & 0x80)) {
+            return 0;
+        }
+        shift += 7;
+    }
+
+    return -1;
+}
+
+static uint32_t zigzag_encode(int32_t val)
+{
+    return ((uint32_t)val << 1) ^ (uint32_t)(val >> 31);
+}
+
+static int32_t zigzag_decode(uint32_t val)
+{
+    return (int32_t)(val >> 1) ^ -(int32_t)(val & 1);
+}
+
+SensorHistory::SensorHistory()
+    : _head(0), _unsaved(0), _flush_due(false), _log_ok(false),
+      _samples(0), _samples_saved(0), _bytes_saved(0), _log_size(0),
+      _old_size(0), _rotated(false)
+{
+    memset(_ring, 0, sizeof(_ring));
+}
+
+const char *SensorHistory::realpath()
+{
+    return FS_MOUNT_POINT HISTORY_DEFAULT_PATH;
+}
+
+const char *SensorHistory::oldpath()
+{
+    return FS_MOUNT_POINT HISTORY_DEFAULT_PATH ".old";
+}
+
+int SensorHistory::init()
+{
+    int ret;
+    FILE *fp;
+    std::string dir;
+
+    dir = realpath();
+    dir = dir.substr(0, dir.find_last_of("/"));
+    ret = ::mkdir(dir.c_str(), 0777);
+    if (0 != ret && EEXIST != errno) {
+        printf("ERROR: history: failed to create %s: %d\n",
+               dir.c_str(), errno);
+        return ret;
+    }
+
+    /* keep the log from the last boot around for inspection */
+    remove(oldpath());
+    rename(realpath(), oldpath());
+
+    fp = fopen(realpath(), "wb");
+    if (NULL == fp) {
+        printf("ERROR: history: failed to create log: %d\n", errno);
+        return -errno;
+    }
+    fclose(fp);
+
+    _io_lock.lock();
+    _log_size = 0;
+    _old_size = 0;
+    _rotated = false;
+    _io_lock.unlock();
+
+    _lock.lock();
+    _log_ok = true;
+    _lock.unlock();
+
+    return 0;
+}
+
+size_t SensorHistory::ring_index(size_t age) const
+{
+    return (_head + HISTORY_RAM_SAMPLES - age) % HISTORY_RAM_SAMPLES;
+}
+
+bool SensorHistory::add(uint8_t channel, uint32_t time, int32_t value)
+{
+    bool due = false;
+    struct sample *s;
+
+    _lock.lock();
+    s = &_ring[_head];
+    s->time = time;
+    s->value = value;
+    s->channel = channel;
+
+    _head = (_head + 1) % HISTORY_RAM_SAMPLES;
+    if (_unsaved < HISTORY_RAM_SAMPLES) {
+        _unsaved++;
+    }
+    _samples++;
+
+    if (_log_ok && !_flush_due && _unsaved >= HISTORY_FLUSH_SAMPLES) {
+        _flush_due = true;
+        due = true;
+    }
+    _lock.unlock();
+
+    return due;
+}
+
+void SensorHistory::rotate()
+{
+    remove(oldpath());
+    rename(realpath(), oldpath());
+    _old_size = _log_size;
+    _log_size = 0;
+    _rotated = true;
+}
+
+size_t SensorHistory::encode_block(uint8_t *buf, uint8_t channel,
+                                   size_t first, size_t count)
+{
+    size_t age;
+    size_t len;
+    size_t hdr_len;
+    uint8_t hdr[HISTORY_MAX_HEADER_BYTES];
+    struct sample *s;
+    struct sample *prev;
+
+    /* encode the payload behind the longest possible header, then move it
+     * up behind the actual one */
+    len = 0;
+    prev = NULL;
+    for (age = first; age > 0; age--) {
+        s = &_ring[ring_index(age)];
+        if (s->channel != channel) {
+            continue;
+        }
+
+        if (NULL == prev) {
+            len += varint_put(&buf[HISTORY_MAX_HEADER_BYTES + len], s->time);
+            len += varint_put(&buf[HISTORY_MAX_HEADER_BYTES + len],
+                              zigzag_encode(s->value));
+        } else {
+            len += varint_put(&buf[HISTORY_MAX_HEADER_BYTES + len],
+                              s->time - prev->time);
+            len += varint_put(&buf[HISTORY_MAX_HEADER_BYTES + len],
+                              zigzag_encode(s->value - prev->value));
+        }
+        prev = s;
+    }
+
+    hdr_len = 0;
+    hdr[hdr_len++] = HISTORY_BLOCK_MARKER;
+    hdr[hdr_len++] = channel;
+    hdr_len += varint_put(&hdr[hdr_len], count);
+    hdr_len += varint_put(&hdr[hdr_len], len);
+
+    memmove(&buf[hdr_len], &buf[HISTORY_MAX_HEADER_BYTES], len);
+    memcpy(buf, hdr, hdr_len);
+
+    return hdr_len + len;
+}
+
+int SensorHistory::append(const uint8_t *buf, size_t len)
+{
+    FILE *fp;
+
+    /* write over whatever a failed write left behind the last block */
+    fp = fopen(realpath(), 0 == _log_size ? "wb" : "r+b");
+    if (NULL == fp) {
+        return -errno;
+    }
+
+    if (0 != fseek(fp, _log_size, SEEK_SET) ||
+        fwrite(buf, 1, len, fp) != len) {
+        fclose(fp);
+        return -EIO;
+    }
+    if (0 != fclose(fp)) {
+        return -EIO;
+    }
+
+    return 0;
+}
+
+int SensorHistory::flush()
+{
+    int ret;
+    size_t len;
+    size_t age;
+    size_t unsaved;
+    uint32_t added;
+    uint8_t channel;
+    uint32_t mask = 0;
+    size_t counts[HISTORY_MAX_CHANNELS] = {0};
+
+    _io_lock.lock();
+
+    /* encode under the lock, the ring moves on while the log is written */
+    _lock.lock();
+    unsaved = _log_ok ? _unsaved : 0;
+    added = _samples;
+    for (age = unsaved; age > 0; age--) {
+        channel = _ring[ring_index(age)].channel;
+        if (channel < HISTORY_MAX_CHANNELS) {
+            mask |= 1UL << channel;
+            counts[channel]++;
+        }
+    }
+
+    len = 0;
+    for (channel = 0; channel < HISTORY_MAX_CHANNELS; channel++) {
+        if (0 != (mask & (1UL << channel))) {
+            len += encode_block(&block_buf[len], channel, unsaved,
+                                counts[channel]);
+        }
+    }
+    _lock.unlock();
+
+    ret = 0;
+    if (len > 0) {
+        if (_log_size + len > HISTORY_MAX_LOG_SIZE) {
+            rotate();
+        }
+
+        ret = append(block_buf, len);
+        if (0 != ret) {
+            printf("ERROR: history: failed to write log: %d\n", ret);
+        }
+    }
+
+    _lock.lock();
+    if (0 == ret && len > 0) {
+        _log_size += len;
+        _bytes_saved += len;
+        _samples_saved += unsaved;
+        /* samples added meanwhile are newer than the ones just saved, and
+         * the oldest may have been overwritten by them.  _unsaved stops
+         * growing once the ring is full, so they are counted on _samples */
+        added = _samples - added;
+        _unsaved = added < HISTORY_RAM_SAMPLES ? added : HISTORY_RAM_SAMPLES;
+    }
+    _flush_due = false;
+    _lock.unlock();
+
+    _io_lock.unlock();
+
+    return ret;
+}
+
+static int history_query_file(const char *path, uint32_t size,
+                              uint8_t channel, uint32_t from, uint32_t to,
+                              SensorHistory::visitor cb, void *ctx)
+{
+    FILE *fp;
+    int c;
+    int visited = 0;
+    size_t pos;
+    size_t used;
+    uint32_t i;
+    uint32_t len;
+    uint32_t count;
+    uint32_t delta;
+    uint32_t time;
+    int32_t value;
+    uint8_t block_channel;
+
+    fp = fopen(path, "rb");
+    if (NULL == fp) {
+        return 0;
+    }
+
+    /* anything past size is left from a failed write */
+    while (ftell(fp) < (long)size) {
+        c = fgetc(fp);
+        if (EOF == c) {
+            break;
+        }
+        if (HISTORY_BLOCK_MARKER != c) {
+            printf("WARN: history: corrupt block in %s\n", path);
+            break;
+        }
+
+        c = fgetc(fp);
+        if (EOF == c ||
+            0 != varint_read(fp, &count) ||
+            0 != varint_read(fp, &len)) {
+            break;
+        }
+        block_channel = (uint8_t)c;
+
+        if (block_channel != channel || len > sizeof(block_buf)) {
+            fseek(fp, len, SEEK_CUR);
+            continue;
+        }
+
+        /* a partial block is left behind if power is lost mid-write */
+        if (ftell(fp) + len > size || fread(block_buf, 1, len, fp) != len) {
+            break;
+        }
+
+        pos = 0;
+        time = 0;
+        value = 0;
+        for (i = 0; i < count; i++) {
+            used = varint_get(&block_buf[pos], len - pos, &delta);
+            if (0 == used) {
+                break;
+            }
+            pos += used;
+            time += delta;
+
+            used = varint_get(&block_buf[pos], len - pos, &delta);
+            if (0 == used) {
+                break;
+            }
+            pos += used;
+            value += zigzag_decode(delta);
+
+            if (time >= from && time <= to) {
+                cb(ctx, time, value);
+                visited++;
+            }
+        }
+    }
+
+    fclose(fp);
+
+    return visited;
+}
+
+int SensorHistory::query(uint8_t channel, uint32_t from, uint32_t to,
+                         visitor cb, void *ctx)
+{
+    int ret;
+    size_t age;
+    int visited = 0;
+    struct sample *s;
+
+    /* holding the io lock keeps a flush from moving samples from the ring
+     * to the log halfway through */
+    _io_lock.lock();
+    if (_log_ok) {
+        if (_rotated) {
+            ret = history_query_file(oldpath(), _old_size, channel, from, to,
+                                     cb, ctx);
+            if (ret > 0) {
+                visited += ret;
+            }
+        }
+
+        ret = history_query_file(realpath(), _log_size, channel, from, to,
+                                 cb, ctx);
+        if (ret > 0) {
+            visited += ret;
+        }
+    }
+
+    /* without a log, the ring holds everything that is left */
+    _lock.lock();
+    for (age = _unsaved; age > 0; age--) {
+        s = &_ring[ring_index(age)];
+        if (s->channel == channel && s->time >= from && s->time <= to) {
+            cb(ctx, s->time, s->value);
+            visited++;
+        }
+    }
+    _lock.unlock();
+    _io_lock.unlock();
+
+    return visited;
+}
@@ -0,0 +1,186 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mbed.h"
+
+#define HISTORY_DEFAULT_PATH "/history/history.log"
+
+/* number of recent samples kept in RAM */
+#ifndef HISTORY_RAM_SAMPLES
+#define HISTORY_RAM_SAMPLES 128
+#endif
+
+/* number of unsaved samples that triggers a write to the log */
+#ifndef HISTORY_FLUSH_SAMPLES
+#define HISTORY_FLUSH_SAMPLES 64
+#endif
+
+/* the log is rotated once it grows past this size */
+#ifndef HISTORY_MAX_LOG_SIZE
+#define HISTORY_MAX_LOG_SIZE (256 * 1024)
+#endif
+
+/*
+    class: SensorHistory
+
+    compact time-series store for sensor samples
+
+    recent samples are kept in a RAM ring.  once enough of them have
+    accumulated they are appended to a log file as one block per channel.
+    blocks are delta encoded: timestamps as unsigned varints and values as
+    zigzag varints of the difference to the previous sample, so a slowly
+    changing sensor costs 2-3 bytes per sample on flash.
+
+    block layout:
+        marker (1 byte), channel (1 byte), count (varint),
+        payload length (varint), payload
+
+    the log from the previous boot is kept next to the current one with a
+    ".old" suffix, which is also where the log goes when it is rotated for
+    size.  timestamps are seconds since boot, so queries only cover logs
+    written during the current boot.
+
+    the blocks of a flush are written in one go at the end of the last
+    successful flush, so a failed write is overwritten by its retry rather
+    than left in the log.  add() may run concurrently with flush() and
+    query(), which lets the slow flash writes run on a thread of their own.
+*/
+class SensorHistory
+{
+public:
+    /*
+        callback type for queries, called once per matching sample
+    */
+    typedef void (*visitor)(void *ctx, uint32_t time, int32_t value);
+
+    SensorHistory();
+
+    /*
+        Function: init
+
+        prepares the log file, rotating any log left by a previous boot
+
+        Returns:
+        0 for success, nonzero on failure
+    */
+    int init();
+
+    /*
+        Function: add
+
+        records a sample.  values are fixed point, scaled by the caller.
+
+        Params:
+        uint8_t channel - the channel the sample was taken on
+        uint32_t time   - seconds since boot
+        int32_t value   - the scaled sample value
+
+        Returns:
+        true once enough samples are unsaved for a flush, until flush()
+        has run
+    */
+    bool add(uint8_t channel, uint32_t time, int32_t value);
+
+    /*
+        Function: flush
+
+        writes all unsaved samples to the log.  samples added while the
+        log is being written are left for the next flush.
+
+        Returns:
+        0 for success, nonzero on failure
+    */
+    int flush();
+
+    /*
+        Function: query
+
+        walks every sample of a channel within [from, to], oldest first
+
+        Params:
+        uint8_t channel - the channel to query
+        uint32_t from   - first timestamp to include
+        uint32_t to     - last timestamp to include
+        visitor cb      - called for each sample
+        void *ctx       - passed to cb
+
+        Returns:
+        the number of samples visited, or negative on failure
+    */
+    int query(uint8_t channel, uint32_t from, uint32_t to,
+              visitor cb, void *ctx);
+
+    /* total number of samples recorded since boot */
+    uint32_t samples() const { return _samples; }
+
+    /* number of samples written to the log since boot */
+    uint32_t samples_saved() const { return _samples_saved; }
+
+    /* number of bytes written to the log since boot */
+    uint32_t bytes_saved() const { return _bytes_saved; }
+
+private:
+    struct sample {
+        uint32_t time;
+        int32_t value;
+        uint8_t channel;
+    };
+
+    struct sample _ring[HISTORY_RAM_SAMPLES];
+    /* index of the next slot to write */
+    size_t _head;
+    /* number of samples in the ring that are not in the log yet */
+    size_t _unsaved;
+    /* set once add() has asked for a flush */
+    bool _flush_due;
+
+    /* guards the ring and the counters */
+    Mutex _lock;
+    /* guards the log files and the block buffer */
+    Mutex _io_lock;
+
+    bool _log_ok;
+    uint32_t _samples;
+    uint32_t _samples_saved;
+    uint32_t _bytes_saved;
+
+    /* bytes of the log file written by successful flushes, anything
+     * beyond is left from a failed write */
+    uint32_t _log_size;
+    /* the same for the rotated log */
+    uint32_t _old_size;
+    /* set once the log has been rotated during this boot */
+    bool _rotated;
+
+    /* returns the real log path including the filesystem mount point */
+    static const char *realpath();
+    static const char *oldpath();
+
+    void rotate();
+    size_t encode_block(uint8_t *buf, uint8_t channel, size_t first,
+                        size_t count);
+    int append(const uint8_t *buf, size_t len);
+
+    size_t ring_index(size_t age_from_head) const;
+};
+
+#endif /* HISTORY_H */
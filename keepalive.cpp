@@ -0,0 +1,88 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "keepalive.h"
+
+#include <string.h>
+
+void keepalive_init(struct keepalive *k, uint32_t lifetime_ms)
+{
+    memset(k, 0, sizeof(*k));
+    k->min_ms = lifetime_ms / 8;
+    k->max_ms = lifetime_ms / 2;
+    k->step_ms = lifetime_ms / 16;
+    k->interval_ms = lifetime_ms / 4;
+}
+
+uint32_t keepalive_due(struct keepalive *k, uint32_t idle_ms)
+{
+    if (idle_ms < k->interval_ms) {
+        k->skipped++;
+        return k->interval_ms - idle_ms;
+    }
+    return 0;
+}
+
+void keepalive_sent(struct keepalive *k, uint32_t idle_ms)
+{
+    uint32_t limit;
+
+    /* the connection survived the idle time before the previous update */
+    if (0 != k->pending_ms) {
+        if (k->pending_ms > k->survived_ms) {
+            k->survived_ms = k->pending_ms;
+        }
+
+        /* only grow once the current interval has been tried */
+        limit = k->max_ms;
+        if (0 != k->timeout_ms && k->timeout_ms / 4 * 3 < limit) {
+            limit = k->timeout_ms / 4 * 3;
+        }
+        if (k->pending_ms >= k->interval_ms &&
+            k->interval_ms + k->step_ms <= limit) {
+            k->interval_ms += k->step_ms;
+        }
+    }
+
+    k->pending_ms = idle_ms;
+    k->updates++;
+}
+
+void keepalive_failed(struct keepalive *k, uint32_t idle_ms)
+{
+    k->failures++;
+    k->pending_ms = 0;
+
+    /* the link went down while in use, nothing to learn */
+    if (idle_ms <= k->survived_ms || idle_ms < k->min_ms) {
+        return;
+    }
+
+    if (0 == k->timeout_ms || idle_ms < k->timeout_ms) {
+        k->timeout_ms = idle_ms;
+    }
+    k->interval_ms /= 2;
+    if (k->interval_ms < k->min_ms) {
+        k->interval_ms = k->min_ms;
+    }
+}
+
+void keepalive_registered(struct keepalive *k)
+{
+    k->registrations++;
+    k->pending_ms = 0;
+}
@@ -0,0 +1,75 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef KEEPALIVE_H
+#define KEEPALIVE_H
+
+#include <stdint.h>
+
+/*
+ * Adaptive interval of the registration keep-alive.
+ *
+ * Over TCP, the keep-alive mostly keeps NAT and firewall mappings open, and
+ * any traffic on the connection does that as well.  An update is only due
+ * once the connection has been idle for the current interval, so a device
+ * that publishes often rarely sends one.
+ *
+ * The interval starts at a quarter of the registration lifetime.  Every
+ * update that is followed by another without the connection breaking
+ * shows that the idle time before it is safe, and the interval grows by a
+ * sixteenth of the lifetime, up to half of it.  If the connection breaks
+ * after an idle time longer than any it survived, that idle time is taken
+ * as the timeout of the path: the interval is halved, and never grows
+ * beyond three quarters of the timeout again.  It never drops below an
+ * eighth of the lifetime.
+ */
+struct keepalive {
+    uint32_t min_ms;
+    uint32_t max_ms;
+    uint32_t step_ms;
+    uint32_t interval_ms;
+    /* longest idle time the connection survived, 0 until known */
+    uint32_t survived_ms;
+    /* shortest idle time the connection broke after, 0 until known */
+    uint32_t timeout_ms;
+    /* idle time before the last update, until the next one confirms it */
+    uint32_t pending_ms;
+    uint32_t updates;
+    /* checks that found the connection had been used recently */
+    uint32_t skipped;
+    uint32_t failures;
+    uint32_t registrations;
+};
+
+void keepalive_init(struct keepalive *k, uint32_t lifetime_ms);
+
+/*
+ * returns 0 if an update is due after the connection has been idle for
+ * idle_ms, otherwise the time until the next check
+ */
+uint32_t keepalive_due(struct keepalive *k, uint32_t idle_ms);
+
+/* records an update sent after idle_ms without traffic */
+void keepalive_sent(struct keepalive *k, uint32_t idle_ms);
+
+/* the connection broke, after being idle for idle_ms before its last use */
+void keepalive_failed(struct keepalive *k, uint32_t idle_ms);
+
+/* the client registered, on a new connection */
+void keepalive_registered(struct keepalive *k);
+
+#endif /* KEEPALIVE_H */
@@ -15,39 +15,259 @@
  */
 
 #include "m2mclient.h"
+#include "compat.h"
+#include "fixedfmt.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* one resource of the M2M schema */
+struct resource_schema {
+    const char *object;
+    uint16_t instance;
+    const char *id;
+    const char *name;
+    M2MResourceInstance::ResourceType type;
+    M2MBase::Operation operation;
+    bool observable;
+    enum M2MClient::M2MClientResource resource;
+    /* value set on creation, or NULL */
+    const char *value;
+};
+
+/*
+ * every resource of the client, in the order the objects are created.  the
+ * resources of an object must be contiguous, as must those of an instance.
+ */
+static const struct resource_schema m2m_schema[] = {
+    /* wem custom app resources, the user-friendly label and the version */
+    {"26241", 0, "1", "Label", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true, M2MClient::M2MClientResourceAppLabel,
+     NULL},
+    {"26241", 0, "2", "Version", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, false, M2MClient::M2MClientResourceAppVersion,
+     MBED_CONF_APP_VERSION},
+    /* takes a JSON object of keystore keys, and reads back the status of
+     * each */
+    {"26241", 0, "3", "Config", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true, M2MClient::M2MClientResourceAppConfig,
+     NULL},
+
+    /* sensors, with aggregates published once per reporting window and
+     * the units of all three as SenML unit symbols */
+    {"3301", 0, "5700", "light_value", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceLightValue,
+     NULL},
+    {"3301", 0, "5601", "light_min", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceLightMin,
+     NULL},
+    {"3301", 0, "5602", "light_max", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceLightMax,
+     NULL},
+    {"3301", 0, "5701", "light_units", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, false, M2MClient::M2MClientResourceLightUnits,
+     "lx"},
+
+    {"3303", 0, "5700", "temperature_value", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceTempValue,
+     NULL},
+    {"3303", 0, "5601", "temperature_min", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceTempMin,
+     NULL},
+    {"3303", 0, "5602", "temperature_max", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceTempMax,
+     NULL},
+    {"3303", 0, "5701", "temperature_units", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, false, M2MClient::M2MClientResourceTempUnits,
+     "Cel"},
+
+    {"3304", 0, "5700", "humidity_value", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceHumidityValue,
+     NULL},
+    {"3304", 0, "5601", "humidity_min", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceHumidityMin,
+     NULL},
+    {"3304", 0, "5602", "humidity_max", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceHumidityMax,
+     NULL},
+    {"3304", 0, "5701", "humidity_units", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, false, M2MClient::M2MClientResourceHumidityUnits,
+     "%RH"},
+
+#if MBED_CONF_APP_SOUND_ENABLED
+    /* Loudness, A-weighted level in dB */
+    {"3324", 0, "5700", "sound_value", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceSoundValue,
+     NULL},
+    {"3324", 0, "5601", "sound_min", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceSoundMin,
+     NULL},
+    {"3324", 0, "5602", "sound_max", M2MResourceInstance::FLOAT,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceSoundMax,
+     NULL},
+    {"3324", 0, "5701", "sound_units", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, false, M2MClient::M2MClientResourceSoundUnits,
+     "dB"},
+#endif
 
-int M2MClient::init()
-{
-    int ret;
+    /* wem custom network and sensor resources */
+    {"26242", 0, "1", "network_resource", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceNetwork,
+     NULL},
+    /* SenML packs of readings taken while the client was offline */
+    {"26242", 0, "2", "sensor_backlog", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceBacklog,
+     NULL},
+    {"26242", 0, "3", "backlog_depth", M2MResourceInstance::INTEGER,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceBacklogDepth,
+     "0"},
+    {"26242", 0, "7", "sensor_pack", M2MResourceInstance::OPAQUE,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceSensorPack,
+     NULL},
+    {"26242", 0, "8", "sched_stats", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceSchedStats,
+     NULL},
+    /* writable calibration tables, see calibration.h for the format */
+    {"26242", 0, "4", "light_calibration", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true, M2MClient::M2MClientResourceLightCal,
+     NULL},
+    {"26242", 0, "5", "temperature_calibration", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true, M2MClient::M2MClientResourceTempCal,
+     NULL},
+    {"26242", 0, "6", "humidity_calibration", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true, M2MClient::M2MClientResourceHumidityCal,
+     NULL},
+#if MBED_CONF_APP_SOUND_ENABLED
+    {"26242", 0, "12", "sound_calibration", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true, M2MClient::M2MClientResourceSoundCal,
+     NULL},
+#endif
+    /* writable sampling interval bounds, "<min-ms>,<max-ms>" */
+    {"26242", 0, "9", "light_sampling", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true,
+     M2MClient::M2MClientResourceLightSampling, NULL},
+    {"26242", 0, "10", "temperature_sampling", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true,
+     M2MClient::M2MClientResourceTempSampling, NULL},
+    {"26242", 0, "11", "humidity_sampling", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true,
+     M2MClient::M2MClientResourceHumiditySampling, NULL},
+#if MBED_CONF_APP_SOUND_ENABLED
+    {"26242", 0, "13", "sound_sampling", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true,
+     M2MClient::M2MClientResourceSoundSampling, NULL},
+    {"26242", 0, "14", "sound_bands", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceSoundBands,
+     NULL},
+#endif
 
-    ret = add_app_resources();
-    if (0 != ret) {
-        return ret;
-    }
+    /* wem custom runtime telemetry, heap in bytes, stacks as
+     * "<thread>:<peak>/<size>,...", latency and jitter in us, uptime in s */
+#if MBED_HEAP_STATS_ENABLED == 1
+    {"26243", 0, "1", "heap_used", M2MResourceInstance::INTEGER,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceHeapUsed,
+     "0"},
+    {"26243", 0, "2", "heap_peak", M2MResourceInstance::INTEGER,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceHeapPeak,
+     "0"},
+    {"26243", 0, "3", "heap_fails", M2MResourceInstance::INTEGER,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceHeapFails,
+     "0"},
+#endif
+#if MBED_STACK_STATS_ENABLED == 1
+    {"26243", 0, "4", "stack_peaks", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceStackPeaks,
+     NULL},
+#endif
+    {"26243", 0, "5", "event_latency", M2MResourceInstance::INTEGER,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceEventLatency,
+     "0"},
+    {"26243", 0, "6", "sensor_jitter", M2MResourceInstance::INTEGER,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceSensorJitter,
+     "0"},
+    {"26243", 0, "7", "reconnects", M2MResourceInstance::INTEGER,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceReconnects,
+     "0"},
+    {"26243", 0, "8", "uptime", M2MResourceInstance::INTEGER,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceUptime,
+     "0"},
+
+    /* one object holds both geo resource types, the user-specified
+     * location in instance 0 and the dynamic one in instance 1 */
+    {"3336", 0, "5514", "Latitude", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true, M2MClient::M2MClientResourceGeoLat,
+     NULL},
+    {"3336", 0, "5515", "Longitude", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true, M2MClient::M2MClientResourceGeoLong,
+     NULL},
+    {"3336", 0, "5516", "Uncertainty", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true, M2MClient::M2MClientResourceGeoAccuracy,
+     NULL},
+    {"3336", 0, "5750", "Application_Type", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceGeoType,
+     "user"},
+    {"3336", 1, "5514", "Latitude", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true, M2MClient::M2MClientResourceAutoGeoLat,
+     NULL},
+    {"3336", 1, "5515", "Longitude", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true, M2MClient::M2MClientResourceAutoGeoLong,
+     NULL},
+    {"3336", 1, "5516", "Uncertainty", M2MResourceInstance::STRING,
+     M2MBase::GET_PUT_ALLOWED, true,
+     M2MClient::M2MClientResourceAutoGeoAccuracy, NULL},
+    {"3336", 1, "5750", "Application_Type", M2MResourceInstance::STRING,
+     M2MBase::GET_ALLOWED, true, M2MClient::M2MClientResourceAutoGeoType,
+     "auto"},
+};
 
-    ret = add_light_sensor();
-    if (0 != ret) {
-        return ret;
-    }
+int M2MClient::init()
+{
+    const struct resource_schema *s;
+    const struct resource_schema *prev = NULL;
+    M2MObject *obj = NULL;
+    M2MObjectInstance *inst = NULL;
+    M2MResource *res;
 
-    ret = add_temp_sensor();
-    if (0 != ret) {
-        return ret;
-    }
+    memset(_res, 0, sizeof(_res));
+    _objects.clear();
+
+    for (size_t i = 0; i < ARRAY_SIZE(m2m_schema); i++) {
+        s = &m2m_schema[i];
+
+        if (NULL == prev || 0 != strcmp(prev->object, s->object)) {
+            /* registering an object twice would send it twice */
+            if (NULL != find_object(s->object)) {
+                printf("ERROR: m2m schema splits object %s\n",
+                       s->object);
+                return -1;
+            }
+            obj = M2MInterfaceFactory::create_object(s->object);
+            if (NULL == obj) {
+                return -1;
+            }
+            _objects.push_back(obj);
+            inst = NULL;
+        }
 
-    ret = add_humidity_sensor();
-    if (0 != ret) {
-        return ret;
-    }
+        if (NULL == inst || prev->instance != s->instance) {
+            inst = obj->create_object_instance(s->instance);
+            if (NULL == inst) {
+                return -1;
+            }
+        }
 
-    ret = add_network_sensor();
-    if (0 != ret) {
-        return ret;
-    }
+        res = inst->create_dynamic_resource(s->id, s->name, s->type,
+                                            s->observable);
+        if (NULL == res) {
+            return -1;
+        }
+        res->set_operation(s->operation);
+        if (NULL != s->value) {
+            set_resource_value(res, s->value, strlen(s->value));
+        }
+        _res[s->resource] = res;
 
-    ret = add_geo_resources();
-    if (0 != ret) {
-        return ret;
+        prev = s;
     }
 
     return 0;
@@ -55,7 +275,10 @@ int M2MClient::init()
 
 std::string M2MClient::get_resource_value_str(M2MResource *res)
 {
-    return res->get_value_string().c_str();
+    if (NULL == res->value()) {
+        return "";
+    }
+    return std::string((const char *)res->value(), res->value_length());
 }
 
 std::string M2MClient::get_resource_value_str(enum M2MClientResource resource)
@@ -70,11 +293,83 @@ std::string M2MClient::get_resource_value_str(enum M2MClientResource resource)
     return get_resource_value_str(res);
 }
 
+void M2MClient::write_value(M2MResource *res, const char *val, size_t len)
+{
+    res->set_value((const uint8_t *)val, len);
+    _notifications++;
+    mark_traffic();
+}
+
 void M2MClient::set_resource_value(M2MResource *res,
                                    const char *val,
                                    size_t len)
 {
-    res->set_value((const uint8_t *)val, len);
+    if (_batch_depth > 0 && defer_value(res, val, len)) {
+        return;
+    }
+
+    write_value(res, val, len);
+}
+
+struct M2MClient::pending_value *M2MClient::find_pending(M2MResource *res)
+{
+    for (unsigned i = 0; i < _pending_count; i++) {
+        if (res == _pending[i].res) {
+            return &_pending[i];
+        }
+    }
+    return NULL;
+}
+
+bool M2MClient::defer_value(M2MResource *res, const char *val, size_t len)
+{
+    struct pending_value *p;
+
+    p = find_pending(res);
+    if (len > M2MCLIENT_BATCH_VALUE_LEN) {
+        /* the value is written straight away, so a shorter one held back
+         * for the same resource must not replace it when the batch ends */
+        if (NULL != p) {
+            memmove(p, p + 1, (&_pending[_pending_count] - (p + 1)) *
+                              sizeof(*p));
+            _pending_count--;
+            _coalesced++;
+        }
+        return false;
+    }
+
+    if (NULL != p) {
+        _coalesced++;
+    } else if (_pending_count < M2MCLIENT_BATCH_MAX) {
+        p = &_pending[_pending_count++];
+        p->res = res;
+    } else {
+        return false;
+    }
+
+    memcpy(p->val, val, len);
+    p->len = len;
+    return true;
+}
+
+void M2MClient::begin_update()
+{
+    _batch_depth++;
+}
+
+void M2MClient::end_update()
+{
+    if (0 == _batch_depth || 0 != --_batch_depth) {
+        return;
+    }
+
+    if (_pending_count > 0) {
+        _bursts++;
+    }
+    for (unsigned i = 0; i < _pending_count; i++) {
+        write_value(_pending[i].res, _pending[i].val, _pending[i].len);
+    }
+    _pending_count = 0;
 }
 
 void M2MClient::set_resource_value(enum M2MClientResource resource,
@@ -104,26 +399,153 @@ void M2MClient::set_resource_value(enum M2MClientResource resource,
     set_resource_value(res, val.c_str(), val.length());
 }
 
-void M2MClient::register_objects()
+bool M2MClient::set_changed_value(M2MResource *res,
+                                  const char *val,
+                                  size_t len)
+{
+    const struct pending_value *p;
+    const void *cur;
+    size_t cur_len;
+
+    /* compare with the value the resource will hold */
+    p = find_pending(res);
+    if (NULL != p) {
+        cur = p->val;
+        cur_len = p->len;
+    } else {
+        cur = res->value();
+        cur_len = res->value_length();
+    }
+
+    if (NULL != cur && cur_len == len && 0 == memcmp(cur, val, len)) {
+        _unchanged++;
+        return false;
+    }
+
+    set_resource_value(res, val, len);
+    return true;
+}
+
+bool M2MClient::set_text(enum M2MClientResource resource,
+                         const char *val,
+                         size_t len)
+{
+    M2MResource *res;
+
+    res = get_resource(resource);
+    if (NULL == res) {
+        return false;
+    }
+
+    return set_changed_value(res, val, len);
+}
+
+bool M2MClient::set_float(M2MResource *res, float val, int precision)
+{
+    int len;
+    char buf[FIXED_STRLEN];
+
+    len = fixed_format_float(buf, sizeof(buf), val, precision);
+    return set_changed_value(res, buf, len);
+}
+
+bool M2MClient::set_float(enum M2MClientResource resource,
+                          float val,
+                          int precision)
+{
+    M2MResource *res;
+
+    res = get_resource(resource);
+    if (NULL == res) {
+        return false;
+    }
+
+    return set_float(res, val, precision);
+}
+
+bool M2MClient::set_int(M2MResource *res, int32_t val)
+{
+    int len;
+    char buf[FIXED_STRLEN];
+
+    len = fixed_format(buf, sizeof(buf), val, 0);
+    return set_changed_value(res, buf, len);
+}
+
+bool M2MClient::set_int(enum M2MClientResource resource, int32_t val)
+{
+    M2MResource *res;
+
+    res = get_resource(resource);
+    if (NULL == res) {
+        return false;
+    }
+
+    return set_int(res, val);
+}
+
+float M2MClient::get_float(M2MResource *res)
+{
+    char buf[FIXED_STRLEN];
+    size_t len;
+
+    /* the value isn't necessarily terminated */
+    len = res->value_length();
+    if (NULL == res->value() || 0 == len || len >= sizeof(buf)) {
+        return 0.0f;
+    }
+    memcpy(buf, res->value(), len);
+    buf[len] = '\0';
+
+    return strtof(buf, NULL);
+}
+
+float M2MClient::get_float(enum M2MClientResource resource)
 {
-    M2MObject *obj;
     M2MResource *res;
-    M2MObjectList obj_list;
-    std::map<std::string, struct resource_entry>::iterator it;
 
-    for (it = _res_map.begin(); it != _res_map.end(); ++it) {
-        res = it->second.res;
-        obj = &res->get_parent_object_instance().get_parent_object();
-        obj_list.push_back(obj);
+    res = get_resource(resource);
+    if (NULL == res) {
+        return 0.0f;
     }
 
-    _cloud_client.add_objects(obj_list);
+    return get_float(res);
+}
+
+M2MObject *M2MClient::find_object(const char *name)
+{
+    M2MObjectList::const_iterator it;
+
+    for (it = _objects.begin(); it != _objects.end(); ++it) {
+        if (0 == strcmp((*it)->name(), name)) {
+            return *it;
+        }
+    }
+    return NULL;
 }
 
-void M2MClient::add_resource(M2MResource *res, enum M2MClientResource type)
+void M2MClient::register_objects()
 {
-    struct resource_entry entry = {res, type};
-    _res_map[res->uri_path()] = entry;
+    const struct resource_schema *s;
+    M2MResource *res;
+
+    /* the registration lists every resource as "</uri>;obs," */
+    _reg_resources = 0;
+    _reg_size = 0;
+    for (size_t i = 0; i < ARRAY_SIZE(m2m_schema); i++) {
+        s = &m2m_schema[i];
+        res = _res[s->resource];
+        if (NULL == res) {
+            continue;
+        }
+        _reg_resources++;
+        _reg_size += strlen(res->uri_path()) + 4;
+        if (s->observable) {
+            _reg_size += 4;
+        }
+    }
+
+    _cloud_client.add_objects(_objects);
 }
 
 #ifdef DEBUG
@@ -164,274 +586,99 @@ void print_object_list(M2MObjectList &obj_list)
 }
 #endif
 
-struct M2MClient::resource_entry *
-M2MClient::get_resource_entry(const char *uri_path)
-{
-    std::map<std::string, struct resource_entry>::iterator it;
-
-    it = _res_map.find(uri_path);
-    if (it == _res_map.end()) {
-        return NULL;
-    }
-
-    return &it->second;
-}
-
 M2MResource *M2MClient::get_resource(const char *uri_path)
 {
-    struct resource_entry *entry;
-
-    entry = get_resource_entry(uri_path);
-    if (NULL == entry) {
-        return NULL;
-    }
-    return entry->res;
-}
-
-struct M2MClient::resource_entry *
-M2MClient::get_resource_entry(enum M2MClientResource type)
-{
-    struct resource_entry *entry;
-    std::map<std::string, struct resource_entry>::iterator it;
-
-    if (type >= M2MClientResourceCount) {
-        return NULL;
-    }
-
-    entry = NULL;
-    for (it = _res_map.begin(); it != _res_map.end(); ++it) {
-        entry = &it->second;
-        if (type == entry->type) {
-            break;
+    for (int i = 0; i < M2MClientResourceCount; i++) {
+        if (NULL != _res[i] && 0 == strcmp(_res[i]->uri_path(), uri_path)) {
+            return _res[i];
         }
-        entry = NULL;
     }
-    return entry;
+    return NULL;
 }
 
 M2MResource *M2MClient::get_resource(enum M2MClientResource resource)
 {
-    struct resource_entry *entry;
-
-    entry = get_resource_entry(resource);
-    if (NULL == entry) {
+    if (resource >= M2MClientResourceCount) {
         return NULL;
     }
-    return entry->res;
-}
-
-int M2MClient::add_light_sensor()
-{
-    M2MObject *obj;
-    M2MResource *res;
-    M2MObjectInstance *inst;
-
-    obj = M2MInterfaceFactory::create_object("3301");
-    inst = obj->create_object_instance();
-    res = inst->create_dynamic_resource("5700", "light_value",
-                                        M2MResourceInstance::FLOAT,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_ALLOWED);
-    add_resource(res, M2MClientResourceLightValue);
-
-    return 0;
+    return _res[resource];
 }
 
-int M2MClient::add_temp_sensor()
+void M2MClient::on_delivery(enum M2MClientResource resource, void *context,
+                            void (*callback)(void *context, bool delivered))
 {
-    M2MObject *obj;
     M2MResource *res;
-    M2MObjectInstance *inst;
 
-    obj = M2MInterfaceFactory::create_object("3303");
-    inst = obj->create_object_instance();
-    res = inst->create_dynamic_resource("5700", "temperature_value",
-                                        M2MResourceInstance::FLOAT,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_ALLOWED);
-    add_resource(res, M2MClientResourceTempValue);
+    res = get_resource(resource);
+    if (NULL == res) {
+        return;
+    }
 
-    return 0;
+    _on_delivery_cb = callback;
+    _on_delivery_context = context;
+    res->set_notification_delivery_status_cb(M2MClient::delivery_status,
+                                             this);
 }
 
-int M2MClient::add_humidity_sensor()
+void M2MClient::delivery_status(const M2MBase &base,
+                                const M2MBase::NotificationDeliveryStatus status,
+                                void *client_args)
 {
-    M2MObject *obj;
-    M2MResource *res;
-    M2MObjectInstance *inst;
+    bool delivered;
+    M2MClient *client = (M2MClient *)client_args;
 
-    obj = M2MInterfaceFactory::create_object("3304");
-    inst = obj->create_object_instance();
-    res = inst->create_dynamic_resource("5700", "humidity_value",
-                                        M2MResourceInstance::FLOAT,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_ALLOWED);
-    add_resource(res, M2MClientResourceHumidityValue);
+    switch (status) {
+        case M2MBase::NOTIFICATION_STATUS_DELIVERED:
+            delivered = true;
+            break;
+#ifdef MBED_CLOUD_CLIENT_TRANSPORT_MODE_TCP
+        /* CoAP over TCP has no acknowledgements, TCP delivers what was
+         * sent */
+        case M2MBase::NOTIFICATION_STATUS_SENT:
+            delivered = true;
+            break;
+#endif
+        case M2MBase::NOTIFICATION_STATUS_BUILD_ERROR:
+        case M2MBase::NOTIFICATION_STATUS_RESEND_QUEUE_FULL:
+        case M2MBase::NOTIFICATION_STATUS_SEND_FAILED:
+        case M2MBase::NOTIFICATION_STATUS_UNSUBSCRIBED:
+            delivered = false;
+            break;
+        default:
+            return;
+    }
 
-    return 0;
+    if (NULL != client->_on_delivery_cb) {
+        client->_on_delivery_cb(client->_on_delivery_context, delivered);
+    }
 }
 
-int M2MClient::add_network_sensor()
+bool M2MClient::is_observed(enum M2MClientResource resource)
 {
-    M2MObject *obj;
     M2MResource *res;
-    M2MObjectInstance *inst;
-
-    /*
-     * create an instance of the top level object for wem custom
-     * app resources
-     * */
-    obj = M2MInterfaceFactory::create_object("26242");
-    inst = obj->create_object_instance();
-
-    /*
-     * attach resources to the App object instance
-     */
-    res = inst->create_dynamic_resource("1", "network_resource",
-                                        M2MResourceInstance::STRING,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_ALLOWED);
-    add_resource(res, M2MClientResourceNetwork);
 
-    return 0;
+    res = get_resource(resource);
+    return NULL != res && res->is_under_observation();
 }
 
 void M2MClient::value_updated(M2MBase *base, M2MBase::BaseType type)
 {
-    struct resource_entry *entry;
-
-    if (NULL == base || NULL == base->uri_path()) {
+    if (NULL == base) {
         return;
     }
 
-    entry = get_resource_entry(base->uri_path());
-    if (NULL == entry) {
-        printf("WARN: PUT called on unknown uri_path=%s\n", base->uri_path());
-        return;
-    }
-
-    _on_resource_updated_cb(_on_resource_updated_context, entry->type);
-}
-
-int M2MClient::add_geo_resources()
-{
-    const char *type;
-    M2MObject *obj;
-    M2MResource *res;
-    M2MObjectInstance *inst;
-
-    /* one object will hold both geo resource types */
-    obj = M2MInterfaceFactory::create_object("3336");
-
-    /*
-     * add the user-specified geo resource
-     * */
-    inst = obj->create_object_instance((uint16_t)0);
-    res = inst->create_dynamic_resource("5514", "Latitude",
-                                        M2MResourceInstance::STRING,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_PUT_ALLOWED);
-    add_resource(res, M2MClientResourceGeoLat);
-    res = NULL;
-
-    res = inst->create_dynamic_resource("5515", "Longitude",
-                                        M2MResourceInstance::STRING,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_PUT_ALLOWED);
-    add_resource(res, M2MClientResourceGeoLong);
-    res = NULL;
-
-    res = inst->create_dynamic_resource("5516", "Uncertainty",
-                                        M2MResourceInstance::STRING,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_PUT_ALLOWED);
-    add_resource(res, M2MClientResourceGeoAccuracy);
-    res = NULL;
-
-    res = inst->create_dynamic_resource("5750", "Application_Type",
-                                        M2MResourceInstance::STRING,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_ALLOWED);
-    type = "user";
-    set_resource_value(res, type, strlen(type));
-    add_resource(res, M2MClientResourceGeoType);
-    res = NULL;
-
-    /*
-     * add the dynamic geo resource
-     * */
-    inst = obj->create_object_instance((uint16_t)1);
-    res = inst->create_dynamic_resource("5514", "Latitude",
-                                        M2MResourceInstance::STRING,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_PUT_ALLOWED);
-    add_resource(res, M2MClientResourceAutoGeoLat);
-    res = NULL;
-
-    res = inst->create_dynamic_resource("5515", "Longitude",
-                                        M2MResourceInstance::STRING,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_PUT_ALLOWED);
-    add_resource(res, M2MClientResourceAutoGeoLong);
-    res = NULL;
-
-    res = inst->create_dynamic_resource("5516", "Uncertainty",
-                                        M2MResourceInstance::STRING,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_PUT_ALLOWED);
-    add_resource(res, M2MClientResourceAutoGeoAccuracy);
-    res = NULL;
-
-    res = inst->create_dynamic_resource("5750", "Application_Type",
-                                        M2MResourceInstance::STRING,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_ALLOWED);
-    type = "auto";
-    set_resource_value(res, type, strlen(type));
-    add_resource(res, M2MClientResourceAutoGeoType);
-    res = NULL;
-
-    return 0;
-}
+    mark_traffic();
 
-int M2MClient::add_app_resources()
-{
-    M2MObject *obj;
-    M2MResource *res;
-    M2MObjectInstance *inst;
-
-    /*
-     * create an instance of the top level object for wem custom
-     * app resources
-     * */
-    obj = M2MInterfaceFactory::create_object("26241");
-    inst = obj->create_object_instance();
-
-    /*
-     * attach resources to the App object instance
-     * */
-
-    /* add the user-friendly app label */
-    res = inst->create_dynamic_resource("1",
-                                        "Label",
-                                        M2MResourceInstance::STRING,
-                                        true /* observable */);
-    res->set_operation(M2MBase::GET_PUT_ALLOWED);
-    add_resource(res, M2MClientResourceAppLabel);
-    res = NULL;
-
-    /* add the app version */
-    res = inst->create_dynamic_resource("2",
-                                        "Version",
-                                        M2MResourceInstance::STRING,
-                                        false /* observable */);
-    res->set_operation(M2MBase::GET_ALLOWED);
-    res->set_value((const uint8_t *)MBED_CONF_APP_VERSION,
-                   strlen(MBED_CONF_APP_VERSION));
-    add_resource(res, M2MClientResourceAppVersion);
-    res = NULL;
+    for (int i = 0; i < M2MClientResourceCount; i++) {
+        if (base == _res[i]) {
+            _on_resource_updated_cb(_on_resource_updated_context,
+                                    (enum M2MClientResource)i);
+            return;
+        }
+    }
 
-    return 0;
+    printf("WARN: PUT called on unknown uri_path=%s\n",
+           NULL != base->uri_path() ? base->uri_path() : "");
 }
 
 void M2MClient::set_fota_download_requested()
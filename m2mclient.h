@@ -30,14 +30,16 @@
 #ifndef M2MCLIENT_H
 #define M2MCLIENT_H
 
+#include "fixedfmt.h"
 #include "m2mresources.h"
 
 #include <MbedCloudClient.h>
 #include <NetworkInterface.h>
 #include <m2mdevice.h>
+#include <mbed.h>
 
-#include <map>
 #include <stdio.h>
+#include <string.h>
 
 #define M2MCLIENT_F_REGISTER_CALLED           1 << 0
 #define M2MCLIENT_F_REGISTERED                1 << 1
@@ -45,6 +47,13 @@
 #define M2MCLIENT_F_FOTA_DL_GRANTED           1 << 3
 #define M2MCLIENT_F_FOTA_INSTALL_REQD         1 << 4
 #define M2MCLIENT_F_FOTA_INSTALL_GRANTED      1 << 5
+#define M2MCLIENT_F_REGISTER_TIMED            1 << 6
+#define M2MCLIENT_F_CONFIRMED                 1 << 7
+#define M2MCLIENT_F_RESUMING                  1 << 8
+
+/* values held back by an update batch, longer values are written at once */
+#define M2MCLIENT_BATCH_MAX                   8
+#define M2MCLIENT_BATCH_VALUE_LEN             24
 
 class M2MClient : public MbedCloudClientCallback {
 
@@ -53,19 +62,71 @@ public:
         /* Application Info */
         M2MClientResourceAppLabel,
         M2MClientResourceAppVersion,
+        /* Bulk configuration, a JSON object of keystore keys and values */
+        M2MClientResourceAppConfig,
 
         /* Temperature Sensor */
         M2MClientResourceTempValue,
+        M2MClientResourceTempMin,
+        M2MClientResourceTempMax,
+        M2MClientResourceTempUnits,
 
         /* Humidity Sensor */
         M2MClientResourceHumidityValue,
+        M2MClientResourceHumidityMin,
+        M2MClientResourceHumidityMax,
+        M2MClientResourceHumidityUnits,
 
         /* Light Sensor */
         M2MClientResourceLightValue,
+        M2MClientResourceLightMin,
+        M2MClientResourceLightMax,
+        M2MClientResourceLightUnits,
+
+        /* Sound Level Sensor */
+        M2MClientResourceSoundValue,
+        M2MClientResourceSoundMin,
+        M2MClientResourceSoundMax,
+        M2MClientResourceSoundUnits,
 
         /* Network Data */
         M2MClientResourceNetwork,
 
+        /* Readings queued while the client was not registered */
+        M2MClientResourceBacklog,
+        M2MClientResourceBacklogDepth,
+
+        /* SenML-CBOR pack of the latest value of every sensor */
+        M2MClientResourceSensorPack,
+
+        /* Timing of the periodic sensor tasks */
+        M2MClientResourceSchedStats,
+
+        /* Sensor calibration tables */
+        M2MClientResourceLightCal,
+        M2MClientResourceTempCal,
+        M2MClientResourceHumidityCal,
+        M2MClientResourceSoundCal,
+
+        /* Sampling interval bounds, "<min-ms>,<max-ms>" */
+        M2MClientResourceLightSampling,
+        M2MClientResourceTempSampling,
+        M2MClientResourceHumiditySampling,
+        M2MClientResourceSoundSampling,
+
+        /* Octave band levels of the sound sensor, "<63 Hz>,...,<4 kHz>" */
+        M2MClientResourceSoundBands,
+
+        /* Runtime telemetry, published with deadbands */
+        M2MClientResourceHeapUsed,
+        M2MClientResourceHeapPeak,
+        M2MClientResourceHeapFails,
+        M2MClientResourceStackPeaks,
+        M2MClientResourceEventLatency,
+        M2MClientResourceSensorJitter,
+        M2MClientResourceReconnects,
+        M2MClientResourceUptime,
+
         /* Geo Location specified by the user */
         M2MClientResourceGeoLat,
         M2MClientResourceGeoLong,
@@ -82,7 +143,14 @@ public:
         M2MClientResourceCount
     };
 
-    M2MClient() : _flags(0) {
+    M2MClient() : _reg_resources(0), _reg_size(0), _reg_start_us(0),
+                  _reg_ms(0), _pending_count(0), _batch_depth(0),
+                  _notifications(0), _unchanged(0), _coalesced(0),
+                  _bursts(0), _traffic_us(0), _gap_ms(0), _alive_us(0),
+                  _resume_start_us(0), _resume_ms(0), _resumes(0),
+                  _resumed(0), _flags(0), _on_delivery_cb(NULL),
+                  _on_delivery_context(NULL) {
+        memset(_res, 0, sizeof(_res));
     }
 
     int init();
@@ -99,9 +167,13 @@ public:
     bool call_register(NetworkInterface *iface)
     {
         register_objects();
+        _reg_start_us = us_ticker_read();
+        set_flag(M2MCLIENT_F_REGISTER_TIMED);
         bool setup = _cloud_client.setup(iface);
         _cloud_client.set_update_callback(this);
         _cloud_client.on_registered(this, &M2MClient::client_registered);
+        _cloud_client.on_registration_updated(this,
+                                              &M2MClient::client_updated);
         _cloud_client.on_unregistered(this, &M2MClient::client_unregistered);
         _cloud_client.on_error(this, &M2MClient::error);
         set_flag(M2MCLIENT_F_REGISTER_CALLED);
@@ -122,12 +194,70 @@ public:
 
     void close() { _cloud_client.close(); }
 
-    void keep_alive() { _cloud_client.register_update(); }
+    void keep_alive()
+    {
+        mark_traffic();
+        _cloud_client.register_update();
+    }
+
+    /* brings the registration back after the connection was lost
+     *
+     * the server keeps a registration for a lifetime after it was last
+     * confirmed.  until then a registration update is enough to restore
+     * it: the update carries none of the resource links, and its TLS
+     * handshake resumes the session of the previous connection, see
+     * tls_session.h.  returns false once the registration has expired, and
+     * mbed client registers in full as it reconnects, as it also does if
+     * the server rejects the update.  the ticker wraps after 71 minutes,
+     * so an update may still be tried after a longer outage, and is then
+     * rejected.
+     */
+    bool resume()
+    {
+        /* called from the event queue while the callbacks of mbed client
+         * run on its own thread, so the flags are checked and set as one */
+        core_util_critical_section_enter();
+        if (!test_flag(M2MCLIENT_F_CONFIRMED) ||
+            test_flag(M2MCLIENT_F_REGISTERED) ||
+            registration_age_ms() >= MBED_CLOUD_CLIENT_LIFETIME * 1000UL) {
+            core_util_critical_section_exit();
+            return false;
+        }
+        _resumes++;
+        _resume_start_us = us_ticker_read();
+        set_flag(M2MCLIENT_F_RESUMING);
+        core_util_critical_section_exit();
+        keep_alive();
+        return true;
+    }
+
+    /* time since the server last confirmed the registration, in ms */
+    uint32_t registration_age_ms()
+    {
+        return (us_ticker_read() - _alive_us) / 1000;
+    }
+
+    /* time since the connection was last used, in ms */
+    uint32_t idle_ms() { return (us_ticker_read() - _traffic_us) / 1000; }
+
+    /* how long the connection had been idle before its last use, in ms */
+    uint32_t last_gap_ms() { return _gap_ms; }
 
     void client_registered()
     {
         set_flag(M2MCLIENT_F_REGISTERED);
-        printf("Client registered\n");
+        mark_traffic();
+        confirm();
+        /* the update didn't get through, and mbed client fell back to a
+         * full registration */
+        clear_flag(M2MCLIENT_F_RESUMING);
+        if (test_flag(M2MCLIENT_F_REGISTER_TIMED)) {
+            _reg_ms = (us_ticker_read() - _reg_start_us) / 1000;
+            clear_flag(M2MCLIENT_F_REGISTER_TIMED);
+        }
+        printf("Client registered in %lu ms, %u objects, %u resources\n",
+               (unsigned long)_reg_ms, registration_objects(),
+               _reg_resources);
         static const ConnectorClientEndpointInfo *endpoint = NULL;
         if (endpoint == NULL) {
             endpoint = _cloud_client.endpoint_info();
@@ -147,10 +277,33 @@ public:
         _on_registered_cb(_on_registered_context);
     }
 
+    void client_updated()
+    {
+        mark_traffic();
+        confirm();
+        if (test_flag(M2MCLIENT_F_REGISTERED)) {
+            return;
+        }
+
+        /* the registration survived the outage */
+        set_flag(M2MCLIENT_F_REGISTERED);
+        if (test_flag(M2MCLIENT_F_RESUMING)) {
+            clear_flag(M2MCLIENT_F_RESUMING);
+            _resumed++;
+            _resume_ms = (_alive_us - _resume_start_us) / 1000;
+            printf("Client registration resumed in %lu ms\n",
+                   (unsigned long)_resume_ms);
+        } else {
+            printf("Client registration resumed\n");
+        }
+        _on_registered_cb(_on_registered_context);
+    }
+
     void client_unregistered()
     {
         clear_flag(M2MCLIENT_F_REGISTERED);
         clear_flag(M2MCLIENT_F_REGISTER_CALLED);
+        clear_flag(M2MCLIENT_F_CONFIRMED);
         printf("\nClient unregistered\n\n");
         _on_unregistered_cb(_on_unregistered_context);
     }
@@ -158,6 +311,16 @@ public:
     void error(int error_code)
     {
         const char *error;
+
+        /* the connection is gone, the client will register again
+         * once it has been re-established */
+        if (MbedCloudClient::ConnectNetworkError == error_code ||
+            MbedCloudClient::ConnectDnsResolvingFailed == error_code ||
+            MbedCloudClient::ConnectTimeout == error_code ||
+            MbedCloudClient::ConnectSecureConnectionFailed == error_code) {
+            clear_flag(M2MCLIENT_F_REGISTERED);
+        }
+
         switch (error_code) {
             case MbedCloudClient::ConnectErrorNone:
                 error = "MbedCloudClient::ConnectErrorNone";
@@ -244,6 +407,22 @@ public:
 
     MbedCloudClient &get_cloud_client() { return _cloud_client; }
 
+    /* objects and resources sent in the registration */
+    unsigned registration_objects() { return _objects.size(); }
+    unsigned registration_resources() { return _reg_resources; }
+
+    /* estimated size of the resource links in the registration, in bytes */
+    size_t registration_size() { return _reg_size; }
+
+    /* time from call_register() to the last registration, in ms */
+    uint32_t registration_ms() { return _reg_ms; }
+
+    /* registration updates sent by resume(), those that restored the
+     * registration, and the time the last one took, in ms */
+    uint32_t resumes() { return _resumes; }
+    uint32_t resumed() { return _resumed; }
+    uint32_t resume_ms() { return _resume_ms; }
+
     void on_registered(void *context, void (*callback)(void *))
     {
         _on_registered_cb = callback;
@@ -283,6 +462,15 @@ public:
         _on_resource_updated_context = context;
     }
 
+    /* reports whether each notification of a resource reached the
+     * server.  the callback runs on the mbed client thread. */
+    void on_delivery(enum M2MClientResource resource, void *context,
+                     void (*callback)(void *context, bool delivered));
+
+    /* whether the server observes a resource, without which its values
+     * are never notified */
+    bool is_observed(enum M2MClientResource resource);
+
     void update_authorize(int32_t request)
     {
         switch (request) {
@@ -313,6 +501,43 @@ public:
     void set_resource_value(enum M2MClientResource resource,
                             const std::string &val);
 
+    /*
+     * typed values of numeric resources.  the setters write val only if it
+     * differs from the current value and return whether it did, so a value
+     * that didn't change costs neither a copy nor a notification.
+     */
+    bool set_float(M2MResource *res, float val, int precision);
+    bool set_float(enum M2MClientResource resource, float val, int precision);
+    bool set_int(M2MResource *res, int32_t val);
+    bool set_int(enum M2MClientResource resource, int32_t val);
+
+    /* writes a text value only if it differs from the current one, and
+     * returns whether it did, like the typed setters */
+    bool set_text(enum M2MClientResource resource, const char *val,
+                  size_t len);
+
+    /* returns the value of a numeric resource, 0 if it has none */
+    float get_float(M2MResource *res);
+    float get_float(enum M2MClientResource resource);
+
+    /*
+     * update batches.  values written between begin_update() and the
+     * matching end_update() are held back, a value written twice is only
+     * sent once, and end_update() writes them all in one burst.  batches
+     * nest, and until the batch ends, reads return the previous values.
+     */
+    void begin_update();
+    void end_update();
+
+    /* values passed to mbed client, each notifies the observers */
+    uint32_t notifications() { return _notifications; }
+    /* writes skipped as the resource already held the value */
+    uint32_t unchanged() { return _unchanged; }
+    /* writes replaced by a later one in the same batch */
+    uint32_t coalesced() { return _coalesced; }
+    /* batches that sent at least one value */
+    uint32_t bursts() { return _bursts; }
+
     void set_fota_download_requested();
     bool is_fota_download_requested();
 
@@ -320,26 +545,62 @@ public:
     bool is_fota_install_requested();
 
 private:
-    struct resource_entry {
+    /* our resources, indexed by M2MClientResource, NULL if not built */
+    M2MResource *_res[M2MClientResourceCount];
+
+    /* the objects holding them, each listed once */
+    M2MObjectList _objects;
+
+    unsigned _reg_resources;
+    size_t _reg_size;
+    uint32_t _reg_start_us;
+    uint32_t _reg_ms;
+
+    struct pending_value {
         M2MResource *res;
-        enum M2MClientResource type;
+        uint8_t len;
+        char val[M2MCLIENT_BATCH_VALUE_LEN];
     };
 
-    /* our objects */
-    std::map<std::string, struct resource_entry> _res_map;
+    /* values written in the current batch, in order */
+    struct pending_value _pending[M2MCLIENT_BATCH_MAX];
+    unsigned _pending_count;
+    unsigned _batch_depth;
+
+    uint32_t _notifications;
+    uint32_t _unchanged;
+    uint32_t _coalesced;
+    uint32_t _bursts;
+
+    /* last use of the connection, see mark_traffic() */
+    uint32_t _traffic_us;
+    uint32_t _gap_ms;
+
+    /* last confirmation of the registration by the server */
+    uint32_t _alive_us;
+
+    uint32_t _resume_start_us;
+    uint32_t _resume_ms;
+    uint32_t _resumes;
+    uint32_t _resumed;
 
     MbedCloudClient _cloud_client;
 
-    int _flags;
+    /* set from both the event queue and the thread of mbed client */
+    volatile int _flags;
 
     void set_flag(int flag)
     {
+        core_util_critical_section_enter();
         _flags |= flag;
+        core_util_critical_section_exit();
     }
 
     void clear_flag(int flag)
     {
+        core_util_critical_section_enter();
         _flags &= ~flag;
+        core_util_critical_section_exit();
     }
 
     int test_flag(int flag)
@@ -363,26 +624,48 @@ private:
                                     M2MClient::M2MClientResource resource);
     void *_on_resource_updated_context;
 
-    /* adds a resource to the internal object map */
-    void add_resource(M2MResource *res, enum M2MClientResource type);
+    void (*_on_delivery_cb)(void *context, bool delivered);
+    void *_on_delivery_context;
+
+    /* passes the notification status of a resource to _on_delivery_cb */
+    static void delivery_status(const M2MBase &base,
+                                const M2MBase::NotificationDeliveryStatus status,
+                                void *client_args);
+
+    /* returns the value of res held back by the batch, or NULL */
+    struct pending_value *find_pending(M2MResource *res);
+
+    /* holds a value back until the batch ends, returns false if it can't
+     * and the value has to be written now */
+    bool defer_value(M2MResource *res, const char *val, size_t len);
+
+    /* records that the connection is in use */
+    void mark_traffic()
+    {
+        uint32_t now = us_ticker_read();
 
-    /* adds the M2M app resources to the internal object map */
-    int add_app_resources();
+        _gap_ms = (now - _traffic_us) / 1000;
+        _traffic_us = now;
+    }
 
-    /* adds the M2M Geo and GeoSensor resources to the internal object map */
-    int add_geo_resources();
+    /* records that the server holds the registration */
+    void confirm()
+    {
+        _alive_us = us_ticker_read();
+        set_flag(M2MCLIENT_F_CONFIRMED);
+    }
 
-    /* resource adders for each supported sensor type */
-    int add_light_sensor();
-    int add_temp_sensor();
-    int add_humidity_sensor();
-    int add_network_sensor();
+    /* passes a value to mbed client */
+    void write_value(M2MResource *res, const char *val, size_t len);
+
+    /* writes a formatted value unless the resource already holds it */
+    bool set_changed_value(M2MResource *res, const char *val, size_t len);
+
+    /* returns the object created with the given name, or NULL */
+    M2MObject *find_object(const char *name);
 
     /* registers all objects with the underlying MbedCloudClient */
     void register_objects();
-
-    struct resource_entry *get_resource_entry(const char *uri_path);
-    struct resource_entry *get_resource_entry(enum M2MClientResource type);
 };
 
 #endif /* M2MCLIENT_H */
@@ -24,31 +24,50 @@
 #include <mbed.h>
 #include "compat.h"
 
+#include "calibration.h"
 #include "commander.h"
 #include "displayman.h"
+#include "fixedfmt.h"
 #include "fs.h"
+#include "hampel.h"
+#include "history.h"
+#include "keepalive.h"
 #include "keystore.h"
 #include "lcdprogress.h"
 #include "m2mclient.h"
+#include "reconnect.h"
+#include "schedstats.h"
+#include "senml.h"
+#include "sensorstats.h"
+#include "simsensor.h"
+#include "soundbands.h"
+#include "soundlevel.h"
+#include "tls_session.h"
+#include "uplink.h"
 
 #include "rapidjson/allocators.h"
 #include "rapidjson/document.h"
+#include "rapidjson/reader.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
 
 #include <algorithm> /* std::min */
 #include <errno.h>
+#include <limits.h>
 #include <factory_configurator_client.h>
 #include <fcc_defs.h>
 #include <mbed_stats.h>
 #include <mbedtls/sha256.h>
 #include <mbed-trace-helper.h>
 #include <mbed-trace/mbed_trace.h>
+#include <time.h>
+#include <vector>
 
 #include <OdinWiFiInterface.h>
 
+#include "Microphone.h"
+#include "SHT3x.h"
 #include "TSL2591.h"
-#include "Sht31/Sht31.h"
 
 #define TRACE_GROUP "main"
 
@@ -87,10 +106,155 @@ namespace json = rapidjson;
 #define GEO_LONG_KEY "geo.long"
 #define GEO_ACCURACY_KEY "geo.accuracy"
 
+/* longest key and text value taken by the config resource */
+#define CONFIG_KEY_LEN 32
+#define CONFIG_TEXT_LEN 64
+
+/* longest time in seconds taken by the config resource, fits an int in ms */
+#define CONFIG_SECS_MAX (INT_MAX / 1000)
+
 #ifndef MBED_CONF_APP_MAX_REPORTED_APS
 #define MBED_CONF_APP_MAX_REPORTED_APS 8
 #endif
 
+#define SENSORS_WINDOW_KEY "sensors.window"
+
+#ifndef MBED_CONF_APP_SENSORS_WINDOW_SECS
+#define MBED_CONF_APP_SENSORS_WINDOW_SECS 60
+#endif
+
+/* per-channel reporting keys, prefixed with the channel key, ie "temp.pmax" */
+#define SENSOR_DEADBAND_KEY ".deadband"
+#define SENSOR_DEADBAND_PCT_KEY ".deadband_pct"
+#define SENSOR_PMIN_KEY ".pmin"
+#define SENSOR_PMAX_KEY ".pmax"
+#define SENSOR_CAL_KEY ".cal"
+#define SENSOR_SAMPLE_MIN_KEY ".sample_min"
+#define SENSOR_SAMPLE_MAX_KEY ".sample_max"
+#define SENSOR_FILTER_KEY ".filter"
+
+/* samples further than this many deviations from the median are dropped */
+#ifndef MBED_CONF_APP_SENSORS_FILTER_K
+#define MBED_CONF_APP_SENSORS_FILTER_K 3
+#endif
+
+#ifndef MBED_CONF_APP_SENSORS_PMAX_SECS
+#define MBED_CONF_APP_SENSORS_PMAX_SECS 300
+#endif
+
+/* readings queued while offline are sent at most this often... */
+#ifndef MBED_CONF_APP_UPLINK_DRAIN_MS
+#define MBED_CONF_APP_UPLINK_DRAIN_MS 2000
+#endif
+
+/* ...and at most this many at a time */
+#ifndef MBED_CONF_APP_UPLINK_PACK_SAMPLES
+#define MBED_CONF_APP_UPLINK_PACK_SAMPLES 16
+#endif
+
+#define UPLINK_PACK_SIZE 1024
+
+/* a pack whose delivery isn't reported within this time is sent again */
+#ifndef MBED_CONF_APP_UPLINK_DELIVERY_MS
+#define MBED_CONF_APP_UPLINK_DELIVERY_MS 30000
+#endif
+
+/* network and cloud retries back off from this delay... */
+#ifndef MBED_CONF_APP_RECONNECT_BASE_MS
+#define MBED_CONF_APP_RECONNECT_BASE_MS 1000
+#endif
+
+/* ...up to this one */
+#ifndef MBED_CONF_APP_RECONNECT_MAX_MS
+#define MBED_CONF_APP_RECONNECT_MAX_MS 60000
+#endif
+
+/* seconds between samples of the runtime telemetry */
+#ifndef MBED_CONF_APP_TELEMETRY_SECS
+#define MBED_CONF_APP_TELEMETRY_SECS 60
+#endif
+
+/* threads whose stacks are published at most */
+#define TELEMETRY_THREADS 8
+
+/* "<thread>:<peak>/<size>" for every thread */
+#define TELEMETRY_STACKS_SIZE (TELEMETRY_THREADS * 32)
+
+/* checks of a cloud outage before the network is restarted */
+#define RECONNECT_CLOUD_CHECKS 6
+
+/* events pending on the network event queue at most */
+#define NET_EVQ_EVENTS 8
+
+/* events pending on the history event queue at most */
+#define HISTORY_EVQ_EVENTS 2
+
+/* stack of the thread writing the history log, the filesystem needs more
+ * than the default */
+#define HISTORY_THREAD_STACK_SIZE 2048
+
+/* the shortest sampling interval, and how soon a sampling task tries a
+ * channel again whose read failed or is still in flight, see
+ * sensors_sample() */
+#define SENSORS_SAMPLE_TICK_MS 250
+
+/* large enough for the summary of every scheduled task and channel */
+#define SCHED_STATS_SIZE 768
+
+/* large enough for one SenML-CBOR record per sensor channel */
+#define SENSORS_PACK_SIZE 256
+
+/* replaces the sensor drivers with traces or synthetic waveforms */
+#ifndef MBED_CONF_APP_SENSORS_SIMULATED
+#define MBED_CONF_APP_SENSORS_SIMULATED 0
+#endif
+
+/* virtual time between replayed samples, see cmd_cb_sim() */
+#define SIM_REPLAY_STEP_MS 1000
+
+/* samples replayed per event, so the periodic tasks run in between */
+#define SIM_REPLAY_CHUNK 32
+
+/* light, temperature and humidity */
+#define SIM_REPLAY_CHANNELS 3
+
+/* sensors are read with asynchronous I2C transfers where the target has them */
+#if DEVICE_I2C_ASYNCH && !MBED_CONF_APP_SENSORS_SIMULATED
+#define SENSORS_I2C_ASYNCH 1
+#else
+#define SENSORS_I2C_ASYNCH 0
+#endif
+
+/* an asynchronous sensor transfer is abandoned after this long */
+#define SENSORS_I2C_TIMEOUT_MS 100
+
+/* samples an analog microphone for the sound channel */
+#ifndef MBED_CONF_APP_SOUND_ENABLED
+#define MBED_CONF_APP_SOUND_ENABLED 0
+#endif
+
+/* the ADC input the microphone is connected to */
+#ifndef MBED_CONF_APP_SOUND_PIN
+#define MBED_CONF_APP_SOUND_PIN A0
+#endif
+
+#define SOUND_BANDS_KEY "sound.bands"
+
+/* seconds between octave band vectors, 0 to disable the band analysis */
+#ifndef MBED_CONF_APP_SOUND_BANDS_SECS
+#define MBED_CONF_APP_SOUND_BANDS_SECS 60
+#endif
+
+/* longest band period, keeps the band energies within 64 bits */
+#define SOUND_BANDS_MAX_SECS 3600
+
+/* "<63 Hz>,...,<4 kHz>" in whole dB */
+#define SOUND_BANDS_STRLEN (SOUND_BANDS * 5)
+
+#if MIC_BLOCK_SAMPLES != SOUND_FFT_SIZE
+#error "the band analysis needs one microphone block per frame"
+#endif
+
 #define JSON_MEM_POOL_INC 64
 
 #define WEM_VERBOSE_PRINTF(type, fmt, ...) \
@@ -107,25 +271,285 @@ enum WEM_THREADS {
     WEM_THREAD_COUNT
 };
 
-struct dht_sensor {
-    uint8_t h_id;
-    uint8_t t_id;
-    Sht31 *sensor;
+enum SENSOR_CHANNELS {
+    SENSOR_CHANNEL_LIGHT = 0,
+    SENSOR_CHANNEL_TEMP,
+    SENSOR_CHANNEL_HUMIDITY,
+#if MBED_CONF_APP_SOUND_ENABLED
+    SENSOR_CHANNEL_SOUND,
+#endif
+    SENSOR_CHANNEL_COUNT
+};
 
-    M2MResource *h_res;
-    M2MResource *t_res;
+/* periodic tasks on the event queue, timed by sched_task_run() */
+enum SCHED_TASKS {
+    SCHED_TASK_LIGHT = 0,
+    SCHED_TASK_DHT,
+    SCHED_TASK_REPORT,
+    SCHED_TASK_UPLINK,
+#if MBED_CONF_APP_SOUND_ENABLED
+    SCHED_TASK_SOUND,
+#endif
+    SCHED_TASK_COUNT
 };
 
-struct light_sensor {
+/* runtime counters published in the telemetry object */
+enum TELEMETRY_METRICS {
+    TELEMETRY_HEAP_USED = 0,
+    TELEMETRY_HEAP_PEAK,
+    TELEMETRY_HEAP_FAILS,
+    /* the stack peaks of all threads, compared as text */
+    TELEMETRY_STACK_PEAKS,
+    TELEMETRY_EVENT_LATENCY,
+    TELEMETRY_SENSOR_JITTER,
+    TELEMETRY_RECONNECTS,
+    TELEMETRY_UPTIME,
+    TELEMETRY_METRIC_COUNT
+};
+
+/* how a value written to the config resource is checked */
+enum CONFIG_VALUE_TYPES {
+    CONFIG_VALUE_TEXT = 0,
+    CONFIG_VALUE_SECURITY,
+    CONFIG_VALUE_NUMBER,
+    CONFIG_VALUE_UINT,
+    CONFIG_VALUE_CALIBRATION,
+};
+
+/* what is reloaded once a config write is saved */
+#define CONFIG_APPLY_LABEL      (1 << 0)
+#define CONFIG_APPLY_GEO        (1 << 1)
+#define CONFIG_APPLY_SENSORS    (1 << 2)
+
+/* a keystore key that can be written through the config resource */
+struct config_key {
+    /* the key, or the option of every sensor channel if it starts with a
+     * '.', ie ".pmax" for "temp.pmax" */
+    const char *key;
+    enum CONFIG_VALUE_TYPES type;
+    /* the range of a whole number, or the longest text */
+    uint32_t min;
+    uint32_t max;
+    int apply;
+};
+
+/* the status of a key written through the config resource */
+struct config_status {
+    std::string key;
+    const char *status;
+};
+
+/* controls when a new sample is sent to mbed cloud (pmin/pmax semantics) */
+struct sensor_report_cfg {
+    /* minimum absolute change from the last reported value */
+    float deadband;
+    /* minimum change relative to the last reported value, in percent */
+    float deadband_pct;
+    /* minimum time between reports, in ms */
+    uint32_t pmin_ms;
+    /* a report is forced after this many ms, 0 to disable */
+    uint32_t pmax_ms;
+};
+
+/* bounds of the adaptive sampling interval, in ms */
+struct sensor_sample_cfg {
+    uint32_t min_ms;
+    uint32_t max_ms;
+};
+
+/* a single measured quantity published to the display and mbed cloud */
+struct sensor_channel {
+    /* one of SENSOR_CHANNELS */
     uint8_t id;
-    TSL2591 *sensor;
+    const char *name;
+    /* prefix for the keystore options of this channel */
+    const char *key;
+    uint8_t display_id;
+    /* number of decimal places used when publishing aggregates */
+    int precision;
+    /* 10^precision, used to store samples as fixed point */
+    int32_t scale;
+
     M2MResource *res;
+    M2MResource *min_res;
+    M2MResource *max_res;
+    M2MResource *cal_res;
+    M2MResource *sample_res;
+
+    /* the task that samples this channel */
+    struct sched_task *task;
+    struct sensor_sampler *sampler;
+    /* set on the copies used by a replay, whose samples are neither stored,
+     * shown nor published, see cmd_cb_sim() */
+    bool scratch;
+
+    /* adaptive sampling, see sensor_channel_adapt() */
+    struct sensor_sample_cfg sample;
+    struct sensor_sample_cfg sample_defaults;
+    uint32_t sample_ms;
+    unsigned next_sample_tick;
+    unsigned last_sample_tick;
+    float last_sample;
+    bool sampled;
+    uint32_t samples;
+
+    /* outlier rejection, disabled if filter_k is 0 */
+    struct hampel filter;
+    float filter_k;
+    uint32_t rejected;
+
+    /* applied to raw readings before they are published */
+    struct calibration cal;
+    const char *cal_default;
+
+    /* statistics for the current reporting window */
+    struct sensor_stats stats;
+
+    /* change-threshold reporting */
+    struct sensor_report_cfg report;
+    struct sensor_report_cfg report_defaults;
+    bool reported;
+    float last_reported;
+    unsigned last_report_tick;
+    uint32_t sent;
+    uint32_t queued;
+    uint32_t suppressed;
+};
+
+struct dht_sensor {
+    SHT3x *sensor;
+    struct sensor_channel temp;
+    struct sensor_channel humidity;
+};
+
+struct light_sensor {
+    TSL2591 *sensor;
+    struct sensor_channel lux;
+};
+
+#if MBED_CONF_APP_SOUND_ENABLED
+struct sound_sensor {
+    Microphone *mic;
+    /* A-weighted level of the blocks since the last sample */
+    struct sound_level level;
+    struct sensor_channel spl;
+    /* flat level of the last sample, in hundredths of a dB full scale */
+    int32_t flat_cdb;
+    uint32_t blocks;
+    /* octave band energies since the last band vector */
+    struct sound_bands bands;
+    uint32_t bands_ms;
+    unsigned bands_next_tick;
+    /* the last published band vector */
+    char bands_str[SOUND_BANDS_STRLEN];
+};
+#endif
+
+/* store-and-forward of readings taken while mbed cloud is unreachable */
+struct uplink {
+    UplinkQueue queue;
+    /* packs delivered, and packs sent again as they weren't */
+    uint32_t packs;
+    uint32_t resent;
+    /* when the pack in flight was sent */
+    unsigned sent_tick;
+    /* set while a backlog is being sent */
+    bool draining;
+    unsigned drain_start_tick;
+    uint32_t drain_start_count;
+    /* readings per second achieved by the last completed drain */
+    float drain_rate;
+};
+
+struct telemetry_metric {
+    enum M2MClient::M2MClientResource resource;
+    /* smallest change that is published */
+    uint32_t deadband;
+    uint32_t published;
+    bool valid;
+};
+
+/* slow-cadence runtime counters, see telemetry_publish() */
+struct telemetry {
+    struct telemetry_metric metrics[TELEMETRY_METRIC_COUNT];
+    /* when the event queue latency probe was posted, in us */
+    uint32_t probe_us;
+    uint32_t samples;
+    uint32_t updates;
+    uint32_t suppressed;
+};
+
+/* a sampling task and the channels it reads, see sensors_sample() */
+struct sensor_sampler {
+    struct sched_task *task;
+    struct sensor_channel *a;
+    /* the second channel of a combo sensor, or NULL */
+    struct sensor_channel *b;
+    /* the next run, 0 while sampling is stopped */
+    int evq_id;
 };
 
 struct sensors {
-    int event_queue_id_light, event_queue_id_dht;
+    int event_queue_id_report, event_queue_id_uplink;
+    struct sensor_sampler light_sampler;
+    struct sensor_sampler dht_sampler;
+    /* aggregates are published once per window */
+    int window_secs;
     struct dht_sensor dht;
     struct light_sensor light;
+#if MBED_CONF_APP_SOUND_ENABLED
+    struct sound_sensor sound;
+#endif
+    struct sensor_channel *channels[SENSOR_CHANNEL_COUNT];
+    struct sched_task tasks[SCHED_TASK_COUNT];
+    /* set when a channel has reported since the last pack was sent */
+    bool pack_pending;
+    /* SenML base name, "urn:dev:mac:<mac>:" */
+    char pack_base_name[32];
+};
+
+#if MBED_CONF_APP_SENSORS_SIMULATED
+enum SIM_STAGES {
+    SIM_STAGE_SOURCE = 0,
+    SIM_STAGE_CALIBRATE,
+    SIM_STAGE_UPDATE,
+    SIM_STAGE_PACK,
+    SIM_STAGE_COUNT
+};
+
+/* a replay in progress, see cmd_cb_sim() */
+struct sim_replay {
+    struct sim_source src;
+    /* copies of the live sensors, which the replay leaves alone */
+    struct light_sensor light;
+    struct dht_sensor dht;
+    struct sensor_channel *channels[SIM_REPLAY_CHANNELS];
+    uint32_t samples;
+    uint32_t done;
+    uint32_t step_ms;
+    /* virtual time of the next sample */
+    unsigned tick;
+    /* time spent replaying, without the events run in between */
+    uint32_t elapsed_us;
+    struct sched_histogram stages[SIM_STAGE_COUNT];
+};
+
+/* stands in for the sensor drivers */
+struct sim {
+    /* read by the periodic sensor tasks */
+    struct sim_source live;
+    /* set from cmd_cb_sim() until sim_replay_run() has finished */
+    bool replaying;
+    struct sim_replay replay;
+};
+#endif
+
+/* SenML units, indexed by SENSOR_CHANNELS */
+static const char *sensor_senml_units[SENSOR_CHANNEL_COUNT] = {
+    "lx", "Cel", "%RH",
+#if MBED_CONF_APP_SOUND_ENABLED
+    "dB",
+#endif
 };
 
 // ****************************************************************************
@@ -136,13 +560,39 @@ static M2MClient *m2mclient;
 static NetworkInterface *net;
 static EventQueue evq;
 static struct sensors sensors;
+static SensorHistory history;
+static struct uplink uplink;
+static struct keepalive keepalive;
+static struct reconnect reconnect;
+static struct telemetry telemetry;
+/* network recovery runs here, off the main event queue */
+static EventQueue net_evq(NET_EVQ_EVENTS * EVENTS_EVENT_SIZE);
+/* set while a recovery is scheduled on net_evq */
+static bool net_recovering;
+/* history log writes run here, below the priority of the sampling tasks */
+static EventQueue history_evq(HISTORY_EVQ_EVENTS * EVENTS_EVENT_SIZE);
+static Thread history_thread(osPriorityBelowNormal, HISTORY_THREAD_STACK_SIZE,
+                             NULL, "history");
+/* when the keep-alive was started, for the update rate */
+static unsigned keepalive_start_tick;
+#if MBED_CONF_APP_SENSORS_SIMULATED
+static struct sim sim;
+#endif
 /* used to stop auto display refresh during firmware downloads */
 static int display_evq_id;
 static bool wem_sensors_verbose_enabled = false;
 
 static I2C i2c(I2C_SDA, I2C_SCL);
 static TSL2591 tsl2591(i2c, TSL2591_ADDR);
-static Sht31 sht31(I2C_SDA, I2C_SCL);
+static SHT3x sht3x(i2c, SHT3X_ADDR);
+#if MBED_CONF_APP_SOUND_ENABLED
+static Microphone mic(MBED_CONF_APP_SOUND_PIN);
+#endif
+/* the sensor whose asynchronous transfer holds the I2C bus, if any */
+static const void *i2c_owner;
+#if SENSORS_I2C_ASYNCH
+static unsigned i2c_start_tick;
+#endif
 
 //our serial interface cli class
 Commander cmd;
@@ -155,6 +605,12 @@ Commander cmd;
  */
 static void display_refresh(DisplayMan *display)
 {
+    /* the display is on the same I2C bus as the sensors, try again on the
+     * next refresh rather than collide with a sensor transfer */
+    if (NULL != i2c_owner) {
+        return;
+    }
+
     display->refresh();
 }
 
@@ -171,134 +627,1405 @@ static void set_app_label(M2MClient *m2m, const char *label)
 // Sensors
 // ****************************************************************************
 /**
- * Inits the light sensor object
+ * Inits a sensor channel and registers it with the display
  */
-static void light_init(struct light_sensor *s, M2MClient *mbed_client)
+static void sensor_channel_init(struct sensor_channel *ch,
+                                M2MClient *mbed_client,
+                                enum SENSOR_CHANNELS id,
+                                const char *name,
+                                const char *key,
+                                enum INDICATOR_TYPES indicator,
+                                int precision,
+                                const struct sensor_report_cfg *report,
+                                const struct sensor_sample_cfg *sample,
+                                const char *cal,
+                                M2MClient::M2MClientResource value,
+                                M2MClient::M2MClientResource min,
+                                M2MClient::M2MClientResource max,
+                                M2MClient::M2MClientResource cal_res,
+                                M2MClient::M2MClientResource sample_res)
 {
-    /* add to the display */
-    s->id = display.register_sensor("Light", IND_LIGHT);
+    ch->id = id;
+    ch->name = name;
+    ch->key = key;
+    ch->precision = precision;
+    ch->scale = fixed_scale(precision);
+    ch->display_id = display.register_sensor(name, indicator);
+    ch->scratch = false;
+    ch->sampler = NULL;
+    ch->report_defaults = *report;
+    ch->report = *report;
+    ch->cal_default = cal;
+    calibration_identity(&ch->cal);
+    ch->reported = false;
+    ch->sent = 0;
+    ch->queued = 0;
+    ch->suppressed = 0;
+    ch->sample_defaults = *sample;
+    ch->sample = *sample;
+    ch->sample_ms = sample->min_ms;
+    ch->next_sample_tick = 0;
+    ch->last_sample_tick = 0;
+    ch->sampled = false;
+    ch->samples = 0;
+    hampel_reset(&ch->filter);
+    ch->filter_k = MBED_CONF_APP_SENSORS_FILTER_K;
+    ch->rejected = 0;
+
+    ch->res = mbed_client->get_resource(value);
+    ch->min_res = mbed_client->get_resource(min);
+    ch->max_res = mbed_client->get_resource(max);
+    ch->cal_res = mbed_client->get_resource(cal_res);
+    ch->sample_res = mbed_client->get_resource(sample_res);
+
+    sensor_stats_reset(&ch->stats);
 
-    /* init the driver */
-    s->sensor = &tsl2591;
-    s->sensor->init();
-    s->sensor->enable();
+    /* set default values */
+    display.set_sensor_status(ch->display_id, "0");
+    mbed_client->set_float(ch->res, 0.0f, ch->precision);
+}
+
+/**
+ * Parses a whole number within [min, max]
+ *
+ * The config resource and the keystore loaders take the same numbers, so a
+ * key set from the console can't overflow once it is turned into ms.
+ *
+ * @return true if str is such a number, with it in val
+ */
+static bool config_parse_uint(const char *str, uint32_t min, uint32_t max,
+                              uint32_t *val)
+{
+    unsigned long n;
+    size_t len = strlen(str);
+
+    if (0 == len || strspn(str, "0123456789") != len) {
+        return false;
+    }
+    errno = 0;
+    n = strtoul(str, NULL, 10);
+    if (0 != errno || n < min || n > max) {
+        return false;
+    }
+    *val = n;
+
+    return true;
+}
+
+/**
+ * Reads a whole number within [min, max] from the keystore into val
+ *
+ * A key set to anything else is ignored with a warning.
+ *
+ * @return true if val was read
+ */
+static bool keystore_get_uint(Keystore &k, std::string key, uint32_t min,
+                              uint32_t max, uint32_t *val)
+{
+    std::string str;
 
-    s->res = m2mclient->get_resource(M2MClient::M2MClientResourceLightValue);
-    m2mclient->set_resource_value(s->res, "0", 1);
+    if (!k.exists(key)) {
+        return false;
+    }
+    str = k.get(key);
+    if (!config_parse_uint(str.c_str(), min, max, val)) {
+        cmd.printf("WARN: invalid %s (%s), using default\n", key.c_str(),
+                   str.c_str());
+        return false;
+    }
+
+    return true;
 }
 
 /**
- * Converts light sensor reading to Lux units
+ * Checks the sampling interval bounds of a channel
  *
- * Empirical measurement against a light meter under 17
- * different lighting conditions led to the following
- * conversion table
- * Reading     Lux
- * 0.128          392
- * 0.211          767
- * 0.264         1145
- * 0.292         1294
- * 0.317         1407
- * 0.349         1665
- * 0.402         1959
- * 0.457         2580
- * 0.517         2690
- * 0.570         3540
- * 0.592         3770
- * 0.628         4310
- * 0.702         5040
- * 0.816         5880
- * 0.856         6150
- * 0.917         7610
- * 0.958         8330
+ * @return 0 if the bounds are usable, nonzero otherwise
+ */
+static int sensor_sample_cfg_check(const struct sensor_sample_cfg *cfg)
+{
+    if (cfg->min_ms < SENSORS_SAMPLE_TICK_MS || cfg->max_ms < cfg->min_ms) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Parses sampling interval bounds in the "<min-ms>,<max-ms>" form
  *
- * This data is best fit by the power equation
- * Lux = 8251*(reading)^1.5108
- * This equation fits with an R^2 value of 0.9962
+ * @return 0 on success, nonzero if the string or the bounds are invalid
  */
+static int sensor_sample_cfg_parse(struct sensor_sample_cfg *cfg,
+                                   const char *str)
+{
+    char *end;
+    struct sensor_sample_cfg parsed;
 
-unsigned int light_sensor_to_lux(float reading) {
-    return lroundf(8250.0 * pow(reading, 1.51));
+    parsed.min_ms = strtoul(str, &end, 10);
+    if (end == str || ',' != *end) {
+        return -1;
+    }
+    str = end + 1;
+    parsed.max_ms = strtoul(str, &end, 10);
+    if (end == str || '\0' != *end) {
+        return -1;
+    }
+
+    if (0 != sensor_sample_cfg_check(&parsed)) {
+        return -1;
+    }
+
+    *cfg = parsed;
+
+    return 0;
 }
 
+static void sensors_sample_schedule(struct sensor_sampler *s);
+
 /**
- * Reads a value from the light sensor and publishes to the display
+ * Applies new sampling interval bounds to a channel and publishes them
  */
-static void light_read(struct light_sensor *s)
+static void sensor_channel_set_sample_cfg(struct sensor_channel *ch,
+                                          const struct sensor_sample_cfg *cfg)
 {
-    size_t size;
-    char res_buffer[33] = {0};
-    unsigned int lux;
+    int len;
+    char buf[24];
+
+    ch->sample = *cfg;
+    ch->sample_ms = std::min(std::max(ch->sample_ms, cfg->min_ms),
+                             cfg->max_ms);
+    ch->next_sample_tick = ch->last_sample_tick + ch->sample_ms;
+
+    /* the next run may be due sooner now */
+    if (NULL != ch->sampler && 0 != ch->sampler->evq_id) {
+        evq.cancel(ch->sampler->evq_id);
+        sensors_sample_schedule(ch->sampler);
+    }
 
-    s->sensor->getALS();
-    s->sensor->calcLux();
-    //light sensor uses a multiplier to adjust for the lightpipe
-    lux = s->sensor->lux*3.7;
-    WEM_VERBOSE_PRINTF(sensors, "light: %u\n", lux);
-    size = snprintf(res_buffer, sizeof(res_buffer), "%u lux", lux);
+    len = snprintf(buf, sizeof(buf), "%lu,%lu",
+                   (unsigned long)cfg->min_ms, (unsigned long)cfg->max_ms);
+    m2mclient->set_resource_value(ch->sample_res, buf, len);
+}
+
+/**
+ * Reads the reporting period and sampling interval bounds of a channel
+ * from the keystore, leaves those that aren't set alone
+ */
+static void sensor_channel_read_bounds(const struct sensor_channel *ch,
+                                       Keystore &k,
+                                       struct sensor_report_cfg *cfg,
+                                       struct sensor_sample_cfg *sample)
+{
+    uint32_t secs;
+
+    if (keystore_get_uint(k, std::string(ch->key) + SENSOR_PMIN_KEY, 0,
+                          CONFIG_SECS_MAX, &secs)) {
+        cfg->pmin_ms = secs * 1000;
+    }
+
+    if (keystore_get_uint(k, std::string(ch->key) + SENSOR_PMAX_KEY, 0,
+                          CONFIG_SECS_MAX, &secs)) {
+        cfg->pmax_ms = secs * 1000;
+    }
+
+    keystore_get_uint(k, std::string(ch->key) + SENSOR_SAMPLE_MIN_KEY,
+                      SENSORS_SAMPLE_TICK_MS, UINT_MAX, &sample->min_ms);
+    keystore_get_uint(k, std::string(ch->key) + SENSOR_SAMPLE_MAX_KEY,
+                      SENSORS_SAMPLE_TICK_MS, UINT_MAX, &sample->max_ms);
+}
+
+/**
+ * Reads the calibration table of a channel from the keystore and publishes
+ * it in the channel's calibration resource
+ */
+static void sensor_channel_load_cal(struct sensor_channel *ch, Keystore &k)
+{
+    std::string key;
+    std::string cal;
+
+    key = std::string(ch->key) + SENSOR_CAL_KEY;
+    cal = ch->cal_default;
+    if (k.exists(key)) {
+        cal = k.get(key);
+        if (0 != calibration_parse(&ch->cal, cal.c_str())) {
+            cmd.printf("WARN: invalid %s, using default\n", key.c_str());
+            cal = ch->cal_default;
+        }
+    }
+    calibration_parse(&ch->cal, cal.c_str());
+    m2mclient->set_resource_value(ch->cal_res, cal.c_str(), cal.length());
+}
+
+/**
+ * Reads the reporting options of a channel from the keystore
+ */
+static void sensor_channel_load_config(struct sensor_channel *ch, Keystore &k)
+{
+    std::string key;
+    struct sensor_sample_cfg sample;
+    struct sensor_report_cfg *cfg = &ch->report;
+
+    *cfg = ch->report_defaults;
+
+    key = std::string(ch->key) + SENSOR_DEADBAND_KEY;
+    if (k.exists(key)) {
+        cfg->deadband = fabsf(strtof(k.get(key).c_str(), NULL));
+    }
+
+    key = std::string(ch->key) + SENSOR_DEADBAND_PCT_KEY;
+    if (k.exists(key)) {
+        cfg->deadband_pct = fabsf(strtof(k.get(key).c_str(), NULL));
+    }
+
+    sample = ch->sample_defaults;
+    sensor_channel_read_bounds(ch, k, cfg, &sample);
+
+    if (cfg->pmax_ms != 0 && cfg->pmax_ms < cfg->pmin_ms) {
+        cmd.printf("WARN: %s pmax is less than pmin, ignoring pmax\n",
+                   ch->key);
+        cfg->pmax_ms = 0;
+    }
+
+    sensor_channel_load_cal(ch, k);
+
+    if (0 != sensor_sample_cfg_check(&sample)) {
+        cmd.printf("WARN: invalid %s sampling bounds, using defaults\n",
+                   ch->key);
+        sample = ch->sample_defaults;
+    }
+    sensor_channel_set_sample_cfg(ch, &sample);
+
+    ch->filter_k = MBED_CONF_APP_SENSORS_FILTER_K;
+    key = std::string(ch->key) + SENSOR_FILTER_KEY;
+    if (k.exists(key)) {
+        ch->filter_k = fabsf(strtof(k.get(key).c_str(), NULL));
+    }
+}
+
+/**
+ * Returns the smallest change of a channel that matters
+ *
+ * This is the smaller of the deadbands that are set, relative to ref for
+ * the percentage, or one digit at the published precision without any.
+ */
+static float sensor_channel_min_change(const struct sensor_channel *ch,
+                                       float ref)
+{
+    float threshold;
+    float pct_threshold;
+    const struct sensor_report_cfg *cfg = &ch->report;
+
+    threshold = 1.0f / ch->scale;
+    if (cfg->deadband > 0.0f) {
+        threshold = cfg->deadband;
+    }
+    pct_threshold = fabsf(ref) * cfg->deadband_pct / 100.0f;
+    if (pct_threshold > 0.0f &&
+        (cfg->deadband <= 0.0f || pct_threshold < threshold)) {
+        threshold = pct_threshold;
+    }
+
+    return threshold;
+}
+
+/**
+ * Returns true if a channel is due to be sampled
+ */
+static bool sensor_channel_due(const struct sensor_channel *ch, unsigned now)
+{
+    return (int)(now - ch->next_sample_tick) >= 0;
+}
+
+/**
+ * Adapts the sampling interval of a channel to how fast it is changing
+ *
+ * The next interval is chosen so that, at the rate of change since the
+ * previous sample, the value moves by about half a deadband.  It drops
+ * straight away when the value starts changing and at most doubles per
+ * sample once it settles, always within the channel's bounds.
+ */
+static void sensor_channel_adapt(struct sensor_channel *ch, float val,
+                                 unsigned now)
+{
+    float delta;
+    float target;
+    float threshold;
+    unsigned elapsed;
+
+    ch->samples++;
+
+    if (ch->sampled) {
+        threshold = sensor_channel_min_change(ch, ch->last_sample);
+        elapsed = now - ch->last_sample_tick;
+        delta = fabsf(val - ch->last_sample);
+        target = ch->sample.max_ms;
+        if (delta > 0.0f && threshold * elapsed / (2.0f * delta) < target) {
+            target = threshold * elapsed / (2.0f * delta);
+        }
+        if (target > 2.0f * ch->sample_ms) {
+            target = 2.0f * ch->sample_ms;
+        }
+
+        ch->sample_ms = std::max((uint32_t)target, ch->sample.min_ms);
+        ch->sample_ms = std::min(ch->sample_ms, ch->sample.max_ms);
+    }
+
+    ch->sampled = true;
+    ch->last_sample = val;
+    ch->last_sample_tick = now;
+    ch->next_sample_tick = now + ch->sample_ms;
+}
+
+/**
+ * Decides if a sample has changed enough to be sent to mbed cloud
+ *
+ * A sample is never sent sooner than pmin after the last report and is
+ * always sent once pmax has elapsed.  In between, it is only sent if it
+ * moved past the absolute or relative deadband.  With no deadband
+ * configured, any change is reported.
+ */
+static bool sensor_channel_should_report(struct sensor_channel *ch,
+                                         float val, unsigned now)
+{
+    float delta;
+    unsigned elapsed;
+    struct sensor_report_cfg *cfg = &ch->report;
+
+    if (!ch->reported) {
+        return true;
+    }
+
+    elapsed = now - ch->last_report_tick;
+    if (elapsed < cfg->pmin_ms) {
+        return false;
+    }
+
+    if (cfg->pmax_ms != 0 && elapsed >= cfg->pmax_ms) {
+        return true;
+    }
+
+    delta = fabsf(val - ch->last_reported);
+    if (cfg->deadband == 0.0f && cfg->deadband_pct == 0.0f) {
+        return delta > 0.0f;
+    }
+
+    if (cfg->deadband > 0.0f && delta >= cfg->deadband) {
+        return true;
+    }
+
+    if (cfg->deadband_pct > 0.0f &&
+        delta >= fabsf(ch->last_reported) * cfg->deadband_pct / 100.0f) {
+        return true;
+    }
+
+    return false;
+}
+
+/* statistics of a channel as strings, for printing */
+struct sensor_stats_str {
+    char mean[FIXED_STRLEN];
+    char stddev[FIXED_STRLEN];
+    char min[FIXED_STRLEN];
+    char max[FIXED_STRLEN];
+};
+
+/**
+ * Formats the statistics of a channel with two decimal places
+ */
+static void sensor_stats_format(const struct sensor_stats *stats,
+                                struct sensor_stats_str *str)
+{
+    fixed_format_float(str->mean, sizeof(str->mean), stats->mean, 2);
+    fixed_format_float(str->stddev, sizeof(str->stddev),
+                       sensor_stats_stddev(stats), 2);
+    fixed_format_float(str->min, sizeof(str->min), stats->min, 2);
+    fixed_format_float(str->max, sizeof(str->max), stats->max, 2);
+}
 
-    display.set_sensor_status(s->id, res_buffer);
-    m2mclient->set_resource_value(s->res, res_buffer, size);
+/**
+ * Writes the unsaved history samples to the log, on history_evq
+ */
+static void history_flush(void)
+{
+    history.flush();
 }
 
-/**
- * Inits the temp/humidity combo sensor
- */
-static void dht_init(struct dht_sensor *s, M2MClient *mbed_client)
-{
-    /* add to the display */
-    s->t_id = display.register_sensor("Temp", IND_TEMP);
-    s->h_id = display.register_sensor("Humidity", IND_HUMIDITY);
+/**
+ * Publishes a new sample on a sensor channel
+ *
+ * While the client isn't registered, samples that pass the reporting
+ * checks are queued and sent later by uplink_drain().
+ *
+ * @param ch The channel the sample was taken on.
+ * @param val The numeric value, used for aggregation and sent to mbed cloud.
+ * @param str The formatted value, with units, sent to the display.
+ * @param now The time the sample was taken, in ms.
+ * @return false if the sample was rejected as an outlier.
+ */
+static bool sensor_channel_update(struct sensor_channel *ch, float val,
+                                  const char *str, unsigned now)
+{
+    int32_t fixed;
+
+    /* a rejected sample isn't used at all, and as the channel is still
+     * due, it is sampled again on the next tick */
+    if (ch->filter_k > 0.0f &&
+        hampel_add(&ch->filter, val, ch->filter_k,
+                   sensor_channel_min_change(ch, hampel_median(&ch->filter)))) {
+        WEM_VERBOSE_PRINTF(sensors, "%s: rejected %s\n", ch->name, str);
+        ch->rejected++;
+        return false;
+    }
+
+    fixed = fixed_from_float(val, ch->precision);
+
+    sensor_stats_add(&ch->stats, val);
+    sensor_channel_adapt(ch, val, now);
+    if (!ch->scratch) {
+        if (history.add(ch->id, now / 1000, fixed)) {
+            history_evq.call(history_flush);
+        }
+        display.set_sensor_status(ch->display_id, str);
+    }
+
+    if (!sensor_channel_should_report(ch, val, now)) {
+        ch->suppressed++;
+        return true;
+    }
+
+    if (ch->scratch) {
+        /* counted as if it had been sent */
+        ch->sent++;
+    } else if (m2mclient->is_client_registered()) {
+        m2mclient->set_float(ch->res, val, ch->precision);
+        sched_task_published(ch->task);
+        sensors.pack_pending = true;
+        ch->sent++;
+    } else {
+        uplink.queue.push(ch->res->uri_path(), now / 1000, fixed,
+                          ch->precision);
+        ch->queued++;
+    }
+    ch->reported = true;
+    ch->last_reported = val;
+    ch->last_report_tick = now;
+
+    return true;
+}
+
+/**
+ * Publishes the aggregates for the current window and starts a new one
+ */
+static void sensor_channel_report(struct sensor_channel *ch)
+{
+    struct sensor_stats_str str;
+    struct sensor_stats *stats = &ch->stats;
+
+    if (0 == stats->count) {
+        return;
+    }
+
+    if (wem_sensors_verbose_enabled) {
+        sensor_stats_format(stats, &str);
+        cmd.printf("%s: n=%lu mean=%s stddev=%s min=%s max=%s\n",
+                   ch->name, stats->count, str.mean, str.stddev,
+                   str.min, str.max);
+    }
+
+    /* aggregates of a window spent offline are only kept in the history */
+    if (!m2mclient->is_client_registered()) {
+        sensor_stats_reset(stats);
+        return;
+    }
+
+    m2mclient->set_float(ch->min_res, stats->min, ch->precision);
+    m2mclient->set_float(ch->max_res, stats->max, ch->precision);
+
+    sensor_stats_reset(stats);
+}
+
+/**
+ * Writes the last reported value of the given channels as one SenML-CBOR pack
+ *
+ * The first record carries the base name and base time.  The base time is
+ * the RTC time if it has been set, otherwise 0, and every record has the
+ * age of its value as a relative time.
+ *
+ * @return The length of the pack, or -1 if it doesn't fit.
+ */
+static int sensors_write_pack(struct sensor_channel *const *channels,
+                              int n, unsigned now, uint8_t *pack,
+                              size_t size)
+{
+    int fields;
+    int count = 0;
+    int32_t age;
+    time_t rtc;
+    struct senml_writer w;
+    struct sensor_channel *ch;
+
+    for (int i = 0; i < n; i++) {
+        if (channels[i]->reported) {
+            count++;
+        }
+    }
+
+    /* SenML relative times are below 2^28 */
+    rtc = time(NULL);
+    if (rtc < (1 << 28)) {
+        rtc = 0;
+    }
+
+    senml_writer_init(&w, pack, size);
+    senml_write_array(&w, count);
+    count = 0;
+    for (int i = 0; i < n; i++) {
+        ch = channels[i];
+        if (!ch->reported) {
+            continue;
+        }
+
+        age = (now - ch->last_report_tick) / 1000;
+        fields = 3 + (0 == count ? 2 : 0) + (0 != age ? 1 : 0);
+        senml_write_map(&w, fields);
+        if (0 == count) {
+            senml_write_int(&w, SENML_LABEL_BASE_NAME);
+            senml_write_text(&w, sensors.pack_base_name);
+            senml_write_int(&w, SENML_LABEL_BASE_TIME);
+            senml_write_int(&w, rtc);
+        }
+        senml_write_int(&w, SENML_LABEL_NAME);
+        senml_write_text(&w, ch->res->uri_path());
+        senml_write_int(&w, SENML_LABEL_UNIT);
+        senml_write_text(&w, sensor_senml_units[ch->id]);
+        senml_write_int(&w, SENML_LABEL_VALUE);
+        senml_write_number(&w, ch->last_reported);
+        if (0 != age) {
+            senml_write_int(&w, SENML_LABEL_TIME);
+            senml_write_int(&w, -age);
+        }
+        count++;
+    }
+
+    return w.overflow ? -1 : (int)w.len;
+}
+
+/**
+ * Publishes the last reported value of every channel as one SenML-CBOR pack
+ */
+static void sensors_publish_pack(struct sensors *s)
+{
+    int len;
+    static uint8_t pack[SENSORS_PACK_SIZE];
+
+    if (!s->pack_pending || !m2mclient->is_client_registered()) {
+        return;
+    }
+
+    len = sensors_write_pack(s->channels, SENSOR_CHANNEL_COUNT, evq.tick(),
+                             pack, sizeof(pack));
+    if (len < 0) {
+        cmd.printf("ERROR: sensor pack exceeds %d bytes\n", SENSORS_PACK_SIZE);
+        return;
+    }
+
+    m2mclient->set_resource_value(M2MClient::M2MClientResourceSensorPack,
+                                  (const char *)pack, len);
+    s->pack_pending = false;
+}
+
+/**
+ * Inits the light sensor object
+ */
+static void light_init(struct light_sensor *s, M2MClient *mbed_client)
+{
+    /* report a 5% change in brightness */
+    static const struct sensor_report_cfg report = {
+        0.0f, 5.0f, 0, MBED_CONF_APP_SENSORS_PMAX_SECS * 1000
+    };
+    /* lights are switched, so follow steps quickly */
+    static const struct sensor_sample_cfg sample = {1000, 30000};
+
+    /* add to the display */
+    sensor_channel_init(&s->lux, mbed_client, SENSOR_CHANNEL_LIGHT,
+                        "Light", "light", IND_LIGHT, 0,
+                        &report, &sample,
+                        /* adjusts for the light pipe */
+                        "3.7",
+                        M2MClient::M2MClientResourceLightValue,
+                        M2MClient::M2MClientResourceLightMin,
+                        M2MClient::M2MClientResourceLightMax,
+                        M2MClient::M2MClientResourceLightCal,
+                        M2MClient::M2MClientResourceLightSampling);
+
+    /* init the driver */
+    s->sensor = &tsl2591;
+    s->sensor->init();
+    s->sensor->enable();
+}
+
+/**
+ * Publishes a calibrated light reading to the display and mbed cloud
+ */
+static void light_update(struct light_sensor *s, float value, unsigned now)
+{
+    char res_buffer[33] = {0};
+    unsigned int lux;
+
+    /* a calibration with an offset can take darkness below zero */
+    lux = value > 0.0f ? lroundf(value) : 0;
+    WEM_VERBOSE_PRINTF(sensors, "light: %u\n", lux);
+    snprintf(res_buffer, sizeof(res_buffer), "%u lux", lux);
+
+    sensor_channel_update(&s->lux, lux, res_buffer, now);
+}
+
+/**
+ * Calibrates a raw light reading and publishes it
+ */
+static void light_publish(struct light_sensor *s, float raw)
+{
+    light_update(s, calibration_apply(&s->lux.cal, raw), evq.tick());
+    sensors_publish_pack(&sensors);
+}
+
+#if SENSORS_I2C_ASYNCH
+static void sensors_i2c_release(void)
+{
+    i2c_owner = NULL;
+    i2c.unlock();
+}
+
+/**
+ * Claims the I2C bus for an asynchronous sensor transfer
+ *
+ * The bus mutex is held until sensors_i2c_release() so that other threads
+ * wait for the transfer to complete.  The event queue thread could take
+ * the mutex again, so the display refresh checks i2c_owner instead.
+ *
+ * @return true if the bus was claimed, false if a transfer is in flight
+ */
+static bool sensors_i2c_claim(const void *owner)
+{
+    if (NULL != i2c_owner) {
+        if (evq.tick() - i2c_start_tick < SENSORS_I2C_TIMEOUT_MS) {
+            return false;
+        }
+        cmd.printf("WARN: sensor I2C transfer timed out\n");
+        i2c.abort_transfer();
+        sensors_i2c_release();
+    }
+
+    i2c.lock();
+    i2c_owner = owner;
+    i2c_start_tick = evq.tick();
+
+    return true;
+}
+
+/**
+ * Releases the I2C bus after an asynchronous sensor transfer
+ *
+ * @return false if the bus wasn't held by owner, ie. the transfer had
+ * timed out and the completion is stale
+ */
+static bool sensors_i2c_done(const void *owner)
+{
+    if (owner != i2c_owner) {
+        return false;
+    }
+
+    sensors_i2c_release();
+
+    return true;
+}
+
+/**
+ * Completes a light sensor transfer on the event queue
+ */
+static void light_done(struct light_sensor *s, int event)
+{
+    if (!sensors_i2c_done(s)) {
+        return;
+    }
+
+    if (s->sensor->finishALS(event)) {
+        s->sensor->calcLux();
+        light_publish(s, s->sensor->lux);
+    }
+}
+
+/**
+ * Called from interrupt context when a light sensor transfer completes
+ */
+static void light_i2c_event(int event)
+{
+    evq.call(light_done, &sensors.light, event);
+}
+#endif
+
+/**
+ * Reads a value from the light sensor and publishes to the display
+ *
+ * If the read fails or the sensor has no value yet, the channel stays due
+ * and is read again SENSORS_SAMPLE_TICK_MS later.
+ */
+static void light_read(struct light_sensor *s)
+{
+#if MBED_CONF_APP_SENSORS_SIMULATED
+    float values[SIM_VALUE_COUNT];
+
+    sim_read(&sim.live, evq.tick(), values);
+    light_publish(s, values[SIM_VALUE_LUX]);
+#elif SENSORS_I2C_ASYNCH
+    /* completes in light_done() */
+    if (!sensors_i2c_claim(s)) {
+        return;
+    }
+    if (0 != s->sensor->startALS(callback(light_i2c_event))) {
+        sensors_i2c_release();
+    }
+#else
+    if (s->sensor->getALS()) {
+        s->sensor->calcLux();
+        light_publish(s, s->sensor->lux);
+    }
+#endif
+}
+
+/**
+ * Inits the temp/humidity combo sensor
+ */
+static void dht_init(struct dht_sensor *s, M2MClient *mbed_client)
+{
+    /* report changes visible at the published precision */
+    static const struct sensor_report_cfg temp_report = {
+        0.1f, 0.0f, 0, MBED_CONF_APP_SENSORS_PMAX_SECS * 1000
+    };
+    static const struct sensor_report_cfg humidity_report = {
+        1.0f, 0.0f, 0, MBED_CONF_APP_SENSORS_PMAX_SECS * 1000
+    };
+    /* both channels are read whenever either of them is due */
+    static const struct sensor_sample_cfg sample = {2000, 60000};
+
+    /* add to the display */
+    sensor_channel_init(&s->temp, mbed_client, SENSOR_CHANNEL_TEMP,
+                        "Temp", "temp", IND_TEMP, 1,
+                        &temp_report, &sample,
+                        /* adjusts for the heat inside the case */
+                        "0.68",
+                        M2MClient::M2MClientResourceTempValue,
+                        M2MClient::M2MClientResourceTempMin,
+                        M2MClient::M2MClientResourceTempMax,
+                        M2MClient::M2MClientResourceTempCal,
+                        M2MClient::M2MClientResourceTempSampling);
+    sensor_channel_init(&s->humidity, mbed_client, SENSOR_CHANNEL_HUMIDITY,
+                        "Humidity", "humidity", IND_HUMIDITY, 0,
+                        &humidity_report, &sample,
+                        "1.9",
+                        M2MClient::M2MClientResourceHumidityValue,
+                        M2MClient::M2MClientResourceHumidityMin,
+                        M2MClient::M2MClientResourceHumidityMax,
+                        M2MClient::M2MClientResourceHumidityCal,
+                        M2MClient::M2MClientResourceHumiditySampling);
+
+    /* init the driver, which starts periodic measurements */
+    s->sensor = &sht3x;
+    s->sensor->init();
+}
+
+/**
+ * Publishes calibrated temp and humidity readings to the display and
+ * mbed cloud
+ */
+static void dht_update(struct dht_sensor *dht, float temperature,
+                       float humidity, unsigned now)
+{
+    int size;
+    char res_buffer[33] = {0};
+
+    size = fixed_format_float(res_buffer, sizeof(res_buffer), temperature, 1);
+    strcpy(&res_buffer[size], " C");
+    WEM_VERBOSE_PRINTF(sensors, "DHT: temp = %s\n", res_buffer);
+    sensor_channel_update(&dht->temp, temperature, res_buffer, now);
+
+    size = fixed_format_float(res_buffer, sizeof(res_buffer), humidity, 0);
+    strcpy(&res_buffer[size], "%");
+    WEM_VERBOSE_PRINTF(sensors, "DHT: humidity = %s\n", res_buffer);
+    sensor_channel_update(&dht->humidity, humidity, res_buffer, now);
+}
+
+/**
+ * Calibrates raw temp and humidity readings and publishes them
+ */
+static void dht_publish(struct dht_sensor *dht, float temperature,
+                        float humidity)
+{
+    /* both channels go out in one burst */
+    m2mclient->begin_update();
+    dht_update(dht, calibration_apply(&dht->temp.cal, temperature),
+               calibration_apply(&dht->humidity.cal, humidity), evq.tick());
+    m2mclient->end_update();
+
+    /* one notification for both channels */
+    sensors_publish_pack(&sensors);
+}
+
+#if SENSORS_I2C_ASYNCH
+/**
+ * Completes a temp/humidity sensor transfer on the event queue
+ */
+static void dht_done(struct dht_sensor *dht, int event)
+{
+    if (!sensors_i2c_done(dht)) {
+        return;
+    }
+
+    if (dht->sensor->finishRead(event)) {
+        dht_publish(dht, dht->sensor->temperature, dht->sensor->humidity);
+    }
+}
+
+/**
+ * Called from interrupt context when a temp/humidity transfer completes
+ */
+static void dht_i2c_event(int event)
+{
+    evq.call(dht_done, &sensors.dht, event);
+}
+#endif
+
+/**
+ * Reads temp and humidity values publishes to the display
+ *
+ * The sensor measures once per second and has no new values if read more
+ * often.  The channels then stay due and are read again
+ * SENSORS_SAMPLE_TICK_MS later.
+ */
+static void dht_read(struct dht_sensor *dht)
+{
+#if MBED_CONF_APP_SENSORS_SIMULATED
+    float values[SIM_VALUE_COUNT];
+
+    sim_read(&sim.live, evq.tick(), values);
+    dht_publish(dht, values[SIM_VALUE_TEMP], values[SIM_VALUE_HUMIDITY]);
+#elif SENSORS_I2C_ASYNCH
+    /* completes in dht_done() */
+    if (!sensors_i2c_claim(dht)) {
+        return;
+    }
+    if (0 != dht->sensor->startRead(callback(dht_i2c_event))) {
+        sensors_i2c_release();
+    }
+#else
+    if (dht->sensor->read()) {
+        dht_publish(dht, dht->sensor->temperature, dht->sensor->humidity);
+    }
+#endif
+}
+
+#if MBED_CONF_APP_SOUND_ENABLED
+/**
+ * Inits the sound level sensor object
+ */
+static void sound_init(struct sound_sensor *s, M2MClient *mbed_client)
+{
+    /* report a change of 1 dB, about the smallest that can be heard */
+    static const struct sensor_report_cfg report = {
+        1.0f, 0.0f, 0, MBED_CONF_APP_SENSORS_PMAX_SECS * 1000
+    };
+    /* the level is averaged over the sampling interval */
+    static const struct sensor_sample_cfg sample = {1000, 10000};
+
+    /* add to the display */
+    sensor_channel_init(&s->spl, mbed_client, SENSOR_CHANNEL_SOUND,
+                        "Sound", "sound", IND_SOUND, 1,
+                        &report, &sample,
+                        /* a typical electret capsule gives -26 dBFS at
+                         * 94 dB SPL */
+                        "0:120,1:121",
+                        M2MClient::M2MClientResourceSoundValue,
+                        M2MClient::M2MClientResourceSoundMin,
+                        M2MClient::M2MClientResourceSoundMax,
+                        M2MClient::M2MClientResourceSoundCal,
+                        M2MClient::M2MClientResourceSoundSampling);
+
+    sound_level_reset(&s->level);
+    s->flat_cdb = SOUND_LEVEL_MIN_CDB;
+    s->blocks = 0;
+    sound_bands_reset(&s->bands);
+    s->bands_ms = MBED_CONF_APP_SOUND_BANDS_SECS * 1000;
+    s->bands_str[0] = '\0';
+    s->mic = &mic;
+}
+
+/**
+ * Publishes the calibrated octave band levels as one short string
+ *
+ * The bands are unweighted and rounded to whole dB, from 63 Hz to 4 kHz,
+ * so a vector takes a few dozen bytes however long the period.  Vectors
+ * aren't queued while the client isn't registered.
+ */
+static void sound_bands_publish(struct sound_sensor *s)
+{
+    int len = 0;
+    int32_t cdb[SOUND_BANDS];
+
+    sound_bands_take(&s->bands, cdb);
+    for (int i = 0; i < SOUND_BANDS; i++) {
+        len += snprintf(&s->bands_str[len], sizeof(s->bands_str) - len,
+                        "%s%ld", 0 == i ? "" : ",",
+                        lroundf(calibration_apply(&s->spl.cal,
+                                                  cdb[i] / 100.0f)));
+        if (len >= (int)sizeof(s->bands_str)) {
+            cmd.printf("ERROR: sound bands exceed %d bytes\n",
+                       SOUND_BANDS_STRLEN);
+            s->bands_str[0] = '\0';
+            return;
+        }
+    }
+    WEM_VERBOSE_PRINTF(sensors, "sound bands: %s\n", s->bands_str);
+
+    if (m2mclient->is_client_registered()) {
+        m2mclient->set_resource_value(M2MClient::M2MClientResourceSoundBands,
+                                      s->bands_str, len);
+    }
+}
+
+/**
+ * Publishes a calibrated sound level to the display and mbed cloud
+ *
+ * @return false if the level was rejected as an outlier.
+ */
+static bool sound_update(struct sound_sensor *s, float level, unsigned now)
+{
+    int size;
+    char res_buffer[33] = {0};
+
+    size = fixed_format_float(res_buffer, sizeof(res_buffer), level, 1);
+    strcpy(&res_buffer[size], " dB");
+    WEM_VERBOSE_PRINTF(sensors, "sound: %s\n", res_buffer);
+    return sensor_channel_update(&s->spl, level, res_buffer, now);
+}
+
+/**
+ * Adds a full microphone block to the level and the octave bands, and
+ * publishes each of them once it is due
+ *
+ * Runs on the event queue for every block, so the filtering is kept out of
+ * the sampling interrupt.  The level is the average over all the blocks
+ * since the previous accepted sample, so it follows the sampling interval.
+ * The blocks of a level rejected as an outlier are kept and averaged into
+ * the next one, which is taken on the next block as the channel is still
+ * due.
+ */
+static void sound_process(struct sound_sensor *s)
+{
+    unsigned now;
+    int32_t flat_cdb;
+    int32_t a_cdb;
+    const int16_t *block;
+
+    block = s->mic->block();
+    if (NULL == block) {
+        return;
+    }
+    sound_level_add(&s->level, block, MIC_BLOCK_SAMPLES);
+    if (0 != s->bands_ms) {
+        sound_bands_add(&s->bands, block);
+    }
+    s->mic->release();
+    s->blocks++;
+
+    now = evq.tick();
+    if (0 != s->bands_ms && (int)(now - s->bands_next_tick) >= 0) {
+        if (0 != s->bands.frames) {
+            sound_bands_publish(s);
+        }
+        s->bands_next_tick = now + s->bands_ms;
+    }
+
+    if (!sensor_channel_due(&s->spl, now)) {
+        return;
+    }
+
+    sound_level_get(&s->level, &flat_cdb, &a_cdb);
+    if (!sound_update(s, calibration_apply(&s->spl.cal, a_cdb / 100.0f), now)) {
+        return;
+    }
+    sound_level_restart(&s->level);
+    s->flat_cdb = flat_cdb;
+    sensors_publish_pack(&sensors);
+}
+
+/**
+ * Called from interrupt context when a microphone block is full
+ */
+static void sound_block_ready(void)
+{
+    evq.call(sched_task_run, &sensors.tasks[SCHED_TASK_SOUND]);
+}
+#endif
+
+/**
+ * Publishes the percentiles of every task's timing as JSON
+ *
+ * For each task, jitter, duration and latency are [p50, p99, max] in us.
+ * The "channels" member has the sampling interval, in ms, the sample count
+ * and the number of rejected samples of every sensor channel.
+ */
+static void sched_stats_publish(struct sensors *s)
+{
+    int len = 0;
+    struct sched_task *t;
+    struct sensor_channel *ch;
+    const struct sched_histogram *h[3];
+    static const char *names[3] = {"jitter", "duration", "latency"};
+    static char buf[SCHED_STATS_SIZE];
+
+    if (!m2mclient->is_client_registered()) {
+        return;
+    }
+
+    len += snprintf(&buf[len], sizeof(buf) - len, "{");
+    for (int i = 0; i < SCHED_TASK_COUNT && len < (int)sizeof(buf); i++) {
+        t = &s->tasks[i];
+        h[0] = &t->jitter;
+        h[1] = &t->duration;
+        h[2] = &t->latency;
+        len += snprintf(&buf[len], sizeof(buf) - len,
+                        "%s\"%s\":{\"runs\":%lu", i > 0 ? "," : "",
+                        t->name, (unsigned long)t->runs);
+        for (int j = 0; j < 3 && len < (int)sizeof(buf); j++) {
+            len += snprintf(&buf[len], sizeof(buf) - len,
+                            ",\"%s\":[%lu,%lu,%lu]", names[j],
+                            (unsigned long)sched_histogram_percentile(h[j], 50),
+                            (unsigned long)sched_histogram_percentile(h[j], 99),
+                            (unsigned long)h[j]->max);
+        }
+        if (len < (int)sizeof(buf)) {
+            len += snprintf(&buf[len], sizeof(buf) - len, "}");
+        }
+    }
+
+    /* sampling interval, sample count and rejected samples per channel */
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT && len < (int)sizeof(buf); i++) {
+        ch = s->channels[i];
+        len += snprintf(&buf[len], sizeof(buf) - len,
+                        "%s\"%s\":{\"interval\":%lu,\"samples\":%lu,"
+                        "\"rejected\":%lu}",
+                        0 == i ? ",\"channels\":{" : ",", ch->key,
+                        (unsigned long)ch->sample_ms,
+                        (unsigned long)ch->samples,
+                        (unsigned long)ch->rejected);
+    }
+    if (len < (int)sizeof(buf)) {
+        len += snprintf(&buf[len], sizeof(buf) - len, "}}");
+    }
+
+    if (len >= (int)sizeof(buf)) {
+        cmd.printf("ERROR: sched stats exceed %d bytes\n", SCHED_STATS_SIZE);
+        return;
+    }
+
+    m2mclient->set_resource_value(M2MClient::M2MClientResourceSchedStats,
+                                  buf, len);
+}
+
+/**
+ * Publishes the windowed aggregates of all sensor channels
+ *
+ * Also restarts a sampling task that couldn't schedule its next run.
+ */
+static void sensors_report(struct sensors *s)
+{
+    if (0 == s->light_sampler.evq_id) {
+        sensors_sample_schedule(&s->light_sampler);
+    }
+    if (0 == s->dht_sampler.evq_id) {
+        sensors_sample_schedule(&s->dht_sampler);
+    }
+
+    m2mclient->begin_update();
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        sensor_channel_report(s->channels[i]);
+    }
+    m2mclient->end_update();
+
+    sched_stats_publish(s);
+}
+
+/**
+ * Removes the readings of the last pack from the queue once it reached
+ * mbed cloud, on evq
+ *
+ * A pack that wasn't delivered leaves its readings queued, and they are
+ * sent again by the next uplink_drain().  The report of a pack that
+ * uplink_drain() gave up on is ignored, see UplinkQueue.
+ */
+static void uplink_delivered(struct uplink *u, bool delivered)
+{
+    unsigned elapsed;
+
+    if (!u->queue.report(delivered)) {
+        return;
+    }
+
+    if (delivered) {
+        u->packs++;
+    } else {
+        u->resent++;
+    }
+
+    if (u->draining && 0 == u->queue.depth()) {
+        elapsed = evq.tick() - u->drain_start_tick;
+        u->drain_rate = (u->queue.drained() - u->drain_start_count) *
+                        1000.0f / (0 == elapsed ? 1 : elapsed);
+        u->draining = false;
+    }
+
+    m2mclient->set_int(M2MClient::M2MClientResourceBacklogDepth,
+                       u->queue.depth());
+}
+
+/**
+ * Handles the delivery status of a pack, on the mbed client thread
+ */
+static void uplink_on_delivery(void *context, bool delivered)
+{
+    evq.call(uplink_delivered, (struct uplink *)context, delivered);
+}
+
+/**
+ * Sends the oldest queued readings as one SenML pack
+ *
+ * Runs every MBED_CONF_APP_UPLINK_DRAIN_MS so that draining a large
+ * backlog doesn't starve live notifications.  One pack is in flight at a
+ * time, and its readings stay queued until uplink_delivered() learns that
+ * it reached mbed cloud.
+ */
+static void uplink_drain(struct uplink *u)
+{
+    size_t len;
+    size_t count;
+    unsigned now;
+    static char pack[UPLINK_PACK_SIZE];
+
+    if (!m2mclient->is_client_registered()) {
+        return;
+    }
+
+    m2mclient->set_int(M2MClient::M2MClientResourceBacklogDepth,
+                       u->queue.depth());
+
+    now = evq.tick();
+    if (u->queue.in_flight() > 0) {
+        if (now - u->sent_tick < MBED_CONF_APP_UPLINK_DELIVERY_MS) {
+            return;
+        }
+        /* no word on the pack, most likely lost with the connection */
+        u->queue.expire();
+        u->resent++;
+    }
+
+    /* a value nobody observes isn't notified, so it would never be
+     * delivered either */
+    if (!m2mclient->is_observed(M2MClient::M2MClientResourceBacklog)) {
+        return;
+    }
+
+    len = u->queue.pack(pack, sizeof(pack), now / 1000,
+                        MBED_CONF_APP_UPLINK_PACK_SAMPLES, &count);
+    if (len > 0) {
+        if (!u->draining) {
+            u->draining = true;
+            u->drain_start_tick = now;
+            u->drain_start_count = u->queue.drained();
+        }
+
+        u->queue.sent(count);
+        u->sent_tick = now;
+        m2mclient->set_resource_value(M2MClient::M2MClientResourceBacklog,
+                                      pack, len);
+
+        WEM_VERBOSE_PRINTF(sensors, "uplink: sent %u readings, %u queued\n",
+                           (unsigned)count, (unsigned)u->queue.depth());
+    }
+}
+
+/**
+ * Reads the sensor options from the keystore
+ */
+static void sensors_load_config(struct sensors *sensors)
+{
+    Keystore k;
+    uint32_t secs;
+
+    secs = MBED_CONF_APP_SENSORS_WINDOW_SECS;
+    k.open();
+    keystore_get_uint(k, SENSORS_WINDOW_KEY, 1, CONFIG_SECS_MAX, &secs);
+    sensors->window_secs = secs;
+
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        sensor_channel_load_config(sensors->channels[i], k);
+    }
+
+#if MBED_CONF_APP_SOUND_ENABLED
+    secs = MBED_CONF_APP_SOUND_BANDS_SECS;
+    keystore_get_uint(k, SOUND_BANDS_KEY, 0, SOUND_BANDS_MAX_SECS, &secs);
+    sensors->sound.bands_ms = secs * 1000;
+#endif
+    k.close();
+}
+
+/**
+ * Inits all sensors, making them ready to read
+ */
+static void sensors_init(struct sensors *sensors, M2MClient *mbed_client)
+{
+    int ret;
+    char *end;
+    char *name;
+    const char *mac;
+
+    /* history falls back to RAM only if the filesystem isn't available */
+    ret = history.init();
+    if (0 != ret) {
+        cmd.printf("WARN: sensor history log unavailable: %d\n", ret);
+    } else {
+        history_thread.start(callback(&history_evq,
+                                      &EventQueue::dispatch_forever));
+    }
+
+    dht_init(&sensors->dht, mbed_client);
+    light_init(&sensors->light, mbed_client);
+#if MBED_CONF_APP_SOUND_ENABLED
+    sound_init(&sensors->sound, mbed_client);
+#endif
+
+#if MBED_CONF_APP_SENSORS_SIMULATED
+    /* replay the default trace if there is one */
+    if (0 != sim_open(&sim.live, FS_MOUNT_POINT SIM_TRACE_PATH)) {
+        sim_open(&sim.live, NULL);
+        cmd.printf("simulating sensors with synthetic waveforms\n");
+    } else {
+        cmd.printf("simulating sensors with %s\n",
+                   FS_MOUNT_POINT SIM_TRACE_PATH);
+    }
+#endif
 
-    /* init the driver */
-    s->sensor = &sht31;
+    sensors->channels[SENSOR_CHANNEL_LIGHT] = &sensors->light.lux;
+    sensors->channels[SENSOR_CHANNEL_TEMP] = &sensors->dht.temp;
+    sensors->channels[SENSOR_CHANNEL_HUMIDITY] = &sensors->dht.humidity;
+#if MBED_CONF_APP_SOUND_ENABLED
+    sensors->channels[SENSOR_CHANNEL_SOUND] = &sensors->sound.spl;
+#endif
 
-    s->t_res = mbed_client->get_resource(
-                    M2MClient::M2MClientResourceTempValue);
-    s->h_res = mbed_client->get_resource(
-                    M2MClient::M2MClientResourceHumidityValue);
+    sched_task_init(&sensors->tasks[SCHED_TASK_LIGHT], "light",
+                    callback(light_read, &sensors->light));
+    sched_task_init(&sensors->tasks[SCHED_TASK_DHT], "dht",
+                    callback(dht_read, &sensors->dht));
+    sched_task_init(&sensors->tasks[SCHED_TASK_REPORT], "report",
+                    callback(sensors_report, sensors));
+    sched_task_init(&sensors->tasks[SCHED_TASK_UPLINK], "uplink",
+                    callback(uplink_drain, &uplink));
+    sensors->light.lux.task = &sensors->tasks[SCHED_TASK_LIGHT];
+    sensors->dht.temp.task = &sensors->tasks[SCHED_TASK_DHT];
+    sensors->dht.humidity.task = &sensors->tasks[SCHED_TASK_DHT];
+
+    sensors->light_sampler.task = &sensors->tasks[SCHED_TASK_LIGHT];
+    sensors->light_sampler.a = &sensors->light.lux;
+    sensors->light_sampler.b = NULL;
+    sensors->light_sampler.evq_id = 0;
+    sensors->light.lux.sampler = &sensors->light_sampler;
+    sensors->dht_sampler.task = &sensors->tasks[SCHED_TASK_DHT];
+    sensors->dht_sampler.a = &sensors->dht.temp;
+    sensors->dht_sampler.b = &sensors->dht.humidity;
+    sensors->dht_sampler.evq_id = 0;
+    sensors->dht.temp.sampler = &sensors->dht_sampler;
+    sensors->dht.humidity.sampler = &sensors->dht_sampler;
+#if MBED_CONF_APP_SOUND_ENABLED
+    sched_task_init(&sensors->tasks[SCHED_TASK_SOUND], "sound",
+                    callback(sound_process, &sensors->sound));
+    sensors->sound.spl.task = &sensors->tasks[SCHED_TASK_SOUND];
+#endif
 
-    /* set default values */
-    display.set_sensor_status(s->t_id, "0");
-    mbed_client->set_resource_value(s->t_res, "0", 1);
+    /* the SenML base name is the MAC address without separators */
+    name = sensors->pack_base_name;
+    end = name + sizeof(sensors->pack_base_name) - 2;
+    name += sprintf(name, "urn:dev:mac:");
+    for (mac = net->get_mac_address(); NULL != mac && '\0' != *mac; mac++) {
+        if (':' != *mac && name < end) {
+            *name++ = tolower(*mac);
+        }
+    }
+    strcpy(name, ":");
 
-    display.set_sensor_status(s->h_id, "0");
-    mbed_client->set_resource_value(s->h_res, "0", 1);
+    sensors_load_config(sensors);
 }
 
 /**
- * Reads temp and humidity values publishes to the display
+ * Runs a sampling task if one of its channels is due, then schedules its
+ * next run
+ *
+ * Each run schedules the next one for when a channel is due, with the
+ * interval that sensor_channel_adapt() chose, so an idle sensor costs no
+ * event queue work between samples.  A run can find its channels not yet
+ * due when an asynchronous read completed after the run was scheduled.
  */
-static void dht_read(struct dht_sensor *dht)
+static void sensors_sample(struct sensor_sampler *s)
 {
-    int size = 0;
-    float temperature, humidity;
-    char res_buffer[33] = {0};
-
-    //temp and humidity have multiplier to adjust for the case
-    temperature = dht->sensor->readTemperature() * .68;
-    humidity = dht->sensor->readHumidity() * 1.9;
-    tr_debug("DHT: temp = %fC, humi = %f%%\n", temperature, humidity);
-
-    /* verbose printing to screen of sensor values */
-    WEM_VERBOSE_PRINTF(sensors, "DHT: temp = %.2fC, humidity = %.2f%%\n", temperature, humidity);
+    unsigned now;
+    struct sensor_channel *due;
+
+    now = evq.tick();
+    if (sensor_channel_due(s->a, now) ||
+        (NULL != s->b && sensor_channel_due(s->b, now))) {
+        /* jitter is measured against the channel that was due first.
+         * reads may complete asynchronously, so this is done before the
+         * run. */
+        due = s->a;
+        if (NULL != s->b &&
+            (int)(s->b->next_sample_tick - s->a->next_sample_tick) < 0) {
+            due = s->b;
+        }
+        sched_task_set_due(s->task, due->sample_ms,
+                           now - due->next_sample_tick);
 
-    size = snprintf(res_buffer, sizeof(res_buffer), "%.1f C", temperature);
-    m2mclient->set_resource_value(dht->t_res, res_buffer, size);
-    display.set_sensor_status(dht->t_id, (char *)res_buffer);
+        sched_task_run(s->task);
+    }
 
-    size = snprintf(res_buffer, sizeof(res_buffer), "%.0f%%", humidity);
-    m2mclient->set_resource_value(dht->h_res, res_buffer, size);
-    display.set_sensor_status(dht->h_id, (char *)res_buffer);
+    sensors_sample_schedule(s);
 }
 
 /**
- * Inits all sensors, making them ready to read
+ * Schedules the next run of a sampling task for when its first channel is
+ * due
+ *
+ * A channel that is still due, because its read failed or hasn't
+ * completed yet, is tried again after SENSORS_SAMPLE_TICK_MS.  If the
+ * event queue is full, the task stops until sensors_report() restarts it.
  */
-static void sensors_init(struct sensors *sensors, M2MClient *mbed_client)
+static void sensors_sample_schedule(struct sensor_sampler *s)
 {
-    dht_init(&sensors->dht, mbed_client);
-    light_init(&sensors->light, mbed_client);
+    int delay;
+    unsigned now;
+
+    now = evq.tick();
+    delay = s->a->next_sample_tick - now;
+    if (NULL != s->b && (int)(s->b->next_sample_tick - now) < delay) {
+        delay = s->b->next_sample_tick - now;
+    }
+    if (delay <= 0) {
+        delay = SENSORS_SAMPLE_TICK_MS;
+    }
+
+    s->evq_id = evq.call_in(delay, sensors_sample, s);
+    if (0 == s->evq_id) {
+        cmd.printf("ERROR: failed to schedule %s sampling, "
+                   "event queue full\n", s->task->name);
+    }
 }
 
 /**
@@ -306,10 +2033,35 @@ static void sensors_init(struct sensors *sensors, M2MClient *mbed_client)
  */
 static void sensors_start(struct sensors *s, EventQueue *q)
 {
+    struct sched_task *t = s->tasks;
+
     cmd.printf("starting all sensors\n");
-    // the periods are prime number multiples so that the LED flashing is more appealing
-    s->event_queue_id_light = q->call_every(4700, light_read, &s->light);
-    s->event_queue_id_dht = q->call_every(5300, dht_read, &s->dht);
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        s->channels[i]->next_sample_tick = q->tick();
+    }
+
+    sched_task_start(&t[SCHED_TASK_LIGHT], s->light.lux.sample_ms);
+    sched_task_start(&t[SCHED_TASK_DHT], s->dht.temp.sample_ms);
+    sched_task_start(&t[SCHED_TASK_REPORT], s->window_secs * 1000);
+    sched_task_start(&t[SCHED_TASK_UPLINK], MBED_CONF_APP_UPLINK_DRAIN_MS);
+
+    /* each run schedules the next, see sensors_sample() */
+    s->light_sampler.evq_id = q->call(sensors_sample, &s->light_sampler);
+    s->dht_sampler.evq_id = q->call(sensors_sample, &s->dht_sampler);
+    s->event_queue_id_report = q->call_every(s->window_secs * 1000,
+                                             sched_task_run,
+                                             &t[SCHED_TASK_REPORT]);
+    s->event_queue_id_uplink = q->call_every(MBED_CONF_APP_UPLINK_DRAIN_MS,
+                                             sched_task_run,
+                                             &t[SCHED_TASK_UPLINK]);
+
+#if MBED_CONF_APP_SOUND_ENABLED
+    /* processes one block per run */
+    sched_task_start(&t[SCHED_TASK_SOUND],
+                     MIC_BLOCK_SAMPLES * 1000 / SOUND_SAMPLE_RATE);
+    s->sound.bands_next_tick = q->tick() + s->sound.bands_ms;
+    s->sound.mic->start(SOUND_SAMPLE_RATE, callback(sound_block_ready));
+#endif
 }
 
 /**
@@ -318,10 +2070,17 @@ static void sensors_start(struct sensors *s, EventQueue *q)
 static void sensors_stop(struct sensors *s, EventQueue *q)
 {
     cmd.printf("stopping all sensors\n");
-    q->cancel(s->event_queue_id_light);
-    q->cancel(s->event_queue_id_dht);
-    s->event_queue_id_light = 0;
-    s->event_queue_id_dht = 0;
+    q->cancel(s->light_sampler.evq_id);
+    q->cancel(s->dht_sampler.evq_id);
+    q->cancel(s->event_queue_id_report);
+    q->cancel(s->event_queue_id_uplink);
+#if MBED_CONF_APP_SOUND_ENABLED
+    s->sound.mic->stop();
+#endif
+    s->light_sampler.evq_id = 0;
+    s->dht_sampler.evq_id = 0;
+    s->event_queue_id_report = 0;
+    s->event_queue_id_uplink = 0;
 }
 
 // ****************************************************************************
@@ -338,6 +2097,10 @@ static char *network_get_macaddr(NetworkInterface *net, char *macstr)
     return macstr;
 }
 
+/**
+ * Returns the security type named by a string, NSAPI_SECURITY_UNKNOWN if
+ * it names none
+ */
 static nsapi_security_t wifi_security_str2sec(const char *security)
 {
     if (0 == strcmp("WPA/WPA2", security)) {
@@ -359,9 +2122,7 @@ static nsapi_security_t wifi_security_str2sec(const char *security)
         return NSAPI_SECURITY_NONE;
     }
 
-    cmd.printf("warning: unknown wifi security type (%s), assuming NONE\n",
-           security);
-    return NSAPI_SECURITY_NONE;
+    return NSAPI_SECURITY_UNKNOWN;
 }
 
 /**
@@ -486,6 +2247,7 @@ static int network_connect(NetworkInterface *net)
     int ret;
     char macaddr[MACADDR_STRLEN];
     WiFiInterface *wifi;
+    nsapi_security_t sec;
 
     /* code is compiled -fno-rtti so we have to use C cast */
     wifi = (WiFiInterface *)net;
@@ -531,9 +2293,14 @@ static int network_connect(NetworkInterface *net)
                ssid.c_str(),
                security.c_str());
 
-    ret = wifi->connect(ssid.c_str(),
-                        pass.c_str(),
-                        wifi_security_str2sec(security.c_str()));
+    sec = wifi_security_str2sec(security.c_str());
+    if (NSAPI_SECURITY_UNKNOWN == sec) {
+        cmd.printf("warning: unknown wifi security type (%s), assuming NONE\n",
+                   security.c_str());
+        sec = NSAPI_SECURITY_NONE;
+    }
+
+    ret = wifi->connect(ssid.c_str(), pass.c_str(), sec);
     if (0 != ret) {
         cmd.printf("[WIFI] Failed to connect to: %s (%d)\n",
                    ssid.c_str(), ret);
@@ -556,25 +2323,668 @@ static int network_connect(NetworkInterface *net)
 static void sync_network_connect(NetworkInterface *net)
 {
     int ret;
+    uint32_t delay;
+
     do {
         display.set_network_connecting();
         ret = network_connect(net);
         if (0 != ret) {
             display.set_network_fail();
-            cmd.printf("WARN: failed to init network, retrying...\n");
-            Thread::wait(2000);
+            delay = reconnect_delay(&reconnect);
+            cmd.printf("WARN: failed to init network, retrying in %lu ms\n",
+                       delay);
+            Thread::wait(delay);
         }
     } while (0 != ret);
+    reconnect_net_up(&reconnect);
+}
+
+static void network_retry();
+static void network_cloud_check();
+
+/**
+ * Tries to restore the registration with an update, on evq
+ *
+ * If the registration has expired, the cloud client registers in full by
+ * itself once it has reconnected.
+ */
+static void cloud_resume()
+{
+    if (m2mclient->resume()) {
+        cmd.printf("resuming registration, confirmed %lu ms ago\n",
+                   m2mclient->registration_age_ms());
+    }
+}
+
+/**
+ * Takes the network down and schedules the first attempt to bring it back
+ */
+static void network_restart()
+{
+    reconnect_net_down(&reconnect, evq.tick());
+    network_disconnect(net);
+    display.set_network_fail();
+    display.set_cloud_unregistered();
+    net_evq.call_in(reconnect_delay(&reconnect), network_retry);
+}
+
+/**
+ * Tries once to bring the network back up
+ *
+ * Runs on net_evq, and schedules itself again until the network is up.
+ * Meanwhile the sensors keep sampling, and as the client isn't registered
+ * their readings are queued and sent once it has registered again.
+ */
+static void network_retry()
+{
+    uint32_t delay;
+
+    display.set_network_connecting();
+    if (0 != network_connect(net)) {
+        display.set_network_fail();
+        delay = reconnect_delay(&reconnect);
+        cmd.printf("WARN: failed to reconnect network, retrying in %lu ms\n",
+                   delay);
+        net_evq.call_in(delay, network_retry);
+        return;
+    }
+
+    display.set_network_success();
+    display.set_cloud_in_progress();
+    reconnect_net_up(&reconnect);
+    evq.call(cloud_resume);
+    net_evq.call_in(reconnect_delay(&reconnect), network_cloud_check);
+}
+
+/**
+ * Follows the cloud client while it registers again
+ *
+ * The network is restarted if it has lost its address, or if the client
+ * still isn't registered after RECONNECT_CLOUD_CHECKS checks.
+ */
+static void network_cloud_check()
+{
+    if (RECONNECT_UP == reconnect.state) {
+        net_recovering = false;
+        return;
+    }
+
+    if (NULL == net->get_ip_address() ||
+        reconnect.attempts >= RECONNECT_CLOUD_CHECKS) {
+        cmd.printf("Network connection failed.  Attempting to reconnect.\n");
+        network_restart();
+        return;
+    }
+
+    net_evq.call_in(reconnect_delay(&reconnect), network_cloud_check);
+}
+
+/**
+ * Starts recovering from a lost cloud connection, on net_evq
+ *
+ * Without a network address, the network is brought back up first.
+ * Otherwise only the cloud connection is down, and the cloud client is
+ * given time to reconnect and restore its registration.
+ */
+static void network_connection_lost()
+{
+    if (net_recovering) {
+        return;
+    }
+    net_recovering = true;
+
+    if (NULL == net->get_ip_address()) {
+        cmd.printf("Network connection failed.  Attempting to reconnect.\n");
+        network_restart();
+        return;
+    }
+
+    reconnect_cloud_down(&reconnect, evq.tick());
+    display.set_cloud_in_progress();
+    evq.call(cloud_resume);
+    net_evq.call_in(reconnect_delay(&reconnect), network_cloud_check);
+}
+
+/**
+ * Ends an outage once the client has registered, on net_evq
+ */
+static void network_connection_restored()
+{
+    bool outage = reconnect.outage;
+
+    reconnect_cloud_up(&reconnect, evq.tick());
+    if (outage) {
+        cmd.printf("connection recovered in %lu ms\n",
+                   reconnect.last_recover_ms);
+    }
+}
+
+// ****************************************************************************
+// Cloud
+// ****************************************************************************
+/**
+ * Sends a registration update once the connection has been idle for the
+ * keep-alive interval, and schedules the next check
+ */
+static void mbed_client_keep_alive(M2MClient *m2m)
+{
+    uint32_t idle;
+    uint32_t wait_ms = keepalive.interval_ms;
+
+    if (m2m->is_client_registered()) {
+        idle = m2m->idle_ms();
+        wait_ms = keepalive_due(&keepalive, idle);
+        if (0 == wait_ms) {
+            m2m->keep_alive();
+            keepalive_sent(&keepalive, idle);
+            wait_ms = keepalive.interval_ms;
+            WEM_VERBOSE_PRINTF(sensors, "keep-alive: sent after %lu ms, "
+                               "next in %lu ms\n", idle, wait_ms);
+        }
+    }
+
+    evq.call_in(wait_ms, mbed_client_keep_alive, m2m);
+}
+
+/**
+ * Returns true, and takes value as published, once it has moved by at
+ * least the metric's deadband since it was last published
+ */
+static bool telemetry_metric_due(struct telemetry_metric *m, uint32_t value)
+{
+    uint32_t delta;
+
+    if (m->valid) {
+        delta = value > m->published ?
+                value - m->published : m->published - value;
+        if (delta < m->deadband) {
+            return false;
+        }
+    }
+    m->published = value;
+    m->valid = true;
+    return true;
+}
+
+/**
+ * Formats the stack peak and size of every thread
+ */
+static void telemetry_stacks(char *buf, size_t size)
+{
+    int len = 0;
+
+    buf[0] = '\0';
+#if MBED_STACK_STATS_ENABLED == 1
+    int count;
+    const char *name;
+    static mbed_stats_stack_t stats[TELEMETRY_THREADS];
+
+    count = mbed_stats_stack_get_each(stats, TELEMETRY_THREADS);
+    for (int i = 0; i < count && len < (int)size; i++) {
+        name = osThreadGetName((osThreadId_t)(uintptr_t)stats[i].thread_id);
+        if (NULL != name) {
+            len += snprintf(&buf[len], size - len, "%s%s:%lu/%lu",
+                            i > 0 ? "," : "", name,
+                            (unsigned long)stats[i].max_size,
+                            (unsigned long)stats[i].reserved_size);
+        } else {
+            len += snprintf(&buf[len], size - len, "%s%lx:%lu/%lu",
+                            i > 0 ? "," : "",
+                            (unsigned long)stats[i].thread_id,
+                            (unsigned long)stats[i].max_size,
+                            (unsigned long)stats[i].reserved_size);
+        }
+    }
+#endif
+}
+
+/**
+ * Publishes every telemetry counter that has moved past its deadband
+ *
+ * Runs on evq behind the events that were pending when telemetry_sample()
+ * posted it, which is the event queue latency.
+ */
+static void telemetry_publish(void)
+{
+    uint32_t values[TELEMETRY_METRIC_COUNT];
+    uint32_t jitter;
+    struct telemetry_metric *m;
+    static char stacks[TELEMETRY_STACKS_SIZE];
+
+    memset(values, 0, sizeof(values));
+    values[TELEMETRY_EVENT_LATENCY] = us_ticker_read() - telemetry.probe_us;
+    telemetry.samples++;
+
+    if (!m2mclient->is_client_registered()) {
+        return;
+    }
+
+#if MBED_HEAP_STATS_ENABLED == 1
+    mbed_stats_heap_t heap;
+
+    mbed_stats_heap_get(&heap);
+    values[TELEMETRY_HEAP_USED] = heap.current_size;
+    values[TELEMETRY_HEAP_PEAK] = heap.max_size;
+    values[TELEMETRY_HEAP_FAILS] = heap.alloc_fail_cnt;
+#endif
+    telemetry_stacks(stacks, sizeof(stacks));
+
+    /* the worse p99 jitter of the periodic sensor reads */
+    values[TELEMETRY_SENSOR_JITTER] = sched_histogram_percentile(
+        &sensors.tasks[SCHED_TASK_LIGHT].jitter, 99);
+    jitter = sched_histogram_percentile(
+        &sensors.tasks[SCHED_TASK_DHT].jitter, 99);
+    if (jitter > values[TELEMETRY_SENSOR_JITTER]) {
+        values[TELEMETRY_SENSOR_JITTER] = jitter;
+    }
+
+    values[TELEMETRY_RECONNECTS] = reconnect.net_outages +
+                                   reconnect.cloud_outages;
+    values[TELEMETRY_UPTIME] = evq.tick() / 1000;
+
+    m2mclient->begin_update();
+    for (int i = 0; i < TELEMETRY_METRIC_COUNT; i++) {
+        m = &telemetry.metrics[i];
+        /* not built without the matching mbed stats */
+        if (NULL == m2mclient->get_resource(m->resource)) {
+            continue;
+        }
+        /* a peak that moved is sent even if the others hold still */
+        if (TELEMETRY_STACK_PEAKS == i) {
+            if (m2mclient->set_text(m->resource, stacks, strlen(stacks))) {
+                telemetry.updates++;
+            } else {
+                telemetry.suppressed++;
+            }
+            continue;
+        }
+        if (!telemetry_metric_due(m, values[i])) {
+            telemetry.suppressed++;
+            continue;
+        }
+        m2mclient->set_int(m->resource, values[i]);
+        telemetry.updates++;
+    }
+    m2mclient->end_update();
+}
+
+/**
+ * Posts telemetry_publish() to the back of evq, every
+ * MBED_CONF_APP_TELEMETRY_SECS
+ */
+static void telemetry_sample(void)
+{
+    telemetry.probe_us = us_ticker_read();
+    evq.call(telemetry_publish);
+}
+
+/**
+ * Sets the deadbands of the telemetry counters and starts sampling them
+ *
+ * The counters are sampled slowly and only published when they move, so
+ * they cost the fleet a few notifications per hour, and a regression
+ * still shows up in mbed Cloud.  Uptime is published once an hour.
+ */
+static void telemetry_start(void)
+{
+    static const struct {
+        enum M2MClient::M2MClientResource resource;
+        uint32_t deadband;
+    } cfg[TELEMETRY_METRIC_COUNT] = {
+        {M2MClient::M2MClientResourceHeapUsed, 1024},
+        {M2MClient::M2MClientResourceHeapPeak, 256},
+        {M2MClient::M2MClientResourceHeapFails, 1},
+        /* published on any change of its text */
+        {M2MClient::M2MClientResourceStackPeaks, 0},
+        {M2MClient::M2MClientResourceEventLatency, 5000},
+        {M2MClient::M2MClientResourceSensorJitter, 1000},
+        {M2MClient::M2MClientResourceReconnects, 1},
+        {M2MClient::M2MClientResourceUptime, 3600},
+    };
+
+    memset(&telemetry, 0, sizeof(telemetry));
+    for (int i = 0; i < TELEMETRY_METRIC_COUNT; i++) {
+        telemetry.metrics[i].resource = cfg[i].resource;
+        telemetry.metrics[i].deadband = cfg[i].deadband;
+    }
+    evq.call_every(MBED_CONF_APP_TELEMETRY_SECS * 1000, telemetry_sample);
+}
+
+static struct sensor_channel *find_sensor_channel(const std::string &key);
+static void app_label_load(M2MClient *m2m, Keystore &k);
+static void geo_load(M2MClient *m2m, Keystore &k);
+
+static const struct config_key config_keys[] = {
+    {SSID_KEY, CONFIG_VALUE_TEXT, 0, 32, 0},
+    {PASSWORD_KEY, CONFIG_VALUE_TEXT, 0, CONFIG_TEXT_LEN, 0},
+    {SECURITY_KEY, CONFIG_VALUE_SECURITY, 0, 0, 0},
+    {APP_LABEL_KEY, CONFIG_VALUE_TEXT, 0, CONFIG_TEXT_LEN,
+     CONFIG_APPLY_LABEL},
+    {GEO_LAT_KEY, CONFIG_VALUE_NUMBER, 0, 0, CONFIG_APPLY_GEO},
+    {GEO_LONG_KEY, CONFIG_VALUE_NUMBER, 0, 0, CONFIG_APPLY_GEO},
+    {GEO_ACCURACY_KEY, CONFIG_VALUE_NUMBER, 0, 0, CONFIG_APPLY_GEO},
+    {SENSORS_WINDOW_KEY, CONFIG_VALUE_UINT, 1, CONFIG_SECS_MAX, 0},
+#if MBED_CONF_APP_SOUND_ENABLED
+    {SOUND_BANDS_KEY, CONFIG_VALUE_UINT, 0, SOUND_BANDS_MAX_SECS, 0},
+#endif
+    {SENSOR_DEADBAND_KEY, CONFIG_VALUE_NUMBER, 0, 0, CONFIG_APPLY_SENSORS},
+    {SENSOR_DEADBAND_PCT_KEY, CONFIG_VALUE_NUMBER, 0, 0,
+     CONFIG_APPLY_SENSORS},
+    {SENSOR_PMIN_KEY, CONFIG_VALUE_UINT, 0, CONFIG_SECS_MAX,
+     CONFIG_APPLY_SENSORS},
+    {SENSOR_PMAX_KEY, CONFIG_VALUE_UINT, 0, CONFIG_SECS_MAX,
+     CONFIG_APPLY_SENSORS},
+    {SENSOR_CAL_KEY, CONFIG_VALUE_CALIBRATION, 0, 0, CONFIG_APPLY_SENSORS},
+    {SENSOR_SAMPLE_MIN_KEY, CONFIG_VALUE_UINT, SENSORS_SAMPLE_TICK_MS,
+     UINT_MAX, CONFIG_APPLY_SENSORS},
+    {SENSOR_SAMPLE_MAX_KEY, CONFIG_VALUE_UINT, SENSORS_SAMPLE_TICK_MS,
+     UINT_MAX, CONFIG_APPLY_SENSORS},
+    {SENSOR_FILTER_KEY, CONFIG_VALUE_NUMBER, 0, 0, CONFIG_APPLY_SENSORS},
+};
+
+/**
+ * Returns how a key is written through the config resource, NULL if it
+ * can't be
+ */
+static const struct config_key *config_find_key(const std::string &key)
+{
+    size_t dot;
+    const struct config_key *c;
+
+    for (size_t i = 0; i < ARRAY_SIZE(config_keys); i++) {
+        c = &config_keys[i];
+        if ('.' != c->key[0] && key == c->key) {
+            return c;
+        }
+    }
+
+    /* "<channel>.<option>" */
+    dot = key.find('.');
+    if (std::string::npos == dot ||
+        NULL == find_sensor_channel(key.substr(0, dot))) {
+        return NULL;
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(config_keys); i++) {
+        c = &config_keys[i];
+        if ('.' == c->key[0] && 0 == key.compare(dot, std::string::npos,
+                                                 c->key)) {
+            return c;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Returns true if val, of len characters, is a valid value of a key
+ *
+ * Takes no more than the loader of the key would: a whole number must be
+ * within the range of the key, and calibration points must be finite.
+ */
+static bool config_value_valid(const struct config_key *c, const char *val,
+                               size_t len)
+{
+    char *end;
+    uint32_t n;
+    struct calibration cal;
+
+    if (strlen(val) != len) {
+        return false;
+    }
+
+    switch (c->type) {
+    case CONFIG_VALUE_TEXT:
+        if (len > c->max) {
+            return false;
+        }
+        /* the keystore holds one "<key>=<value>" per line */
+        for (size_t i = 0; i < len; i++) {
+            if ('=' == val[i] || (unsigned char)val[i] < 0x20) {
+                return false;
+            }
+        }
+        return true;
+    case CONFIG_VALUE_SECURITY:
+        return NSAPI_SECURITY_UNKNOWN != wifi_security_str2sec(val);
+    case CONFIG_VALUE_NUMBER:
+        /* no inf or nan */
+        if (0 == len || strspn(val, "0123456789+-.eE") != len) {
+            return false;
+        }
+        errno = 0;
+        strtof(val, &end);
+        return end == val + len && 0 == errno;
+    case CONFIG_VALUE_UINT:
+        return config_parse_uint(val, c->min, c->max, &n);
+    case CONFIG_VALUE_CALIBRATION:
+        return 0 == calibration_parse(&cal, val);
+    }
+
+    return false;
 }
 
-// ****************************************************************************
-// Cloud
-// ****************************************************************************
-static void mbed_client_keep_alive(M2MClient *m2m)
+/**
+ * SAX handler of the config resource
+ *
+ * Takes a flat JSON object whose values are strings, numbers, or null to
+ * delete the key.  Valid values go straight into the keystore copy, and
+ * the status of every key is kept for the report, since a key can still
+ * be rejected once the keys it depends on are known.  Anything nested
+ * stops the parse.
+ */
+struct config_handler :
+    public json::BaseReaderHandler<json::UTF8<>, config_handler> {
+    Keystore &k;
+    int depth;
+    /* the key whose value comes next, and how it is checked */
+    std::string key;
+    const struct config_key *c;
+    std::vector<struct config_status> statuses;
+    unsigned keys;
+    unsigned errors;
+    int apply;
+
+    config_handler(Keystore &k) :
+        k(k), depth(0), c(NULL), keys(0), errors(0), apply(0) {}
+
+    bool StartObject() { return 0 == depth++; }
+    bool EndObject(json::SizeType count) { depth--; return true; }
+    bool StartArray() { return false; }
+
+    bool Key(const char *str, json::SizeType len, bool copy)
+    {
+        key.assign(str, len);
+        c = len <= CONFIG_KEY_LEN ? config_find_key(key) : NULL;
+        keys++;
+        return true;
+    }
+
+    bool String(const char *str, json::SizeType len, bool copy)
+    {
+        return value(str, len);
+    }
+
+    bool RawNumber(const char *str, json::SizeType len, bool copy)
+    {
+        return value(str, len);
+    }
+
+    bool Null()
+    {
+        if (1 != depth) {
+            return false;
+        }
+        if (NULL == c) {
+            return status("unknown");
+        }
+        k.del(key);
+        apply |= c->apply;
+        return status("deleted");
+    }
+
+    bool Bool(bool b)
+    {
+        if (1 != depth) {
+            return false;
+        }
+        return status(NULL == c ? "unknown" : "invalid");
+    }
+
+    bool value(const char *str, json::SizeType len)
+    {
+        if (1 != depth) {
+            return false;
+        }
+        if (NULL == c) {
+            return status("unknown");
+        }
+        if (!config_value_valid(c, str, len)) {
+            return status("invalid");
+        }
+        k.set(key, std::string(str, len));
+        apply |= c->apply;
+        return status("ok");
+    }
+
+    bool status(const char *s)
+    {
+        struct config_status st;
+
+        st.key = key;
+        st.status = s;
+        statuses.push_back(st);
+        return true;
+    }
+
+    /* rejects the keys written to a channel whose reporting period or
+     * sampling interval bounds now contradict each other, as its loader
+     * would ignore them */
+    void check_bounds()
+    {
+        struct sensor_channel *ch;
+        struct sensor_report_cfg cfg;
+        struct sensor_sample_cfg sample;
+
+        if (!(apply & CONFIG_APPLY_SENSORS)) {
+            return;
+        }
+        for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+            ch = sensors.channels[i];
+            cfg = ch->report_defaults;
+            sample = ch->sample_defaults;
+            sensor_channel_read_bounds(ch, k, &cfg, &sample);
+            if (cfg.pmax_ms != 0 && cfg.pmax_ms < cfg.pmin_ms) {
+                reject(ch, SENSOR_PMIN_KEY);
+                reject(ch, SENSOR_PMAX_KEY);
+            }
+            if (0 != sensor_sample_cfg_check(&sample)) {
+                reject(ch, SENSOR_SAMPLE_MIN_KEY);
+                reject(ch, SENSOR_SAMPLE_MAX_KEY);
+            }
+        }
+    }
+
+    void reject(const struct sensor_channel *ch, const char *option)
+    {
+        std::string name = std::string(ch->key) + option;
+
+        for (size_t i = 0; i < statuses.size(); i++) {
+            if (statuses[i].key == name) {
+                statuses[i].status = "invalid";
+            }
+        }
+    }
+
+    /* writes the status of every key, and counts those that failed */
+    void write_report(json::Writer<json::StringBuffer> &report)
+    {
+        const struct config_status *st;
+
+        for (size_t i = 0; i < statuses.size(); i++) {
+            st = &statuses[i];
+            if (0 != strcmp(st->status, "ok") &&
+                0 != strcmp(st->status, "deleted")) {
+                errors++;
+            }
+            report.Key(st->key.data(), st->key.length(), true);
+            report.String(st->status);
+        }
+    }
+};
+
+/**
+ * Handles a M2M PUT request on the config resource
+ *
+ * The JSON object is parsed as it is read into one copy of the keystore,
+ * which is only written if every key is valid: one flash write however
+ * many keys are set.  A key is valid if its loader would take it, which
+ * for the reporting period and sampling interval bounds of a channel
+ * includes their order once all keys are in.  The value of the resource
+ * is then replaced by a report of the status of each key, "ok",
+ * "deleted", "unknown" or "invalid", and the result, "saved", "rejected"
+ * if any key failed, or "malformed" with the offset of the error.  The
+ * label, geo and sensor options take effect right away, the rest after a
+ * reboot.
+ */
+static void mbed_client_handle_put_config(M2MClient *m2m)
 {
-    if (m2m->is_client_registered()) {
-        m2m->keep_alive();
+    Keystore k;
+    std::string val;
+    json::Reader reader;
+    json::ParseResult ok;
+    json::StringBuffer buf;
+    json::Writer<json::StringBuffer> report(buf);
+    config_handler h(k);
+
+    val = m2m->get_resource_value_str(M2MClient::M2MClientResourceAppConfig);
+    if (val.length() == 0) {
+        return;
     }
+    json::StringStream in(val.c_str());
+
+    k.open();
+    report.StartObject();
+    report.Key("keys");
+    report.StartObject();
+    ok = reader.Parse<json::kParseNumbersAsStringsFlag>(in, h);
+    if (ok) {
+        h.check_bounds();
+    }
+    h.write_report(report);
+    report.EndObject();
+    report.Key("result");
+    if (!ok) {
+        report.String("malformed");
+        report.Key("offset");
+        report.Uint((unsigned)ok.Offset());
+    } else if (h.errors > 0) {
+        report.String("rejected");
+    } else {
+        k.write();
+        report.String("saved");
+    }
+    report.EndObject();
+
+    if (ok && 0 == h.errors) {
+        m2m->begin_update();
+        if (h.apply & CONFIG_APPLY_LABEL) {
+            app_label_load(m2m, k);
+        }
+        if (h.apply & CONFIG_APPLY_GEO) {
+            geo_load(m2m, k);
+        }
+        if (h.apply & CONFIG_APPLY_SENSORS) {
+            for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+                sensor_channel_load_config(sensors.channels[i], k);
+            }
+        }
+        m2m->end_update();
+    }
+    k.close();
+
+    m2m->set_resource_value(M2MClient::M2MClientResourceAppConfig,
+                            buf.GetString(), buf.GetSize());
+    cmd.printf("INFO: config of %u keys: %s\n", h.keys, buf.GetString());
 }
 
 /**
@@ -673,6 +3083,71 @@ mbed_client_handle_put_geo_accuracy(M2MClient *m2m)
     k.close();
 }
 
+/**
+ * Handles a M2M PUT request on a sensor calibration table
+ */
+static void mbed_client_handle_put_calibration(struct sensor_channel *ch)
+{
+    Keystore k;
+    std::string val;
+    struct calibration cal;
+
+    val = m2mclient->get_resource_value_str(ch->cal_res);
+    if (val.length() == 0) {
+        return;
+    }
+
+    if (0 != calibration_parse(&cal, val.c_str())) {
+        cmd.printf("WARN: ignoring invalid %s calibration: %s\n",
+                   ch->key, val.c_str());
+        /* put back the table that is in use */
+        k.open();
+        sensor_channel_load_cal(ch, k);
+        k.close();
+        return;
+    }
+
+    k.open();
+    k.set(std::string(ch->key) + SENSOR_CAL_KEY, val);
+    k.write();
+    k.close();
+
+    ch->cal = cal;
+    cmd.printf("INFO: %s calibration set to %s\n", ch->key, val.c_str());
+}
+
+/**
+ * Handles a M2M PUT request on the sampling interval bounds of a channel
+ */
+static void mbed_client_handle_put_sampling(struct sensor_channel *ch)
+{
+    Keystore k;
+    std::string val;
+    char buf[12];
+    struct sensor_sample_cfg cfg;
+
+    val = m2mclient->get_resource_value_str(ch->sample_res);
+    if (0 != sensor_sample_cfg_parse(&cfg, val.c_str())) {
+        cmd.printf("WARN: ignoring invalid %s sampling bounds: %s\n",
+                   ch->key, val.c_str());
+        /* put back the bounds that are in use */
+        sensor_channel_set_sample_cfg(ch, &ch->sample);
+        return;
+    }
+
+    k.open();
+    snprintf(buf, sizeof(buf), "%lu", (unsigned long)cfg.min_ms);
+    k.set(std::string(ch->key) + SENSOR_SAMPLE_MIN_KEY, buf);
+    snprintf(buf, sizeof(buf), "%lu", (unsigned long)cfg.max_ms);
+    k.set(std::string(ch->key) + SENSOR_SAMPLE_MAX_KEY, buf);
+    k.write();
+    k.close();
+
+    sensor_channel_set_sample_cfg(ch, &cfg);
+    cmd.printf("INFO: %s sampling bounds set to %s ms\n",
+               ch->key, val.c_str());
+}
+
 /**
  * Readies the app for a firmware download
  */
@@ -781,7 +3256,13 @@ void mbed_client_on_update_progress(uint32_t progress, uint32_t total)
 
 static void mbed_client_on_registered(void *context)
 {
+    keepalive_registered(&keepalive);
+    net_evq.call(network_connection_restored);
     cmd.printf("mbed client registered\n");
+    if (uplink.queue.depth() > 0) {
+        cmd.printf("sending %u readings queued while offline\n",
+                   (unsigned)uplink.queue.depth());
+    }
     display.set_cloud_registered();
 }
 
@@ -813,31 +3294,26 @@ static void mbed_client_on_error(void *context, int err_code,
     cmd.printf("ERROR: mbed client (%d) %s\n", err_code, err_name);
     cmd.printf("    Error details : %s\n", err_desc);
     display.set_cloud_error();
-    if ((err_code == MbedCloudClient::ConnectNetworkError) ||
-        (err_code == MbedCloudClient::ConnectDnsResolvingFailed)) {
+
+    /* a connection that broke after a long idle time tells the keep-alive
+     * how long the path keeps it open */
+    if (err_code == MbedCloudClient::ConnectNetworkError ||
+        err_code == MbedCloudClient::ConnectTimeout ||
+        err_code == MbedCloudClient::ConnectSecureConnectionFailed) {
+        keepalive_failed(&keepalive, m2m->last_gap_ms());
+    }
+
+    if (err_code == MbedCloudClient::ConnectNetworkError ||
+        err_code == MbedCloudClient::ConnectDnsResolvingFailed ||
+        err_code == MbedCloudClient::ConnectTimeout ||
+        err_code == MbedCloudClient::ConnectSecureConnectionFailed) {
         if (m2m->is_fota_install_requested()) {
             cmd.printf("Ignoring network error due to fota install\n");
             return;
         }
-        network_disconnect(net);
-        display.set_network_fail();
-        display.set_cloud_unregistered();
-        cmd.printf("Network connection failed.  Attempting to reconnect.\n");
-        /* Because we are running in the mbed client thread context
-         * we want to disable our sensors from modifying the mbed
-         * client queue while we mess with the network.  This will
-         * allow the main context to continue to refresh the display.
-         *
-         * Holding on to this thread context until netork connection
-         * is re-established will prevent the mbed client from backing
-         * off the time between connection retries.
-         */
-        sensors_stop(&sensors, &evq);
-        sync_network_connect(net);
-        display.set_network_success();
-        sensors_start(&sensors, &evq);
-        /* CLoud client will automatically try to reconnect.*/
-        display.set_cloud_in_progress();
+        /* recover on the network event queue, so that neither the cloud
+         * client's thread nor the sensors wait for the network */
+        net_evq.call(network_connection_lost);
     }
 }
 
@@ -859,6 +3335,9 @@ mbed_client_on_resource_updated(void *context,
     case M2MClient::M2MClientResourceAppLabel:
         evq.call(mbed_client_handle_put_app_label, m2m);
         break;
+    case M2MClient::M2MClientResourceAppConfig:
+        evq.call(mbed_client_handle_put_config, m2m);
+        break;
     case M2MClient::M2MClientResourceGeoLat:
         evq.call(mbed_client_handle_put_geo_lat, m2m);
         break;
@@ -868,6 +3347,40 @@ mbed_client_on_resource_updated(void *context,
     case M2MClient::M2MClientResourceGeoAccuracy:
         evq.call(mbed_client_handle_put_geo_accuracy, m2m);
         break;
+    case M2MClient::M2MClientResourceLightCal:
+        evq.call(mbed_client_handle_put_calibration,
+                 sensors.channels[SENSOR_CHANNEL_LIGHT]);
+        break;
+    case M2MClient::M2MClientResourceTempCal:
+        evq.call(mbed_client_handle_put_calibration,
+                 sensors.channels[SENSOR_CHANNEL_TEMP]);
+        break;
+    case M2MClient::M2MClientResourceHumidityCal:
+        evq.call(mbed_client_handle_put_calibration,
+                 sensors.channels[SENSOR_CHANNEL_HUMIDITY]);
+        break;
+    case M2MClient::M2MClientResourceLightSampling:
+        evq.call(mbed_client_handle_put_sampling,
+                 sensors.channels[SENSOR_CHANNEL_LIGHT]);
+        break;
+    case M2MClient::M2MClientResourceTempSampling:
+        evq.call(mbed_client_handle_put_sampling,
+                 sensors.channels[SENSOR_CHANNEL_TEMP]);
+        break;
+    case M2MClient::M2MClientResourceHumiditySampling:
+        evq.call(mbed_client_handle_put_sampling,
+                 sensors.channels[SENSOR_CHANNEL_HUMIDITY]);
+        break;
+#if MBED_CONF_APP_SOUND_ENABLED
+    case M2MClient::M2MClientResourceSoundCal:
+        evq.call(mbed_client_handle_put_calibration,
+                 sensors.channels[SENSOR_CHANNEL_SOUND]);
+        break;
+    case M2MClient::M2MClientResourceSoundSampling:
+        evq.call(mbed_client_handle_put_sampling,
+                 sensors.channels[SENSOR_CHANNEL_SOUND]);
+        break;
+#endif
     default:
         res = m2m->get_resource(resource);
         if (NULL != res) {
@@ -890,15 +3403,17 @@ static int register_mbed_client(NetworkInterface *iface, M2MClient *mbed_client)
     mbed_client->on_update_progress(mbed_client_on_update_progress);
     mbed_client->on_resource_updated(mbed_client,
                                      mbed_client_on_resource_updated);
+    mbed_client->on_delivery(M2MClient::M2MClientResourceBacklog, &uplink,
+                             uplink_on_delivery);
 
     display.set_cloud_in_progress();
     mbed_client->call_register(iface);
 
-    /* set up a keep-alive interval to send registration updates to the
-     * mbed cloud server to avoid deregistration/registration issues. */
-    evq.call_every((MBED_CLOUD_CLIENT_LIFETIME / 4) * 1000,
-                   mbed_client_keep_alive,
-                   mbed_client);
+    /* send registration updates to the mbed cloud server while the
+     * connection is idle, to avoid deregistration/registration issues. */
+    keepalive_init(&keepalive, MBED_CLOUD_CLIENT_LIFETIME * 1000);
+    keepalive_start_tick = evq.tick();
+    evq.call_in(keepalive.interval_ms, mbed_client_keep_alive, mbed_client);
     return 0;
 }
 
@@ -1513,6 +4028,492 @@ static void cmd_cb_verbose(vector<string>& params)
     }
 }
 
+static void cmd_cb_sensors(vector<string>& params)
+{
+    struct sensor_channel *ch;
+    struct sensor_stats_str str;
+    char deadband[FIXED_STRLEN];
+    char deadband_pct[FIXED_STRLEN];
+    char filter_k[FIXED_STRLEN];
+#if MBED_CONF_APP_SOUND_ENABLED
+    char flat[FIXED_STRLEN];
+#endif
+    uint32_t sent = 0, queued = 0, suppressed = 0;
+
+    cmd.printf("window: %d secs\n", sensors.window_secs);
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        ch = sensors.channels[i];
+        if (NULL == ch) {
+            continue;
+        }
+
+        sensor_stats_format(&ch->stats, &str);
+        cmd.printf("%s: n=%lu mean=%s stddev=%s min=%s max=%s\n",
+                   ch->name, ch->stats.count, str.mean, str.stddev,
+                   str.min, str.max);
+
+        fixed_format_float(deadband, sizeof(deadband),
+                           ch->report.deadband, 2);
+        fixed_format_float(deadband_pct, sizeof(deadband_pct),
+                           ch->report.deadband_pct, 1);
+        cmd.printf("    deadband=%s deadband_pct=%s pmin=%lu pmax=%lu\n",
+                   deadband, deadband_pct,
+                   ch->report.pmin_ms / 1000, ch->report.pmax_ms / 1000);
+        cmd.printf("    sampling: interval=%lu ms min=%lu max=%lu samples=%lu\n",
+                   ch->sample_ms, ch->sample.min_ms, ch->sample.max_ms,
+                   ch->samples);
+        fixed_format_float(filter_k, sizeof(filter_k), ch->filter_k, 1);
+        cmd.printf("    filter: k=%s rejected=%lu\n", filter_k, ch->rejected);
+        cmd.printf("    notifications: sent=%lu queued=%lu suppressed=%lu\n",
+                   ch->sent, ch->queued, ch->suppressed);
+        sent += ch->sent;
+        queued += ch->queued;
+        suppressed += ch->suppressed;
+    }
+    cmd.printf("total notifications: sent=%lu queued=%lu suppressed=%lu\n",
+               sent, queued, suppressed);
+#if MBED_CONF_APP_SOUND_ENABLED
+    fixed_format(flat, sizeof(flat), sensors.sound.flat_cdb, 2);
+    cmd.printf("microphone: blocks=%lu overruns=%lu flat=%s dBFS\n",
+               sensors.sound.blocks, sensors.sound.mic->overruns(), flat);
+    cmd.printf("    bands: period=%lu s last=%s\n",
+               sensors.sound.bands_ms / 1000, sensors.sound.bands_str);
+#endif
+}
+
+static void cmd_cb_uplink(vector<string>& params)
+{
+    unsigned elapsed;
+    char rate[FIXED_STRLEN];
+    UplinkQueue *q = &uplink.queue;
+    const struct tls_session_stats *tls;
+
+    cmd.printf("mbed client: %s\n",
+               m2mclient != NULL && m2mclient->is_client_registered() ?
+               "registered" : "offline");
+    if (m2mclient != NULL) {
+        cmd.printf("registration: objects=%u resources=%u links=%u B "
+                   "time=%lu ms\n",
+                   m2mclient->registration_objects(),
+                   m2mclient->registration_resources(),
+                   (unsigned)m2mclient->registration_size(),
+                   m2mclient->registration_ms());
+        cmd.printf("notifications: %lu in %lu bursts, unchanged=%lu "
+                   "coalesced=%lu\n",
+                   m2mclient->notifications(), m2mclient->bursts(),
+                   m2mclient->unchanged(), m2mclient->coalesced());
+        cmd.printf("telemetry: samples=%lu updates=%lu suppressed=%lu\n",
+                   telemetry.samples, telemetry.updates,
+                   telemetry.suppressed);
+        elapsed = evq.tick() - keepalive_start_tick;
+        cmd.printf("keep-alive: interval=%lu ms updates=%lu (%lu/h) "
+                   "skipped=%lu\n",
+                   keepalive.interval_ms, keepalive.updates,
+                   0 == elapsed ? 0UL :
+                   (unsigned long)((uint64_t)keepalive.updates * 3600000 /
+                                   elapsed),
+                   keepalive.skipped);
+        cmd.printf("    idle: survived=%lu ms timeout=%lu ms, "
+                   "failures=%lu reregistrations=%lu\n",
+                   keepalive.survived_ms, keepalive.timeout_ms,
+                   keepalive.failures,
+                   keepalive.registrations > 0 ?
+                   keepalive.registrations - 1 : 0UL);
+    }
+    cmd.printf("connectivity: %s, outages: network=%lu cloud=%lu\n",
+               RECONNECT_UP == reconnect.state ? "up" :
+               RECONNECT_NET_DOWN == reconnect.state ? "network down" :
+               "cloud down",
+               reconnect.net_outages, reconnect.cloud_outages);
+    cmd.printf("    time to recover: last=%lu ms mean=%lu ms max=%lu ms\n",
+               reconnect.last_recover_ms, reconnect_mean_recover_ms(&reconnect),
+               reconnect.max_recover_ms);
+    if (m2mclient != NULL) {
+        cmd.printf("    resumed registrations: %lu of %lu, last in %lu ms\n",
+                   m2mclient->resumed(), m2mclient->resumes(),
+                   m2mclient->resume_ms());
+    }
+    tls = tls_session_get_stats();
+    cmd.printf("    TLS handshakes: full=%lu last in %lu ms, resumed=%lu last "
+               "in %lu ms, failed=%lu\n", tls->full, tls->full_ms,
+               tls->resumed, tls->resumed_ms, tls->failed);
+    cmd.printf("queue: depth=%u max=%u capacity=%u\n",
+               (unsigned)q->depth(), (unsigned)q->max_depth(),
+               UPLINK_QUEUE_SAMPLES);
+    cmd.printf("readings: queued=%lu drained=%lu dropped=%lu\n",
+               q->queued(), q->drained(), q->dropped());
+    fixed_format_float(rate, sizeof(rate), uplink.drain_rate, 1);
+    cmd.printf("packs: %lu resent=%lu, last drain: %s readings/s\n",
+               uplink.packs, uplink.resent, rate);
+}
+
+static void cmd_print_sched_histogram(const char *name,
+                                      const struct sched_histogram *h,
+                                      bool buckets)
+{
+    uint32_t lo;
+
+    cmd.printf("    %-8s n=%lu p50=%lu p90=%lu p99=%lu max=%lu us\n",
+               name, h->count,
+               sched_histogram_percentile(h, 50),
+               sched_histogram_percentile(h, 90),
+               sched_histogram_percentile(h, 99),
+               h->max);
+
+    if (!buckets) {
+        return;
+    }
+
+    for (int i = 0; i < SCHED_HIST_BUCKETS; i++) {
+        if (0 == h->buckets[i]) {
+            continue;
+        }
+        lo = i > 0 ? sched_histogram_bucket_limit(i - 1) + 1 : 0;
+        if (i == SCHED_HIST_BUCKETS - 1) {
+            cmd.printf("        >= %lu: %lu\n", lo, h->buckets[i]);
+        } else {
+            cmd.printf("        %lu-%lu: %lu\n", lo,
+                       sched_histogram_bucket_limit(i), h->buckets[i]);
+        }
+    }
+}
+
+static void cmd_cb_sched(vector<string>& params)
+{
+    bool buckets;
+    struct sched_task *t;
+
+    if (params.size() < 2) {
+        cmd.printf("Usage: sched stats [task] | sched reset\n");
+        return;
+    }
+
+    if (params[1] == "reset") {
+        for (int i = 0; i < SCHED_TASK_COUNT; i++) {
+            sched_task_reset(&sensors.tasks[i]);
+        }
+        return;
+    }
+
+    if (params[1] != "stats") {
+        cmd.printf("ERROR: unsupported option %s!\n", params[1].c_str());
+        return;
+    }
+
+    for (int i = 0; i < SCHED_TASK_COUNT; i++) {
+        t = &sensors.tasks[i];
+        if (NULL == t->name) {
+            continue;
+        }
+
+        /* show the full histograms when a single task is requested */
+        buckets = params.size() > 2;
+        if (buckets && params[2] != t->name) {
+            continue;
+        }
+
+        cmd.printf("%s: period=%lu ms runs=%lu early=%lu\n", t->name,
+                   t->period_us / 1000, t->runs, t->early);
+        cmd_print_sched_histogram("jitter", &t->jitter, buckets);
+        cmd_print_sched_histogram("duration", &t->duration, buckets);
+        if (t->latency.count > 0) {
+            cmd_print_sched_histogram("latency", &t->latency, buckets);
+        }
+    }
+}
+
+static struct sensor_channel *find_sensor_channel(const std::string &key)
+{
+    for (int i = 0; i < SENSOR_CHANNEL_COUNT; i++) {
+        if (NULL != sensors.channels[i] && key == sensors.channels[i]->key) {
+            return sensors.channels[i];
+        }
+    }
+
+    return NULL;
+}
+
+struct history_print_ctx {
+    struct sensor_channel *ch;
+    uint32_t bucket_secs;
+    uint32_t bucket_start;
+    struct sensor_stats stats;
+};
+
+static void history_print_sample(void *context, uint32_t time, int32_t value)
+{
+    char str[FIXED_STRLEN];
+    struct history_print_ctx *ctx = (struct history_print_ctx *)context;
+
+    fixed_format(str, sizeof(str), value, ctx->ch->precision);
+    cmd.printf("%lu %s\n", time, str);
+}
+
+static void history_print_rollup(struct history_print_ctx *ctx)
+{
+    char min[FIXED_STRLEN];
+    char mean[FIXED_STRLEN];
+    char max[FIXED_STRLEN];
+
+    if (0 == ctx->stats.count) {
+        return;
+    }
+
+    fixed_format_float(min, sizeof(min), ctx->stats.min, ctx->ch->precision);
+    fixed_format_float(mean, sizeof(mean), ctx->stats.mean,
+                       ctx->ch->precision);
+    fixed_format_float(max, sizeof(max), ctx->stats.max, ctx->ch->precision);
+    cmd.printf("%lu n=%lu min=%s mean=%s max=%s\n",
+               ctx->bucket_start, ctx->stats.count, min, mean, max);
+}
+
+static void history_rollup_sample(void *context, uint32_t time, int32_t value)
+{
+    uint32_t bucket;
+    struct history_print_ctx *ctx = (struct history_print_ctx *)context;
+
+    bucket = time - (time % ctx->bucket_secs);
+    if (bucket != ctx->bucket_start) {
+        history_print_rollup(ctx);
+        sensor_stats_reset(&ctx->stats);
+        ctx->bucket_start = bucket;
+    }
+
+    sensor_stats_add(&ctx->stats, (float)value / ctx->ch->scale);
+}
+
+static void cmd_cb_history(vector<string>& params)
+{
+    int ret;
+    Timer t;
+    uint32_t now;
+    uint32_t secs;
+    char str[FIXED_STRLEN];
+    struct history_print_ctx ctx;
+
+    if (params.size() < 2) {
+        cmd.printf("samples: %lu saved: %lu bytes: %lu",
+                   history.samples(), history.samples_saved(),
+                   history.bytes_saved());
+        if (history.samples_saved() > 0) {
+            /* bytes per sample with two decimal places */
+            fixed_format(str, sizeof(str),
+                         (uint64_t)history.bytes_saved() * 100 /
+                         history.samples_saved(), 2);
+            cmd.printf(" (%s bytes/sample)", str);
+        }
+        cmd.printf("\n");
+        return;
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.ch = find_sensor_channel(params[1]);
+    if (NULL == ctx.ch) {
+        cmd.printf("ERROR: unknown sensor %s\n", params[1].c_str());
+        return;
+    }
+
+    secs = 60;
+    if (params.size() > 2) {
+        secs = strtoul(params[2].c_str(), NULL, 10);
+    }
+
+    now = evq.tick() / 1000;
+    if (secs > now) {
+        secs = now;
+    }
+
+    t.start();
+    if (params.size() > 3) {
+        ctx.bucket_secs = strtoul(params[3].c_str(), NULL, 10);
+        if (0 == ctx.bucket_secs) {
+            cmd.printf("ERROR: invalid rollup interval\n");
+            return;
+        }
+        ctx.bucket_start = UINT32_MAX;
+        ret = history.query(ctx.ch->id, now - secs, now,
+                            history_rollup_sample, &ctx);
+        history_print_rollup(&ctx);
+    } else {
+        ret = history.query(ctx.ch->id, now - secs, now,
+                            history_print_sample, &ctx);
+    }
+    t.stop();
+
+    cmd.printf("%d samples in %d ms\n", ret, t.read_ms());
+}
+
+#if MBED_CONF_APP_SENSORS_SIMULATED
+/**
+ * Prints the results of a finished replay
+ */
+static void sim_replay_print(struct sim_replay *r)
+{
+    uint32_t counts[3] = {0};
+    struct sensor_channel *ch;
+    static const char *stage_names[SIM_STAGE_COUNT] = {
+        "source", "calibrate", "update", "pack"
+    };
+
+    for (int i = 0; i < SIM_REPLAY_CHANNELS; i++) {
+        ch = r->channels[i];
+        counts[0] += ch->sent;
+        counts[1] += ch->suppressed;
+        counts[2] += ch->rejected;
+    }
+
+    cmd.printf("%lu samples of %lu s in %lu ms, %lu readings/s\n",
+               r->samples, (uint32_t)((uint64_t)r->samples * r->step_ms / 1000),
+               r->elapsed_us / 1000,
+               (uint32_t)((uint64_t)r->samples * SIM_VALUE_COUNT *
+                          1000000 / (r->elapsed_us ? r->elapsed_us : 1)));
+    cmd.printf("reported: %lu suppressed: %lu rejected: %lu\n",
+               counts[0], counts[1], counts[2]);
+    for (int i = 0; i < SIM_STAGE_COUNT; i++) {
+        cmd_print_sched_histogram(stage_names[i], &r->stages[i], false);
+    }
+}
+
+/**
+ * Replays the next chunk of samples, then queues the rest on the event queue
+ */
+static void sim_replay_run(void)
+{
+    int len;
+    uint32_t end;
+    uint32_t sent;
+    uint32_t start_us;
+    uint32_t t[SIM_STAGE_COUNT + 1];
+    float values[SIM_VALUE_COUNT];
+    float lux, temperature, humidity;
+    struct sim_replay *r = &sim.replay;
+    static uint8_t pack[SENSORS_PACK_SIZE];
+
+    end = std::min(r->done + SIM_REPLAY_CHUNK, r->samples);
+    start_us = us_ticker_read();
+    for (; r->done < end; r->done++) {
+        t[SIM_STAGE_SOURCE] = us_ticker_read();
+        sim_read(&r->src, r->done * r->step_ms, values);
+
+        t[SIM_STAGE_CALIBRATE] = us_ticker_read();
+        lux = calibration_apply(&r->light.lux.cal, values[SIM_VALUE_LUX]);
+        temperature = calibration_apply(&r->dht.temp.cal,
+                                        values[SIM_VALUE_TEMP]);
+        humidity = calibration_apply(&r->dht.humidity.cal,
+                                     values[SIM_VALUE_HUMIDITY]);
+
+        t[SIM_STAGE_UPDATE] = us_ticker_read();
+        sent = r->light.lux.sent + r->dht.temp.sent + r->dht.humidity.sent;
+        light_update(&r->light, lux, r->tick);
+        dht_update(&r->dht, temperature, humidity, r->tick);
+
+        /* packed as it would be published, but not sent */
+        t[SIM_STAGE_PACK] = us_ticker_read();
+        if (sent != r->light.lux.sent + r->dht.temp.sent +
+                    r->dht.humidity.sent) {
+            len = sensors_write_pack(r->channels, SIM_REPLAY_CHANNELS, r->tick,
+                                     pack, sizeof(pack));
+            if (len < 0) {
+                cmd.printf("ERROR: sensor pack exceeds %d bytes\n",
+                           SENSORS_PACK_SIZE);
+            }
+        }
+
+        t[SIM_STAGE_COUNT] = us_ticker_read();
+        for (int j = 0; j < SIM_STAGE_COUNT; j++) {
+            sched_histogram_add(&r->stages[j], t[j + 1] - t[j]);
+        }
+        r->tick += r->step_ms;
+    }
+    r->elapsed_us += us_ticker_read() - start_us;
+
+    if (r->done < r->samples) {
+        if (0 != evq.call(sim_replay_run)) {
+            return;
+        }
+        cmd.printf("ERROR: replay stopped after %lu samples, "
+                   "event queue full\n", r->done);
+        r->samples = r->done;
+    }
+
+    sim_close(&r->src);
+    sim.replaying = false;
+    sim_replay_print(r);
+}
+
+/**
+ * Feeds simulated readings through the sensor pipeline as fast as possible
+ *
+ * Samples are taken every step-ms of virtual time, starting at the current
+ * time, and go through the same calibration, filtering, aggregation,
+ * deadband and packing code as the periodic sensor tasks.  They run on
+ * copies of the sensor channels, which are neither stored in the history,
+ * shown nor published, so the live readings carry on as if there had been
+ * no replay.  The replay runs on the event queue in chunks of
+ * SIM_REPLAY_CHUNK samples, and each stage is timed separately.
+ */
+static void cmd_cb_sim(vector<string>& params)
+{
+    int ret;
+    uint32_t samples;
+    uint32_t step_ms;
+    const char *path;
+    struct sim_replay *r = &sim.replay;
+
+    if (params.size() < 3 || params[1] != "replay") {
+        cmd.printf("Usage: sim replay <samples> [step-ms] [trace]\n");
+        return;
+    }
+
+    if (sim.replaying) {
+        cmd.printf("ERROR: a replay is already running\n");
+        return;
+    }
+
+    samples = strtoul(params[2].c_str(), NULL, 10);
+    step_ms = SIM_REPLAY_STEP_MS;
+    if (params.size() > 3) {
+        step_ms = strtoul(params[3].c_str(), NULL, 10);
+    }
+    if (0 == samples || 0 == step_ms) {
+        cmd.printf("ERROR: invalid sample count or step\n");
+        return;
+    }
+
+    path = params.size() > 4 ? params[4].c_str() : NULL;
+    ret = sim_open(&r->src, path);
+    if (0 != ret) {
+        cmd.printf("ERROR: failed to open %s: %d\n",
+                   NULL != path ? path : "waveforms", ret);
+        return;
+    }
+
+    /* the copies start from the live state, calibration and settings */
+    r->light = sensors.light;
+    r->dht = sensors.dht;
+    r->channels[0] = &r->light.lux;
+    r->channels[1] = &r->dht.temp;
+    r->channels[2] = &r->dht.humidity;
+    for (int i = 0; i < SIM_REPLAY_CHANNELS; i++) {
+        r->channels[i]->scratch = true;
+        r->channels[i]->sent = 0;
+        r->channels[i]->suppressed = 0;
+        r->channels[i]->rejected = 0;
+    }
+    for (int i = 0; i < SIM_STAGE_COUNT; i++) {
+        sched_histogram_reset(&r->stages[i]);
+    }
+    r->samples = samples;
+    r->done = 0;
+    r->step_ms = step_ms;
+    r->tick = evq.tick();
+    r->elapsed_us = 0;
+
+    sim.replaying = true;
+    sim_replay_run();
+}
+#endif
+
 static void cmd_pump(Commander *cmd)
 {
     cmd->pump();
@@ -1561,6 +4562,28 @@ void init_commander(void)
             "Enables verbose printing of sensor values when set 'on'. Usage: verbose <type> [off|on], defeaults to off",
             cmd_cb_verbose);
 
+    cmd.add("sensors",
+            "Show sensor window statistics and notification counters. Usage: sensors",
+            cmd_cb_sensors);
+
+    cmd.add("sched",
+            "Show timing of the periodic sensor tasks. Usage: sched stats [task] | sched reset",
+            cmd_cb_sched);
+
+    cmd.add("uplink",
+            "Show the queue of readings taken while offline. Usage: uplink",
+            cmd_cb_uplink);
+
+    cmd.add("history",
+            "Show sensor history. Usage: history [<sensor> [secs] [rollup-secs]]",
+            cmd_cb_history);
+
+#if MBED_CONF_APP_SENSORS_SIMULATED
+    cmd.add("sim",
+            "Replay simulated sensor readings at accelerated time. Usage: sim replay <samples> [step-ms] [trace]",
+            cmd_cb_sim);
+#endif
+
     cmd.add("format",
             "Format the internal file system. Usage: format <fs-type>",
             cmd_cb_format);
@@ -1596,29 +4619,33 @@ void init_commander(void)
     cmd.init();
 }
 
-static void init_app_label(M2MClient *m2m)
+static void app_label_load(M2MClient *m2m, Keystore &k)
 {
-    Keystore k;
     string label;
 
-    display.register_sensor(APP_LABEL_SENSOR_NAME);
-
-    k.open();
     if (k.exists(APP_LABEL_KEY)) {
         label = k.get(APP_LABEL_KEY);
     } else {
         label = MBED_CONF_APP_APP_LABEL;
     }
-    k.close();
 
     set_app_label(m2m, label.c_str());
 }
 
-static void init_geo(M2MClient *m2m)
+static void init_app_label(M2MClient *m2m)
 {
     Keystore k;
 
+    display.register_sensor(APP_LABEL_SENSOR_NAME);
+
     k.open();
+    app_label_load(m2m, k);
+    k.close();
+}
+
+static void geo_load(M2MClient *m2m, Keystore &k)
+{
+    m2m->begin_update();
 
     if (k.exists(GEO_LAT_KEY)) {
         m2m->set_resource_value(M2MClient::M2MClientResourceGeoLat,
@@ -1650,6 +4677,15 @@ static void init_geo(M2MClient *m2m)
 #endif
     }
 
+    m2m->end_update();
+}
+
+static void init_geo(M2MClient *m2m)
+{
+    Keystore k;
+
+    k.open();
+    geo_load(m2m, k);
     k.close();
 }
 
@@ -1674,6 +4710,9 @@ static void init_app(EventQueue *queue)
     m2mclient = new M2MClient();
     m2mclient->init();
 
+    reconnect_init(&reconnect, MBED_CONF_APP_RECONNECT_BASE_MS,
+                   MBED_CONF_APP_RECONNECT_MAX_MS, us_ticker_read());
+
     init_app_label(m2mclient);
     init_geo(m2mclient);
 
@@ -1715,6 +4754,7 @@ static void init_app(EventQueue *queue)
     cmd.printf("init sensors\n");
     sensors_init(&sensors, m2mclient);
     sensors_start(&sensors, &evq);
+    telemetry_start();
 
     /* connect to mbed cloud */
     cmd.printf("init mbed client\n");
@@ -1722,6 +4762,9 @@ static void init_app(EventQueue *queue)
      * before the mbed client connects to the cloud, otherwise the
      * sensor resources will not exist in the portal. */
     register_mbed_client(net, m2mclient);
+
+    /* stay around to recover the network when it goes down */
+    net_evq.dispatch_forever();
 }
 
 // ****************************************************************************
@@ -1731,7 +4774,8 @@ static void init_app(EventQueue *queue)
 // Be aware of 3 threads of execution.
 // 1. The init thread is kicked off when the app first starts and is
 // responsible for bringing up the mbed client, the network, the sensors,
-// etc., and exits as soon as initialization is complete.
+// etc.  Once initialization is complete, it dispatches the network event
+// queue, which brings the network back up when it goes down.
 // 2. The main thread dispatches the event queue and is where all normal
 // runtime operations are processed.
 // 3. The firmware update thread runs in the context of the mbed client and
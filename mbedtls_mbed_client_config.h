@@ -51,6 +51,9 @@
 #define MBEDTLS_SSL_DTLS_ANTI_REPLAY
 #define MBEDTLS_SSL_DTLS_HELLO_VERIFY
 #define MBEDTLS_SSL_EXPORT_KEYS
+// Accept session tickets, so that tls_session.cpp can resume the previous
+// session without a session cache on the server
+#define MBEDTLS_SSL_SESSION_TICKETS
 
 /* mbed TLS modules */
 #define MBEDTLS_AES_C
@@ -0,0 +1,116 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "reconnect.h"
+
+#include <string.h>
+
+void reconnect_init(struct reconnect *r, uint32_t base_ms, uint32_t max_ms,
+                    uint32_t seed)
+{
+    memset(r, 0, sizeof(*r));
+    /* nothing is up yet, but that isn't an outage */
+    r->state = RECONNECT_NET_DOWN;
+    r->base_ms = base_ms;
+    r->max_ms = max_ms;
+    r->seed = 0 != seed ? seed : 1;
+}
+
+/* starts an outage, unless one is already going on */
+static bool reconnect_start(struct reconnect *r, unsigned now)
+{
+    if (r->outage) {
+        return false;
+    }
+    r->outage = true;
+    r->down_tick = now;
+    return true;
+}
+
+void reconnect_net_down(struct reconnect *r, unsigned now)
+{
+    if (reconnect_start(r, now)) {
+        r->net_outages++;
+    }
+    if (RECONNECT_NET_DOWN != r->state) {
+        r->state = RECONNECT_NET_DOWN;
+        r->attempts = 0;
+    }
+}
+
+void reconnect_net_up(struct reconnect *r)
+{
+    if (RECONNECT_NET_DOWN == r->state) {
+        r->state = RECONNECT_CLOUD_DOWN;
+        r->attempts = 0;
+    }
+}
+
+void reconnect_cloud_down(struct reconnect *r, unsigned now)
+{
+    if (reconnect_start(r, now)) {
+        r->cloud_outages++;
+    }
+    if (RECONNECT_UP == r->state) {
+        r->state = RECONNECT_CLOUD_DOWN;
+        r->attempts = 0;
+    }
+}
+
+void reconnect_cloud_up(struct reconnect *r, unsigned now)
+{
+    uint32_t recover_ms;
+
+    if (r->outage) {
+        recover_ms = now - r->down_tick;
+        r->last_recover_ms = recover_ms;
+        if (recover_ms > r->max_recover_ms) {
+            r->max_recover_ms = recover_ms;
+        }
+        r->total_recover_ms += recover_ms;
+        r->recoveries++;
+        r->outage = false;
+    }
+    r->state = RECONNECT_UP;
+    r->attempts = 0;
+}
+
+uint32_t reconnect_delay(struct reconnect *r)
+{
+    uint32_t delay = r->max_ms;
+
+    /* base_ms << attempts, without overflowing */
+    if (r->attempts < 32 && r->base_ms <= (r->max_ms >> r->attempts)) {
+        delay = r->base_ms << r->attempts;
+    }
+    r->attempts++;
+
+    /* xorshift32 */
+    r->seed ^= r->seed << 13;
+    r->seed ^= r->seed >> 17;
+    r->seed ^= r->seed << 5;
+
+    return delay / 2 + r->seed % (delay / 2 + 1);
+}
+
+uint32_t reconnect_mean_recover_ms(const struct reconnect *r)
+{
+    if (0 == r->recoveries) {
+        return 0;
+    }
+    return r->total_recover_ms / r->recoveries;
+}
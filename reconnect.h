@@ -0,0 +1,86 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef RECONNECT_H
+#define RECONNECT_H
+
+#include <stdint.h>
+
+enum reconnect_state {
+    /* registered with mbed cloud */
+    RECONNECT_UP,
+    /* the network is up, waiting for the mbed client to register */
+    RECONNECT_CLOUD_DOWN,
+    /* the network link is down */
+    RECONNECT_NET_DOWN,
+};
+
+/*
+ * Connectivity state and retry timing.
+ *
+ * An outage starts when the network or the cloud connection goes down and
+ * ends when the client has registered again.  Within an outage, every
+ * retry waits twice as long as the one before, from base_ms up to max_ms,
+ * with "equal jitter": half of the delay is fixed and the other half is
+ * random, so that devices that lost a shared access point don't all retry
+ * at once.  The backoff starts over when the network comes back, as that
+ * starts a new stage of recovery.
+ *
+ * Times are event queue ticks in ms, recovery times are from the start of
+ * an outage to the registration that ended it.
+ */
+struct reconnect {
+    enum reconnect_state state;
+    uint32_t base_ms;
+    uint32_t max_ms;
+    /* set from the start of an outage until the next registration */
+    bool outage;
+    /* retries in the current stage of the outage */
+    unsigned attempts;
+    unsigned down_tick;
+    uint32_t seed;
+    /* outages by how they started */
+    uint32_t net_outages;
+    uint32_t cloud_outages;
+    uint32_t recoveries;
+    uint32_t last_recover_ms;
+    uint32_t max_recover_ms;
+    uint64_t total_recover_ms;
+};
+
+void reconnect_init(struct reconnect *r, uint32_t base_ms, uint32_t max_ms,
+                    uint32_t seed);
+
+/* the network link is down */
+void reconnect_net_down(struct reconnect *r, unsigned now);
+
+/* the network link is back, the client will register again */
+void reconnect_net_up(struct reconnect *r);
+
+/* the cloud connection failed while the network link is up */
+void reconnect_cloud_down(struct reconnect *r, unsigned now);
+
+/* the client registered, which ends any outage */
+void reconnect_cloud_up(struct reconnect *r, unsigned now);
+
+/* returns how long to wait before the next retry, and counts it */
+uint32_t reconnect_delay(struct reconnect *r);
+
+/* returns the mean time to recover, 0 until the first recovery */
+uint32_t reconnect_mean_recover_ms(const struct reconnect *r);
+
+#endif /* RECONNECT_H */
@@ -0,0 +1,157 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "schedstats.h"
+
+#include <string.h>
+
+void sched_histogram_reset(struct sched_histogram *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+void sched_histogram_add(struct sched_histogram *h, uint32_t us)
+{
+    int bucket = 0;
+    uint32_t v = us;
+
+    while (v > 0 && bucket < SCHED_HIST_BUCKETS - 1) {
+        v >>= 1;
+        bucket++;
+    }
+
+    h->buckets[bucket]++;
+    h->count++;
+    if (us > h->max) {
+        h->max = us;
+    }
+}
+
+uint32_t sched_histogram_bucket_limit(int bucket)
+{
+    if (bucket <= 0) {
+        return 0;
+    }
+    if (bucket >= SCHED_HIST_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+    return (1UL << bucket) - 1;
+}
+
+uint32_t sched_histogram_percentile(const struct sched_histogram *h, int pct)
+{
+    uint32_t seen = 0;
+    uint32_t target;
+
+    if (0 == h->count) {
+        return 0;
+    }
+
+    /* rank of the sample at pct, rounded up */
+    target = ((uint64_t)h->count * pct + 99) / 100;
+    if (0 == target) {
+        target = 1;
+    }
+
+    for (int i = 0; i < SCHED_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target) {
+            /* the bucket limit can't be more than the largest sample */
+            return sched_histogram_bucket_limit(i) < h->max ?
+                   sched_histogram_bucket_limit(i) : h->max;
+        }
+    }
+
+    return h->max;
+}
+
+void sched_task_init(struct sched_task *t, const char *name,
+                     Callback<void()> fn)
+{
+    t->name = name;
+    t->fn = fn;
+    t->period_us = 0;
+    t->next_us = 0;
+    t->start_us = 0;
+    sched_task_reset(t);
+}
+
+void sched_task_start(struct sched_task *t, uint32_t period_ms)
+{
+    t->period_us = period_ms * 1000;
+    t->next_us = 0;
+}
+
+static void sched_task_begin(struct sched_task *t)
+{
+    int32_t late;
+
+    t->start_us = us_ticker_read();
+    if (0 != t->next_us) {
+        late = (int32_t)(t->start_us - t->next_us);
+        if (late < 0) {
+            /* the queue ticks in ms, so runs can be slightly early */
+            t->early++;
+            late = 0;
+        }
+        sched_histogram_add(&t->jitter, late);
+        t->next_us += t->period_us;
+    } else {
+        t->next_us = t->start_us + t->period_us;
+    }
+
+    /* keep 0 free to mean "not started" */
+    if (0 == t->next_us) {
+        t->next_us = 1;
+    }
+    t->runs++;
+}
+
+static void sched_task_end(struct sched_task *t)
+{
+    sched_histogram_add(&t->duration, us_ticker_read() - t->start_us);
+}
+
+void sched_task_run(struct sched_task *t)
+{
+    sched_task_begin(t);
+    t->fn();
+    sched_task_end(t);
+}
+
+void sched_task_set_due(struct sched_task *t, uint32_t period_ms,
+                        uint32_t late_ms)
+{
+    t->period_us = period_ms * 1000;
+    t->next_us = us_ticker_read() - late_ms * 1000;
+    if (0 == t->next_us) {
+        t->next_us = 1;
+    }
+}
+
+void sched_task_published(struct sched_task *t)
+{
+    sched_histogram_add(&t->latency, us_ticker_read() - t->start_us);
+}
+
+void sched_task_reset(struct sched_task *t)
+{
+    t->runs = 0;
+    t->early = 0;
+    sched_histogram_reset(&t->jitter);
+    sched_histogram_reset(&t->duration);
+    sched_histogram_reset(&t->latency);
+}
@@ -0,0 +1,91 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCHEDSTATS_H
+#define SCHEDSTATS_H
+
+#include <mbed.h>
+#include <stdint.h>
+
+/*
+ * bucket 0 holds 0 us, bucket i holds [2^(i-1), 2^i) us, and the last
+ * bucket holds everything above, 2^22 us is a little over 4 seconds.
+ */
+#define SCHED_HIST_BUCKETS 24
+
+/*
+ * Fixed-size log2 histogram of times in microseconds.
+ */
+struct sched_histogram {
+    uint32_t buckets[SCHED_HIST_BUCKETS];
+    uint32_t count;
+    uint32_t max;
+};
+
+/*
+ * Timing of a periodic task on the event queue.
+ *
+ * jitter   - how late the task started compared to its ideal schedule
+ * duration - how long the task ran
+ * latency  - time from the start of the task until its result was handed
+ *            to the mbed client
+ */
+struct sched_task {
+    const char *name;
+    /* the work done by the task, see sched_task_run() */
+    Callback<void()> fn;
+    uint32_t period_us;
+    /* ideal start of the next run, 0 until the first run */
+    uint32_t next_us;
+    uint32_t start_us;
+    uint32_t runs;
+    /* runs that started before their ideal time */
+    uint32_t early;
+    struct sched_histogram jitter;
+    struct sched_histogram duration;
+    struct sched_histogram latency;
+};
+
+void sched_histogram_reset(struct sched_histogram *h);
+void sched_histogram_add(struct sched_histogram *h, uint32_t us);
+
+/* returns the upper bound, in us, of the bucket holding the pct percentile */
+uint32_t sched_histogram_percentile(const struct sched_histogram *h, int pct);
+
+/* returns the upper bound, in us, of a bucket */
+uint32_t sched_histogram_bucket_limit(int bucket);
+
+void sched_task_init(struct sched_task *t, const char *name,
+                     Callback<void()> fn);
+
+/* restarts the ideal schedule, e.g. when the task is (re)scheduled */
+void sched_task_start(struct sched_task *t, uint32_t period_ms);
+
+/* for tasks with a varying period, sets the current period and how late
+ * the run about to start is.  call right before sched_task_run(). */
+void sched_task_set_due(struct sched_task *t, uint32_t period_ms,
+                        uint32_t late_ms);
+
+/* runs the task once, timing it.  schedule this on the event queue. */
+void sched_task_run(struct sched_task *t);
+
+/* records the result of the current run being handed to the mbed client */
+void sched_task_published(struct sched_task *t);
+
+/* clears all histograms and counters */
+void sched_task_reset(struct sched_task *t);
+
+#endif /* SCHEDSTATS_H */
@@ -0,0 +1,123 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "senml.h"
+
+#include <string.h>
+
+#define CBOR_TYPE_UINT      (0 << 5)
+#define CBOR_TYPE_NINT      (1 << 5)
+#define CBOR_TYPE_TEXT      (3 << 5)
+#define CBOR_TYPE_ARRAY     (4 << 5)
+#define CBOR_TYPE_MAP       (5 << 5)
+#define CBOR_FLOAT32        (0xFA)
+
+void senml_writer_init(struct senml_writer *w, uint8_t *buf, size_t size)
+{
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->overflow = false;
+}
+
+static void senml_put(struct senml_writer *w, const uint8_t *data, size_t len)
+{
+    if (w->overflow || w->size - w->len < len) {
+        w->overflow = true;
+        return;
+    }
+
+    memcpy(&w->buf[w->len], data, len);
+    w->len += len;
+}
+
+/* writes the initial byte of an item and its argument in big endian */
+static void senml_put_head(struct senml_writer *w, uint8_t type, uint32_t val)
+{
+    uint8_t head[5];
+    size_t len;
+
+    if (val < 24) {
+        head[0] = type | val;
+        len = 1;
+    } else if (val <= 0xFF) {
+        head[0] = type | 24;
+        head[1] = val;
+        len = 2;
+    } else if (val <= 0xFFFF) {
+        head[0] = type | 25;
+        head[1] = val >> 8;
+        head[2] = val;
+        len = 3;
+    } else {
+        head[0] = type | 26;
+        head[1] = val >> 24;
+        head[2] = val >> 16;
+        head[3] = val >> 8;
+        head[4] = val;
+        len = 5;
+    }
+
+    senml_put(w, head, len);
+}
+
+void senml_write_array(struct senml_writer *w, size_t count)
+{
+    senml_put_head(w, CBOR_TYPE_ARRAY, count);
+}
+
+void senml_write_map(struct senml_writer *w, size_t count)
+{
+    senml_put_head(w, CBOR_TYPE_MAP, count);
+}
+
+void senml_write_int(struct senml_writer *w, int32_t val)
+{
+    if (val >= 0) {
+        senml_put_head(w, CBOR_TYPE_UINT, val);
+    } else {
+        /* -1 - n, computed without overflowing INT32_MIN */
+        senml_put_head(w, CBOR_TYPE_NINT, (uint32_t)(-(val + 1)));
+    }
+}
+
+void senml_write_text(struct senml_writer *w, const char *str)
+{
+    size_t len = strlen(str);
+
+    senml_put_head(w, CBOR_TYPE_TEXT, len);
+    senml_put(w, (const uint8_t *)str, len);
+}
+
+void senml_write_number(struct senml_writer *w, float val)
+{
+    uint8_t data[5];
+    uint32_t bits;
+
+    if (val >= -2147483648.0f && val < 2147483648.0f &&
+        val == (float)(int32_t)val) {
+        senml_write_int(w, (int32_t)val);
+        return;
+    }
+
+    memcpy(&bits, &val, sizeof(bits));
+    data[0] = CBOR_FLOAT32;
+    data[1] = bits >> 24;
+    data[2] = bits >> 16;
+    data[3] = bits >> 8;
+    data[4] = bits;
+    senml_put(w, data, sizeof(data));
+}
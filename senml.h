@@ -0,0 +1,57 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENML_H
+#define SENML_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* SenML CBOR labels, RFC 8428 section 6 */
+#define SENML_LABEL_BASE_NAME   (-2)
+#define SENML_LABEL_BASE_TIME   (-3)
+#define SENML_LABEL_NAME        (0)
+#define SENML_LABEL_UNIT        (1)
+#define SENML_LABEL_VALUE       (2)
+#define SENML_LABEL_TIME        (6)
+
+/*
+ * Minimal CBOR writer for SenML packs.
+ *
+ * Everything is written to a caller supplied buffer, nothing is allocated.
+ * Once the buffer is full, further writes are dropped and the writer is
+ * flagged as overflowed, so callers only need to check once at the end.
+ */
+struct senml_writer {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+};
+
+void senml_writer_init(struct senml_writer *w, uint8_t *buf, size_t size);
+
+/* starts an array or map of count items (or key/value pairs) */
+void senml_write_array(struct senml_writer *w, size_t count);
+void senml_write_map(struct senml_writer *w, size_t count);
+
+void senml_write_int(struct senml_writer *w, int32_t val);
+void senml_write_text(struct senml_writer *w, const char *str);
+
+/* writes integral values as integers, everything else as a float32 */
+void senml_write_number(struct senml_writer *w, float val);
+
+#endif /* SENML_H */
@@ -0,0 +1,58 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "sensorstats.h"
+
+#include <math.h>
+#include <string.h>
+
+void sensor_stats_reset(struct sensor_stats *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+void sensor_stats_add(struct sensor_stats *s, float val)
+{
+    float delta;
+
+    if (0 == s->count) {
+        s->min = val;
+        s->max = val;
+    } else if (val < s->min) {
+        s->min = val;
+    } else if (val > s->max) {
+        s->max = val;
+    }
+
+    s->count++;
+    delta = val - s->mean;
+    s->mean += delta / s->count;
+    s->m2 += delta * (val - s->mean);
+}
+
+float sensor_stats_variance(const struct sensor_stats *s)
+{
+    if (s->count < 2) {
+        return 0.0f;
+    }
+
+    return s->m2 / (s->count - 1);
+}
+
+float sensor_stats_stddev(const struct sensor_stats *s)
+{
+    return sqrtf(sensor_stats_variance(s));
+}
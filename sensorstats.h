@@ -0,0 +1,49 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSORSTATS_H
+#define SENSORSTATS_H
+
+#include <stdint.h>
+
+/*
+ * Running statistics for a single sensor channel over a reporting window.
+ *
+ * Samples are not stored.  The mean and variance are tracked using
+ * Welford's online algorithm which is numerically stable for long windows
+ * and costs one divide per sample.
+ */
+struct sensor_stats {
+    uint32_t count;
+    float min;
+    float max;
+    float mean;
+    float m2;   /* sum of squared differences from the mean */
+};
+
+/* clears all accumulated values and starts a new window */
+void sensor_stats_reset(struct sensor_stats *s);
+
+/* adds a single sample to the window */
+void sensor_stats_add(struct sensor_stats *s, float val);
+
+/* returns the sample variance of the window, 0 if fewer than 2 samples */
+float sensor_stats_variance(const struct sensor_stats *s);
+
+/* returns the sample standard deviation of the window */
+float sensor_stats_stddev(const struct sensor_stats *s);
+
+#endif /* SENSORSTATS_H */
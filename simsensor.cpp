@@ -0,0 +1,170 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "simsensor.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_PI 3.14159265f
+
+/* synthetic waveforms: mean, amplitude, period and noise of raw readings */
+static const struct {
+    float mean;
+    float amplitude;
+    uint32_t period_ms;
+    float noise;
+} sim_waves[SIM_VALUE_COUNT] = {
+    { 110.0f, 95.0f, 600000, 2.0f },    /* lux */
+    { 33.0f, 3.0f, 1800000, 0.05f },    /* temp */
+    { 21.0f, 5.0f, 1200000, 0.3f },     /* humidity */
+};
+
+/* deterministic noise in [-1, 1] for a time and channel */
+static float sim_noise(uint32_t time_ms, int channel)
+{
+    uint32_t h = time_ms * 2654435761UL + channel * 40503UL;
+
+    h ^= h >> 15;
+    h *= 2246822519UL;
+    h ^= h >> 13;
+
+    return (float)(h & 0xFFFF) / 32767.5f - 1.0f;
+}
+
+/* reads the next row of the trace, returns 0 on success */
+static int sim_read_row(FILE *fp, uint32_t *time_ms,
+                        float values[SIM_VALUE_COUNT])
+{
+    char line[80];
+    char *p;
+    char *end;
+
+    while (NULL != fgets(line, sizeof(line), fp)) {
+        if (!isdigit((unsigned char)line[0])) {
+            continue;
+        }
+
+        *time_ms = strtoul(line, &end, 10);
+        for (int i = 0; i < SIM_VALUE_COUNT; i++) {
+            if (',' != *end) {
+                break;
+            }
+            p = end + 1;
+            values[i] = strtof(p, &end);
+            if (end == p) {
+                break;
+            }
+            if (i == SIM_VALUE_COUNT - 1) {
+                return 0;
+            }
+        }
+        printf("WARN: sim: skipping malformed row: %s", line);
+    }
+
+    return -1;
+}
+
+/* reads the row after the current one, starting over at the end */
+static int sim_next_row(struct sim_source *src)
+{
+    uint32_t time_ms;
+
+    if (0 != sim_read_row(src->fp, &time_ms, src->next)) {
+        rewind(src->fp);
+        if (0 != sim_read_row(src->fp, &time_ms, src->next)) {
+            return -1;
+        }
+        src->base_ms = src->row_ms + (src->gap_ms ? src->gap_ms : 1);
+    }
+
+    src->next_ms = src->base_ms + time_ms - src->first_ms;
+
+    return 0;
+}
+
+int sim_open(struct sim_source *src, const char *path)
+{
+    memset(src, 0, sizeof(*src));
+    if (NULL == path) {
+        return 0;
+    }
+
+    src->fp = fopen(path, "r");
+    if (NULL == src->fp) {
+        return -errno;
+    }
+
+    if (0 != sim_read_row(src->fp, &src->first_ms, src->row)) {
+        printf("ERROR: sim: %s has no rows\n", path);
+        sim_close(src);
+        return -EINVAL;
+    }
+
+    /* a single row is held forever */
+    if (0 != sim_read_row(src->fp, &src->next_ms, src->next)) {
+        src->next_ms = 0xFFFFFFFFUL;
+        return 0;
+    }
+    src->next_ms -= src->first_ms;
+
+    return 0;
+}
+
+void sim_close(struct sim_source *src)
+{
+    if (NULL != src->fp) {
+        fclose(src->fp);
+    }
+    src->fp = NULL;
+}
+
+static void sim_read_trace(struct sim_source *src, uint32_t time_ms,
+                           float values[SIM_VALUE_COUNT])
+{
+    while (time_ms >= src->next_ms) {
+        src->gap_ms = src->next_ms - src->row_ms;
+        src->row_ms = src->next_ms;
+        memcpy(src->row, src->next, sizeof(src->row));
+        if (0 != sim_next_row(src)) {
+            break;
+        }
+    }
+
+    memcpy(values, src->row, sizeof(src->row));
+}
+
+void sim_read(struct sim_source *src, uint32_t time_ms,
+              float values[SIM_VALUE_COUNT])
+{
+    float phase;
+
+    if (NULL != src->fp) {
+        sim_read_trace(src, time_ms, values);
+        return;
+    }
+
+    for (int i = 0; i < SIM_VALUE_COUNT; i++) {
+        phase = (float)(time_ms % sim_waves[i].period_ms) /
+                sim_waves[i].period_ms;
+        values[i] = sim_waves[i].mean +
+                    sim_waves[i].amplitude * sinf(2.0f * SIM_PI * phase) +
+                    sim_waves[i].noise * sim_noise(time_ms, i);
+    }
+}
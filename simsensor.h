@@ -0,0 +1,73 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SIMSENSOR_H
+#define SIMSENSOR_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* default trace, relative to the filesystem mount point */
+#define SIM_TRACE_PATH "/sim/trace.csv"
+
+enum SIM_VALUES {
+    SIM_VALUE_LUX = 0,
+    SIM_VALUE_TEMP,
+    SIM_VALUE_HUMIDITY,
+    SIM_VALUE_COUNT
+};
+
+/*
+ * Simulated sensor readings, used in place of the I2C drivers.
+ *
+ * Readings are raw, i.e. before calibration, and a function of time only,
+ * so replaying the same source over the same times always gives the same
+ * readings.
+ *
+ * A source is either a recorded trace or a set of synthetic waveforms.  A
+ * trace is a CSV file with one "time_ms,lux,temp,humidity" row per line,
+ * in increasing time order.  Lines that don't start with a digit are
+ * skipped.  A trace holds each row until the next row's time and starts
+ * over once it ends, with the last row held as long as the gap before it.
+ * The synthetic waveforms are slow sine waves with a little pseudo-random
+ * noise.
+ */
+struct sim_source {
+    FILE *fp;
+    /* time of the first row in the file */
+    uint32_t first_ms;
+    /* time at which the current pass over the file started */
+    uint32_t base_ms;
+    /* the current and next rows, in time since the first pass started */
+    uint32_t row_ms;
+    float row[SIM_VALUE_COUNT];
+    /* time between the previous and the current row */
+    uint32_t gap_ms;
+    uint32_t next_ms;
+    float next[SIM_VALUE_COUNT];
+};
+
+/* opens a trace, or uses synthetic waveforms if path is NULL.
+ * returns 0 on success. */
+int sim_open(struct sim_source *src, const char *path);
+
+void sim_close(struct sim_source *src);
+
+/* returns the raw readings at time_ms.  times must not go backwards. */
+void sim_read(struct sim_source *src, uint32_t time_ms,
+              float values[SIM_VALUE_COUNT]);
+
+#endif /* SIMSENSOR_H */
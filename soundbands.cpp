@@ -0,0 +1,189 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "soundbands.h"
+#include "soundlevel.h"
+
+#include <string.h>
+
+/* the complex FFT runs on pairs of samples */
+#define SOUND_FFT_POINTS (SOUND_FFT_SIZE / 2)
+
+/* bits dropped from each bin before squaring */
+#define SOUND_BIN_SHIFT 7
+
+/*
+ * log2 of the energy of a full scale sine in one frame, scaled by 2^16.
+ * samples are scaled by 2^14 after windowing, so a full scale sine has a
+ * mean square of 2^57 times the mean square of the window, 3/8.  by
+ * Parseval, the bins of one side of the spectrum hold half of that times
+ * SOUND_FFT_SIZE^2.  they are scaled down by 2^7 in the FFT and by
+ * SOUND_BIN_SHIFT, which leaves 3 * 2^41.
+ */
+#define SOUND_BANDS_FULL_SCALE_LOG2 2790848
+
+const uint16_t sound_band_centre_hz[SOUND_BANDS] = {
+    63, 125, 250, 500, 1000, 2000, 4000
+};
+
+/* first bin of each band, bins are 31.25 Hz wide */
+static const uint8_t sound_band_bins[SOUND_BANDS + 1] = {
+    2, 3, 6, 12, 23, 46, 91, SOUND_FFT_POINTS
+};
+
+/* a quarter of a sine wave of SOUND_FFT_SIZE steps, scaled by 2^15 */
+static const int16_t sound_sin_table[SOUND_FFT_SIZE / 4 + 1] = {
+    0, 804, 1608, 2411, 3212, 4011, 4808, 5602, 6393, 7180, 7962, 8740,
+    9512, 10279, 11039, 11793, 12540, 13279, 14010, 14733, 15447, 16151,
+    16846, 17531, 18205, 18868, 19520, 20160, 20788, 21403, 22006, 22595,
+    23170, 23732, 24279, 24812, 25330, 25833, 26320, 26791, 27246, 27684,
+    28106, 28511, 28899, 29269, 29622, 29957, 30274, 30572, 30853, 31114,
+    31357, 31581, 31786, 31972, 32138, 32286, 32413, 32522, 32610, 32679,
+    32729, 32758, 32767
+};
+
+/* returns sin(2 * pi * i / SOUND_FFT_SIZE), scaled by 2^15 */
+static inline int32_t sound_sin(unsigned i)
+{
+    const unsigned quarter = SOUND_FFT_SIZE / 4;
+
+    i &= SOUND_FFT_SIZE - 1;
+    if (i <= quarter) {
+        return sound_sin_table[i];
+    }
+    if (i <= 2 * quarter) {
+        return sound_sin_table[2 * quarter - i];
+    }
+    if (i <= 3 * quarter) {
+        return -sound_sin_table[i - 2 * quarter];
+    }
+    return -sound_sin_table[4 * quarter - i];
+}
+
+static inline int32_t sound_cos(unsigned i)
+{
+    return sound_sin(i + SOUND_FFT_SIZE / 4);
+}
+
+void sound_bands_reset(struct sound_bands *b)
+{
+    memset(b, 0, sizeof(*b));
+}
+
+/*
+ * windows a frame into the FFT buffer, with the even samples as the real
+ * and the odd samples as the imaginary parts, in bit reversed order
+ */
+static void sound_bands_load(int32_t *z, const int16_t *pcm)
+{
+    int32_t w;
+    unsigned bit;
+    unsigned rev = 0;
+
+    for (unsigned m = 0; m < SOUND_FFT_POINTS; m++) {
+        /* Hann window, scaled by 2^15 */
+        w = (32767 - sound_cos(2 * m)) >> 1;
+        z[2 * rev] = (pcm[2 * m] * w) >> 1;
+        w = (32767 - sound_cos(2 * m + 1)) >> 1;
+        z[2 * rev + 1] = (pcm[2 * m + 1] * w) >> 1;
+
+        /* increment rev in bit reversed order */
+        for (bit = SOUND_FFT_POINTS >> 1; rev & bit; bit >>= 1) {
+            rev ^= bit;
+        }
+        rev |= bit;
+    }
+}
+
+/* in-place radix-2 FFT of bit reversed input, scaled by 1 / points */
+static void sound_bands_fft(int32_t *z)
+{
+    int32_t c, s;
+    int32_t tr, ti;
+    int32_t ar, ai;
+    unsigned j;
+    unsigned step;
+
+    for (unsigned half = 1; half < SOUND_FFT_POINTS; half <<= 1) {
+        step = SOUND_FFT_SIZE / (2 * half);
+        for (unsigned k = 0; k < half; k++) {
+            /* twiddle factor c - js */
+            c = sound_cos(k * step);
+            s = sound_sin(k * step);
+            for (unsigned i = k; i < SOUND_FFT_POINTS; i += 2 * half) {
+                j = i + half;
+                tr = (int32_t)(((int64_t)z[2 * j] * c +
+                                (int64_t)z[2 * j + 1] * s) >> 15);
+                ti = (int32_t)(((int64_t)z[2 * j + 1] * c -
+                                (int64_t)z[2 * j] * s) >> 15);
+                ar = z[2 * i];
+                ai = z[2 * i + 1];
+                z[2 * i] = (ar + tr) >> 1;
+                z[2 * i + 1] = (ai + ti) >> 1;
+                z[2 * j] = (ar - tr) >> 1;
+                z[2 * j + 1] = (ai - ti) >> 1;
+            }
+        }
+    }
+}
+
+void sound_bands_add(struct sound_bands *b, const int16_t *pcm)
+{
+    int32_t *z = b->fft;
+    int32_t c, s;
+    int32_t er, ei;
+    int32_t dr, di;
+    int32_t xr, xi;
+    unsigned m;
+    uint64_t energy;
+
+    sound_bands_load(z, pcm);
+    sound_bands_fft(z);
+
+    /* split into the spectrum of the real frame, only as far as the
+     * energy of each bin.  with A = Z[k] and B = conj(Z[points - k]),
+     * X[k] = (A + B) / 2 - j(A - B) / 2 * e^(-2 pi j k / size). */
+    for (int band = 0; band < SOUND_BANDS; band++) {
+        energy = 0;
+        for (unsigned k = sound_band_bins[band];
+             k < sound_band_bins[band + 1]; k++) {
+            m = SOUND_FFT_POINTS - k;
+            er = (z[2 * k] + z[2 * m]) >> 1;
+            ei = (z[2 * k + 1] - z[2 * m + 1]) >> 1;
+            dr = (z[2 * k] - z[2 * m]) >> 1;
+            di = (z[2 * k + 1] + z[2 * m + 1]) >> 1;
+            c = sound_cos(k);
+            s = sound_sin(k);
+            xr = er + (int32_t)(((int64_t)di * c - (int64_t)dr * s) >> 15);
+            xi = ei - (int32_t)(((int64_t)dr * c + (int64_t)di * s) >> 15);
+            xr >>= SOUND_BIN_SHIFT;
+            xi >>= SOUND_BIN_SHIFT;
+            energy += (int64_t)xr * xr + (int64_t)xi * xi;
+        }
+        b->energy[band] += energy;
+    }
+    b->frames++;
+}
+
+void sound_bands_take(struct sound_bands *b, int32_t cdb[SOUND_BANDS])
+{
+    for (int band = 0; band < SOUND_BANDS; band++) {
+        cdb[band] = sound_cdb(b->energy[band], b->frames,
+                              SOUND_BANDS_FULL_SCALE_LOG2);
+        b->energy[band] = 0;
+    }
+    b->frames = 0;
+}
@@ -0,0 +1,64 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SOUNDBANDS_H
+#define SOUNDBANDS_H
+
+#include <stdint.h>
+
+/* samples per frame, 32 ms at 8 kHz, giving 31.25 Hz per bin */
+#define SOUND_FFT_SIZE 256
+
+/* octave bands from 63 Hz to 4 kHz */
+#define SOUND_BANDS 7
+
+/* nominal centre frequencies of the bands, in Hz */
+extern const uint16_t sound_band_centre_hz[SOUND_BANDS];
+
+/*
+ * Octave band levels of 8 kHz PCM.
+ *
+ * Each frame is Hann windowed and transformed with a fixed-point real
+ * FFT: a SOUND_FFT_SIZE / 2 point complex radix-2 FFT of the even and odd
+ * samples, followed by a split into the spectrum of the real frame.  Data
+ * is 32-bit, halved at every stage so it can't overflow, and the window
+ * and twiddle factors are 16-bit, all from one quarter wave sine table.
+ *
+ * The energy of every bin is added to the energy of its band, and the
+ * band levels are the mean over all frames since they were last taken,
+ * in hundredths of a dB relative to a full scale sine.  The bins are
+ * 31.25 Hz wide, so the 63 Hz band is a single bin, and the 4 kHz band
+ * ends at the Nyquist frequency.
+ */
+struct sound_bands {
+    /* complex FFT input and output, interleaved real and imaginary */
+    int32_t fft[SOUND_FFT_SIZE];
+    uint64_t energy[SOUND_BANDS];
+    uint32_t frames;
+};
+
+void sound_bands_reset(struct sound_bands *b);
+
+/* adds a frame of SOUND_FFT_SIZE samples */
+void sound_bands_add(struct sound_bands *b, const int16_t *pcm);
+
+/*
+ * returns the level of each band over the frames added since the last
+ * call, SOUND_LEVEL_MIN_CDB if there were none, and starts over
+ */
+void sound_bands_take(struct sound_bands *b, int32_t cdb[SOUND_BANDS]);
+
+#endif /* SOUNDBANDS_H */
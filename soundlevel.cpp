@@ -0,0 +1,175 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "soundlevel.h"
+
+#include <string.h>
+
+/* extra bits the samples are scaled up by while filtering */
+#define SOUND_FILTER_SHIFT 12
+/* bits dropped before squaring, leaving 4 of the extra bits */
+#define SOUND_ENERGY_SHIFT 8
+/* the running mean follows the input with a time constant of 2^10 samples */
+#define SOUND_DC_SHIFT 10
+
+/* log2 of the mean square of a full scale sine, scaled by 2^4 */
+#define SOUND_FULL_SCALE_LOG2 37
+/* the gain left out of the A-weighting biquads, 1.78 dB */
+#define SOUND_A_GAIN_CDB 178
+
+/*
+ * A-weighting at 8 kHz as b0 * (1 - 2z^-1 + z^-2) / (1 + a1 z^-1 + a2 z^-2)
+ * per section, all scaled by 2^30.  the first section has the double pole
+ * at 20.6 Hz, the second the poles at 107.7 Hz and 737.9 Hz.
+ */
+static const int32_t sound_a_coef[2][3] = {
+    /* b0, a1, a2 */
+    {1056578915, -2113019555, 1039554281},
+    {798747182, -1577925793, 543321111},
+};
+
+/* runs one section on a sample, both scaled by 2^SOUND_FILTER_SHIFT */
+static inline int32_t sound_biquad_run(struct sound_biquad *s,
+                                       const int32_t *coef, int32_t x)
+{
+    int64_t acc;
+    int32_t y;
+
+    acc = (int64_t)coef[0] * (x - 2 * s->x1 + s->x2);
+    acc -= (int64_t)coef[1] * s->y1;
+    acc -= (int64_t)coef[2] * s->y2;
+    y = (int32_t)(acc >> 30);
+
+    s->x2 = s->x1;
+    s->x1 = x;
+    s->y2 = s->y1;
+    s->y1 = y;
+
+    return y;
+}
+
+void sound_level_reset(struct sound_level *l)
+{
+    memset(l, 0, sizeof(*l));
+}
+
+void sound_level_add(struct sound_level *l, const int16_t *pcm, size_t n)
+{
+    int32_t x;
+    int32_t z;
+    int32_t a;
+    uint64_t energy_z = 0;
+    uint64_t energy_a = 0;
+
+    /* start from the first sample rather than let the mean settle */
+    if (!l->primed && n > 0) {
+        l->dc = (int32_t)pcm[0] << SOUND_FILTER_SHIFT;
+        l->primed = true;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        x = (int32_t)pcm[i] << SOUND_FILTER_SHIFT;
+        l->dc += (x - l->dc) >> SOUND_DC_SHIFT;
+        z = x - l->dc;
+
+        a = sound_biquad_run(&l->a[0], sound_a_coef[0], z);
+        a = sound_biquad_run(&l->a[1], sound_a_coef[1], a);
+
+        z >>= SOUND_ENERGY_SHIFT;
+        a >>= SOUND_ENERGY_SHIFT;
+        energy_z += (int64_t)z * z;
+        energy_a += (int64_t)a * a;
+    }
+
+    l->energy_z += energy_z;
+    l->energy_a += energy_a;
+    l->count += n;
+}
+
+/* returns log2(x) scaled by 2^16, x must not be 0 */
+static int32_t sound_log2(uint64_t x)
+{
+    int32_t result = 0;
+    uint64_t m;
+
+    /* normalise to [2^31, 2^32) */
+    while (x >= (1ULL << 32)) {
+        x >>= 1;
+        result++;
+    }
+    while (x < (1ULL << 31)) {
+        x <<= 1;
+        result--;
+    }
+    result += 31;
+    result <<= 16;
+
+    /* each squaring of the mantissa yields one bit of the fraction */
+    m = x;
+    for (int bit = 15; bit >= 0; bit--) {
+        m = (m * m) >> 31;
+        if (m >= (1ULL << 32)) {
+            m >>= 1;
+            result |= 1 << bit;
+        }
+    }
+
+    return result;
+}
+
+int32_t sound_cdb(uint64_t energy, uint32_t count, int32_t ref_log2)
+{
+    int64_t log2;
+    int32_t cdb;
+
+    if (0 == energy || 0 == count) {
+        return SOUND_LEVEL_MIN_CDB;
+    }
+
+    log2 = (int64_t)sound_log2(energy) - sound_log2(count) - ref_log2;
+    /* 10 * log10(2) dB per bit */
+    cdb = (int32_t)(log2 * 30103 / (100 << 16));
+
+    return cdb > SOUND_LEVEL_MIN_CDB ? cdb : SOUND_LEVEL_MIN_CDB;
+}
+
+int32_t sound_level_cdb(uint64_t energy, uint32_t count)
+{
+    return sound_cdb(energy, count, SOUND_FULL_SCALE_LOG2 << 16);
+}
+
+void sound_level_get(const struct sound_level *l, int32_t *z_cdb,
+                     int32_t *a_cdb)
+{
+    *z_cdb = sound_level_cdb(l->energy_z, l->count);
+    *a_cdb = sound_level_cdb(l->energy_a, l->count);
+    if (*a_cdb > SOUND_LEVEL_MIN_CDB) {
+        *a_cdb += SOUND_A_GAIN_CDB;
+    }
+}
+
+void sound_level_restart(struct sound_level *l)
+{
+    l->energy_z = 0;
+    l->energy_a = 0;
+    l->count = 0;
+}
+
+void sound_level_take(struct sound_level *l, int32_t *z_cdb, int32_t *a_cdb)
+{
+    sound_level_get(l, z_cdb, a_cdb);
+    sound_level_restart(l);
+}
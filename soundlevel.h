@@ -0,0 +1,90 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SOUNDLEVEL_H
+#define SOUNDLEVEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* the A-weighting filter is designed for this sample rate, in Hz */
+#define SOUND_SAMPLE_RATE 8000
+
+/* level of silence, in hundredths of a dB */
+#define SOUND_LEVEL_MIN_CDB (-12000)
+
+/* state of one second order section of the A-weighting filter */
+struct sound_biquad {
+    int32_t x1, x2;
+    int32_t y1, y2;
+};
+
+/*
+ * Fixed-point equivalent continuous sound level of 16-bit PCM.
+ *
+ * Samples have their DC offset removed by a running mean and are then
+ * A-weighted by two biquads, bilinear transforms of the IEC 61672 poles
+ * below 1 kHz.  The 12.2 kHz poles are above the Nyquist frequency and
+ * are left out, which keeps the response within 0.8 dB of the standard
+ * curve up to 3.9 kHz.  The filter runs on samples scaled up by 2^12 so
+ * that rounding in the feedback path stays well below one LSB of the
+ * input.
+ *
+ * The sum of squares of both the flat (Z-weighted) and the A-weighted
+ * signal is kept until the level is taken, so an interval can span any
+ * number of blocks.  Levels are in hundredths of a dB relative to a full
+ * scale sine.
+ */
+struct sound_level {
+    /* running mean of the input, scaled by 2^12 */
+    int32_t dc;
+    bool primed;
+    struct sound_biquad a[2];
+    /* sums of squares of samples scaled by 2^4 */
+    uint64_t energy_z;
+    uint64_t energy_a;
+    uint32_t count;
+};
+
+/* clears the filters and the current interval */
+void sound_level_reset(struct sound_level *l);
+
+/* adds a block of samples to the current interval */
+void sound_level_add(struct sound_level *l, const int16_t *pcm, size_t n);
+
+/*
+ * returns the flat and A-weighted levels of the samples added in the
+ * current interval, SOUND_LEVEL_MIN_CDB if there were none
+ */
+void sound_level_get(const struct sound_level *l, int32_t *z_cdb,
+                     int32_t *a_cdb);
+
+/* starts a new interval.  the filters keep their state. */
+void sound_level_restart(struct sound_level *l);
+
+/* returns the levels of the current interval and starts a new one */
+void sound_level_take(struct sound_level *l, int32_t *z_cdb, int32_t *a_cdb);
+
+/* returns the level of a mean square of samples scaled by 2^4 */
+int32_t sound_level_cdb(uint64_t energy, uint32_t count);
+
+/*
+ * returns the level of the mean square energy / count relative to a full
+ * scale sine with a mean square of 2^(ref_log2 / 2^16)
+ */
+int32_t sound_cdb(uint64_t energy, uint32_t count, int32_t ref_log2);
+
+#endif /* SOUNDLEVEL_H */
@@ -0,0 +1,119 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tls_session.h"
+
+#include <mbed.h>
+
+#include <string.h>
+
+/* longest host name a session is kept for */
+#define TLS_SESSION_HOST_LEN 64
+
+/* all of it is used from the thread that runs the handshakes, the one of
+ * mbed client */
+static mbedtls_ssl_session saved;
+static bool saved_valid;
+static char saved_host[TLS_SESSION_HOST_LEN];
+/* the handshake in progress offered the saved session */
+static bool offered;
+static uint32_t start_us;
+static struct tls_session_stats stats;
+
+static const char *tls_session_host(const mbedtls_ssl_context *ssl)
+{
+    return NULL != ssl->hostname ? ssl->hostname : "";
+}
+
+static void tls_session_forget(void)
+{
+    if (saved_valid) {
+        mbedtls_ssl_session_free(&saved);
+        saved_valid = false;
+    }
+}
+
+/* keeps the session of the handshake that just completed */
+static void tls_session_save(const mbedtls_ssl_context *ssl)
+{
+    const char *host = tls_session_host(ssl);
+
+    tls_session_forget();
+    if (strlen(host) >= sizeof(saved_host)) {
+        return;
+    }
+    if (0 != mbedtls_ssl_get_session(ssl, &saved)) {
+        mbedtls_ssl_session_free(&saved);
+        return;
+    }
+    strcpy(saved_host, host);
+    saved_valid = true;
+}
+
+const struct tls_session_stats *tls_session_get_stats(void)
+{
+    return &stats;
+}
+
+int __wrap_mbedtls_ssl_handshake(mbedtls_ssl_context *ssl)
+{
+    int ret;
+    uint32_t elapsed_ms;
+
+    if (MBEDTLS_SSL_IS_CLIENT != ssl->conf->endpoint) {
+        return __real_mbedtls_ssl_handshake(ssl);
+    }
+
+    /* the first step of a handshake on a new connection */
+    if (MBEDTLS_SSL_HELLO_REQUEST == ssl->state) {
+        start_us = us_ticker_read();
+        offered = saved_valid &&
+                  0 == strcmp(saved_host, tls_session_host(ssl)) &&
+                  0 == mbedtls_ssl_set_session(ssl, &saved);
+    }
+
+    ret = __real_mbedtls_ssl_handshake(ssl);
+    if (MBEDTLS_ERR_SSL_WANT_READ == ret ||
+        MBEDTLS_ERR_SSL_WANT_WRITE == ret) {
+        return ret;
+    }
+
+    if (0 != ret) {
+        stats.failed++;
+        /* the server may be the one that choked on it */
+        if (offered) {
+            tls_session_forget();
+        }
+        return ret;
+    }
+
+    elapsed_ms = (us_ticker_read() - start_us) / 1000;
+    /* an abbreviated handshake keeps the master secret, a full one
+     * negotiates a new one */
+    if (offered && 0 == memcmp(ssl->session->master, saved.master,
+                               sizeof(saved.master))) {
+        stats.resumed++;
+        stats.resumed_ms = elapsed_ms;
+    } else {
+        stats.full++;
+        stats.full_ms = elapsed_ms;
+    }
+    /* a resumed session may come with a new ticket */
+    tls_session_save(ssl);
+
+    return ret;
+}
@@ -0,0 +1,59 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TLS_SESSION_H
+#define TLS_SESSION_H
+
+#include <stdint.h>
+
+#include <mbedtls/ssl.h>
+
+/*
+ * TLS session resumption across reconnects.
+ *
+ * The TLS context of the cloud client is owned by its PAL, which sets up a
+ * new one for every connection and ignores PAL_USE_SSL_SESSION_RESUME, so
+ * every reconnect did a full handshake.  The image is linked with
+ * --wrap=mbedtls_ssl_handshake (profiles/tls.json), which routes the
+ * handshakes of the PAL through __wrap_mbedtls_ssl_handshake().  It keeps
+ * the session of the last successful client handshake in RAM with
+ * mbedtls_ssl_get_session(), and offers it with mbedtls_ssl_set_session()
+ * to the next handshake with the same host, by session ticket where the
+ * server issued one and by session id otherwise.  A resumed handshake
+ * skips the certificates and the ECDHE and ECDSA operations, and one round
+ * trip.  The server may still decline, and the handshake is then a full
+ * one.  The session is dropped when a handshake that offered it fails, and
+ * is lost on reset.
+ */
+struct tls_session_stats {
+    uint32_t full;
+    uint32_t resumed;
+    uint32_t failed;
+    /* from the first handshake step to the last, of the last of each */
+    uint32_t full_ms;
+    uint32_t resumed_ms;
+};
+
+/* returns the counts of the client handshakes since boot */
+const struct tls_session_stats *tls_session_get_stats(void);
+
+extern "C" {
+int __real_mbedtls_ssl_handshake(mbedtls_ssl_context *ssl);
+int __wrap_mbedtls_ssl_handshake(mbedtls_ssl_context *ssl);
+}
+
+#endif /* TLS_SESSION_H */
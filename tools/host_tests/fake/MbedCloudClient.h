@@ -0,0 +1,262 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FAKE_MBEDCLOUDCLIENT_H
+#define FAKE_MBEDCLOUDCLIENT_H
+
+/*
+ * a cloud client that speaks LwM2M over CoAP over TCP to the stand-in server
+ * that a test started on the loopback at fake_cloud_port, and otherwise
+ * never connects.  it keeps the objects it was asked to register in
+ * fake_cloud_objects, for the tests to look at.
+ *
+ * mbed client runs the protocol on its own thread.  here nothing happens
+ * until the test calls fake_poll(), which handles what the server sent and
+ * runs the callbacks, as that thread would.  the server may observe and
+ * PUT the resources, and push a firmware image block-wise to /5/0/0, for
+ * which the authorization and progress handlers run like those of the
+ * update client.
+ */
+
+#include "coap.h"
+#include "mbed.h"
+#include "m2minterface.h"
+#include "m2mresource.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+class String
+{
+public:
+    String() {}
+    const char *c_str() const { return ""; }
+};
+
+class ConnectorClientEndpointInfo
+{
+public:
+    String internal_endpoint_name;
+    String endpoint_name;
+    String account_id;
+    int mode;
+};
+
+class MbedCloudClientCallback
+{
+public:
+    virtual ~MbedCloudClientCallback() {}
+    virtual void value_updated(M2MBase *base, M2MBase::BaseType type) = 0;
+};
+
+/* the objects passed to the last MbedCloudClient::add_objects() */
+extern M2MObjectList fake_cloud_objects;
+
+/* the port of the stand-in server, 0 for none */
+extern uint16_t fake_cloud_port;
+
+/* a callback to a member function, as the templates below are given */
+class fake_callback
+{
+public:
+    virtual ~fake_callback() {}
+    virtual void call(int arg) = 0;
+};
+
+template <typename T>
+class fake_method : public fake_callback
+{
+public:
+    fake_method(T *object, void (T::*method)())
+        : _object(object), _method(method) {}
+    void call(int arg) { (_object->*_method)(); }
+
+private:
+    T *_object;
+    void (T::*_method)();
+};
+
+template <typename T>
+class fake_method_int : public fake_callback
+{
+public:
+    fake_method_int(T *object, void (T::*method)(int))
+        : _object(object), _method(method) {}
+    void call(int arg) { (_object->*_method)(arg); }
+
+private:
+    T *_object;
+    void (T::*_method)(int);
+};
+
+class MbedCloudClient : public M2MObservationHandler
+{
+public:
+    typedef enum {
+        ConnectErrorNone = 0x0,
+        ConnectAlreadyExists,
+        ConnectBootstrapFailed,
+        ConnectInvalidParameters,
+        ConnectNotRegistered,
+        ConnectTimeout,
+        ConnectNetworkError,
+        ConnectResponseParseFailed,
+        ConnectUnknownError,
+        ConnectMemoryConnectFail,
+        ConnectNotAllowed,
+        ConnectSecureConnectionFailed,
+        ConnectDnsResolvingFailed,
+        UpdateWarningCertificateNotFound,
+        UpdateWarningIdentityNotFound,
+        UpdateWarningCertificateInvalid,
+        UpdateWarningSignatureInvalid,
+        UpdateWarningVendorMismatch,
+        UpdateWarningClassMismatch,
+        UpdateWarningDeviceMismatch,
+        UpdateWarningURINotFound,
+        UpdateWarningRollbackProtection,
+        UpdateWarningUnknown,
+        UpdateErrorWriteToStorage
+    } Error;
+
+    enum {
+        UpdateRequestDownload,
+        UpdateRequestInstall
+    };
+
+    MbedCloudClient();
+    ~MbedCloudClient();
+
+    void add_objects(const M2MObjectList &object_list)
+    {
+        _objects = object_list;
+        fake_cloud_objects = object_list;
+    }
+    /* connects and registers, if there is a server */
+    bool setup(void *iface);
+    void set_update_callback(MbedCloudClientCallback *callback)
+    {
+        _update_callback = callback;
+    }
+    template <typename T> void on_registered(T *object, void (T::*method)())
+    {
+        set_callback(&_on_registered, new fake_method<T>(object, method));
+    }
+    template <typename T> void on_unregistered(T *object,
+                                               void (T::*method)())
+    {
+        set_callback(&_on_unregistered, new fake_method<T>(object, method));
+    }
+    template <typename T> void on_registration_updated(T *object,
+                                                       void (T::*method)())
+    {
+        set_callback(&_on_updated, new fake_method<T>(object, method));
+    }
+    template <typename T> void on_error(T *object, void (T::*method)(int))
+    {
+        set_callback(&_on_error, new fake_method_int<T>(object, method));
+    }
+    void set_update_authorize_handler(void (*handler)(int32_t request))
+    {
+        _authorize_handler = handler;
+    }
+    void set_update_progress_handler(void (*handler)(uint32_t progress,
+                                                     uint32_t total))
+    {
+        _progress_handler = handler;
+    }
+    /* deregisters, and closes the connection once the server confirmed */
+    void close();
+    /* updates the registration, and reconnects first if the connection was
+     * lost.  a registration the server doesn't know is made again in full */
+    void register_update();
+    const ConnectorClientEndpointInfo *endpoint_info() const { return NULL; }
+    const char *error_description() const { return ""; }
+    void update_authorize(int32_t request);
+
+    void observation_to_be_sent(M2MResourceInstance *res);
+
+    /* handles the messages the server sent, returns how many there were */
+    unsigned fake_poll();
+    /* drops the connection without a word, like a lost network */
+    void fake_disconnect();
+    bool fake_connected() const { return _conn.fd >= 0; }
+    /* the image received at /5/0/0, and whether its install was granted */
+    const std::string &fake_firmware() const { return _firmware; }
+    bool fake_install_granted() const { return _install_granted; }
+
+private:
+    enum fake_request {
+        FAKE_REQUEST_NONE,
+        FAKE_REQUEST_REGISTER,
+        FAKE_REQUEST_UPDATE,
+        FAKE_REQUEST_UNREGISTER
+    };
+
+    M2MObjectList _objects;
+    struct coap_conn _conn;
+    /* the request in flight, one at a time like mbed client */
+    enum fake_request _request;
+    std::string _request_token;
+    uint32_t _tokens;
+    /* the resource links of the registration, and the block in flight */
+    std::string _links;
+    uint32_t _block;
+    /* where the server keeps the registration, empty before it has one */
+    std::string _location;
+
+    std::string _firmware;
+    uint32_t _firmware_size;
+    /* the first block of an image, held until the download is granted */
+    struct coap_msg _held;
+    bool _holding;
+    bool _download_granted;
+    bool _install_granted;
+
+    MbedCloudClientCallback *_update_callback;
+    fake_callback *_on_registered;
+    fake_callback *_on_unregistered;
+    fake_callback *_on_updated;
+    fake_callback *_on_error;
+    void (*_authorize_handler)(int32_t request);
+    void (*_progress_handler)(uint32_t progress, uint32_t total);
+
+    void set_callback(fake_callback **slot, fake_callback *callback)
+    {
+        delete *slot;
+        *slot = callback;
+    }
+    void run(fake_callback *callback, int arg = 0)
+    {
+        if (NULL != callback) {
+            callback->call(arg);
+        }
+    }
+
+    bool connect();
+    void disconnected();
+    void send_request(uint8_t code, const char *path,
+                      enum fake_request request, struct coap_msg *msg);
+    void send_registration_block();
+    void handle_response(const struct coap_msg *msg);
+    void handle_request(const struct coap_msg *msg);
+    void handle_firmware(const struct coap_msg *msg);
+    void reply(const struct coap_msg *request, uint8_t code,
+               struct coap_msg *msg);
+    M2MResource *find_resource(const std::string &path);
+};
+
+#endif /* FAKE_MBEDCLOUDCLIENT_H */
@@ -0,0 +1,367 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "coap.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define COAP_PAYLOAD_MARKER 0xFF
+
+void coap_init(struct coap_msg *msg, uint8_t code, const std::string &token)
+{
+    msg->code = code;
+    msg->token = token;
+    msg->options.clear();
+    msg->payload.clear();
+}
+
+void coap_add(struct coap_msg *msg, uint16_t number, const std::string &value)
+{
+    std::vector<struct coap_option>::iterator it;
+    struct coap_option opt;
+
+    opt.number = number;
+    opt.value = value;
+    /* after the options of the same number, which repeat in order */
+    for (it = msg->options.begin(); it != msg->options.end(); ++it) {
+        if (it->number > number) {
+            break;
+        }
+    }
+    msg->options.insert(it, opt);
+}
+
+void coap_add_uint(struct coap_msg *msg, uint16_t number, uint32_t value)
+{
+    std::string bytes;
+
+    /* the shortest big endian form, zero has no bytes at all */
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        if (!bytes.empty() || 0 != (value >> shift)) {
+            bytes += (char)(value >> shift);
+        }
+    }
+    coap_add(msg, number, bytes);
+}
+
+void coap_add_path(struct coap_msg *msg, uint16_t number, const char *path)
+{
+    const char *end;
+
+    while ('\0' != *path) {
+        if ('/' == *path) {
+            path++;
+            continue;
+        }
+        end = strchr(path, '/');
+        if (NULL == end) {
+            end = path + strlen(path);
+        }
+        coap_add(msg, number, std::string(path, end - path));
+        path = end;
+    }
+}
+
+void coap_add_block(struct coap_msg *msg, uint16_t number, uint32_t num,
+                    bool more)
+{
+    coap_add_uint(msg, number, num << 4 | (more ? 1 << 3 : 0) |
+                  COAP_BLOCK_SZX);
+}
+
+const struct coap_option *coap_find(const struct coap_msg *msg,
+                                    uint16_t number)
+{
+    for (size_t i = 0; i < msg->options.size(); i++) {
+        if (msg->options[i].number == number) {
+            return &msg->options[i];
+        }
+    }
+    return NULL;
+}
+
+bool coap_get_uint(const struct coap_msg *msg, uint16_t number,
+                   uint32_t *value)
+{
+    const struct coap_option *opt;
+
+    opt = coap_find(msg, number);
+    if (NULL == opt || opt->value.size() > 4) {
+        return false;
+    }
+    *value = 0;
+    for (size_t i = 0; i < opt->value.size(); i++) {
+        *value = *value << 8 | (uint8_t)opt->value[i];
+    }
+    return true;
+}
+
+bool coap_get_block(const struct coap_msg *msg, uint16_t number,
+                    uint32_t *num, bool *more, unsigned *szx)
+{
+    uint32_t value;
+
+    if (!coap_get_uint(msg, number, &value)) {
+        return false;
+    }
+    *num = value >> 4;
+    *more = 0 != (value & 1 << 3);
+    *szx = value & 7;
+    return true;
+}
+
+std::string coap_get_path(const struct coap_msg *msg, uint16_t number)
+{
+    std::string path;
+
+    for (size_t i = 0; i < msg->options.size(); i++) {
+        if (msg->options[i].number == number) {
+            if (!path.empty()) {
+                path += '/';
+            }
+            path += msg->options[i].value;
+        }
+    }
+    return path;
+}
+
+/* a length or an option delta in its 4-bit field, with the extended bytes
+ * of the values that don't fit */
+static uint8_t coap_nibble(uint32_t value, std::string *ext)
+{
+    if (value < 13) {
+        return value;
+    }
+    if (value < 269) {
+        *ext += (char)(value - 13);
+        return 13;
+    }
+    if (value < 65805) {
+        value -= 269;
+        *ext += (char)(value >> 8);
+        *ext += (char)value;
+        return 14;
+    }
+    value -= 65805;
+    *ext += (char)(value >> 24);
+    *ext += (char)(value >> 16);
+    *ext += (char)(value >> 8);
+    *ext += (char)value;
+    return 15;
+}
+
+void coap_encode(const struct coap_msg *msg, std::string *out)
+{
+    std::string body;
+    std::string ext;
+    uint16_t prev = 0;
+    uint8_t delta;
+    uint8_t len;
+
+    for (size_t i = 0; i < msg->options.size(); i++) {
+        const struct coap_option &opt = msg->options[i];
+
+        ext.clear();
+        delta = coap_nibble(opt.number - prev, &ext);
+        len = coap_nibble(opt.value.size(), &ext);
+        body += (char)(delta << 4 | len);
+        body += ext;
+        body += opt.value;
+        prev = opt.number;
+    }
+    if (!msg->payload.empty()) {
+        body += (char)COAP_PAYLOAD_MARKER;
+        body += msg->payload;
+    }
+
+    /* the length counts the options and the payload, not the token */
+    ext.clear();
+    len = coap_nibble(body.size(), &ext);
+    *out += (char)(len << 4 | msg->token.size());
+    *out += ext;
+    *out += (char)msg->code;
+    *out += msg->token;
+    *out += body;
+}
+
+/* reads an extended length or delta of a 4-bit field, returns false if the
+ * bytes run out */
+static bool coap_extended(uint8_t nibble, const uint8_t **p,
+                          const uint8_t *end, uint32_t *value)
+{
+    static const uint8_t sizes[] = {1, 2, 4};
+    static const uint32_t offsets[] = {13, 269, 65805};
+    unsigned n;
+
+    if (nibble < 13) {
+        *value = nibble;
+        return true;
+    }
+    n = sizes[nibble - 13];
+    if (end - *p < (ptrdiff_t)n) {
+        return false;
+    }
+    *value = 0;
+    for (unsigned i = 0; i < n; i++) {
+        *value = *value << 8 | *(*p)++;
+    }
+    *value += offsets[nibble - 13];
+    return true;
+}
+
+int coap_decode(const uint8_t *buf, size_t len, struct coap_msg *msg)
+{
+    const uint8_t *p = buf;
+    const uint8_t *end = buf + len;
+    uint32_t body_len;
+    uint32_t delta;
+    uint32_t opt_len;
+    uint16_t number = 0;
+    uint8_t byte;
+    uint8_t tkl;
+    struct coap_option opt;
+
+    if (len < 2) {
+        return 0;
+    }
+    byte = *p++;
+    tkl = byte & 0x0F;
+    if (!coap_extended(byte >> 4, &p, end, &body_len)) {
+        return 0;
+    }
+    if ((size_t)(end - p) < 1 + tkl + body_len) {
+        return 0;
+    }
+    if (tkl > 8) {
+        return -1;
+    }
+
+    byte = *p++;
+    coap_init(msg, byte, std::string((const char *)p, tkl));
+    p += tkl;
+    end = p + body_len;
+    while (p < end) {
+        if (COAP_PAYLOAD_MARKER == *p) {
+            p++;
+            if (p == end) {
+                return -1;
+            }
+            msg->payload.assign((const char *)p, end - p);
+            break;
+        }
+        byte = *p++;
+        if (!coap_extended(byte >> 4, &p, end, &delta) ||
+            !coap_extended(byte & 0x0F, &p, end, &opt_len) ||
+            (uint32_t)(end - p) < opt_len) {
+            return -1;
+        }
+        number += delta;
+        opt.number = number;
+        opt.value.assign((const char *)p, opt_len);
+        msg->options.push_back(opt);
+        p += opt_len;
+    }
+
+    return end - buf;
+}
+
+void coap_conn_init(struct coap_conn *c, int fd)
+{
+    c->fd = fd;
+    c->rx.clear();
+    c->sent = 0;
+    c->received = 0;
+    c->tx_bytes = 0;
+    c->rx_bytes = 0;
+    if (fd >= 0) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+}
+
+bool coap_send(struct coap_conn *c, const struct coap_msg *msg)
+{
+    std::string out;
+    size_t done = 0;
+    ssize_t n;
+    struct pollfd pfd;
+
+    coap_encode(msg, &out);
+    while (done < out.size()) {
+        /* a connection the peer closed fails rather than raising SIGPIPE */
+        n = send(c->fd, out.data() + done, out.size() - done, MSG_NOSIGNAL);
+        if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+            pfd.fd = c->fd;
+            pfd.events = POLLOUT;
+            poll(&pfd, 1, -1);
+            continue;
+        }
+        if (n < 0 && EINTR == errno) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += n;
+    }
+    c->sent++;
+    c->tx_bytes += out.size();
+    return true;
+}
+
+int coap_recv(struct coap_conn *c, struct coap_msg *msg)
+{
+    char buf[4096];
+    ssize_t n;
+    int used;
+
+    for (;;) {
+        used = coap_decode((const uint8_t *)c->rx.data(), c->rx.size(), msg);
+        if (used < 0) {
+            return -1;
+        }
+        if (used > 0) {
+            c->rx.erase(0, used);
+            c->received++;
+            c->rx_bytes += used;
+            return 1;
+        }
+
+        n = recv(c->fd, buf, sizeof(buf), 0);
+        if (n < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+            return 0;
+        }
+        if (n < 0 && EINTR == errno) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        c->rx.append(buf, n);
+    }
+}
+
+void coap_close(struct coap_conn *c)
+{
+    if (c->fd >= 0) {
+        close(c->fd);
+        c->fd = -1;
+    }
+}
@@ -0,0 +1,132 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FAKE_COAP_H
+#define FAKE_COAP_H
+
+/*
+ * CoAP over TCP (RFC 8323), as the fake cloud client and the stand-in
+ * server of the cloud test speak it: the message framing, the options the
+ * LwM2M exchanges use, and a connection that sends and receives whole
+ * messages over a socket.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define COAP_CODE(class, detail)        (((class) << 5) | (detail))
+
+#define COAP_GET                        COAP_CODE(0, 1)
+#define COAP_POST                       COAP_CODE(0, 2)
+#define COAP_PUT                        COAP_CODE(0, 3)
+#define COAP_DELETE                     COAP_CODE(0, 4)
+#define COAP_CREATED                    COAP_CODE(2, 1)
+#define COAP_DELETED                    COAP_CODE(2, 2)
+#define COAP_CHANGED                    COAP_CODE(2, 4)
+#define COAP_CONTENT                    COAP_CODE(2, 5)
+#define COAP_CONTINUE                   COAP_CODE(2, 31)
+#define COAP_BAD_REQUEST                COAP_CODE(4, 0)
+#define COAP_NOT_FOUND                  COAP_CODE(4, 4)
+#define COAP_METHOD_NOT_ALLOWED         COAP_CODE(4, 5)
+#define COAP_REQUEST_INCOMPLETE         COAP_CODE(4, 8)
+/* signaling, the capabilities and settings message opens a connection */
+#define COAP_CSM                        COAP_CODE(7, 1)
+
+#define COAP_OPTION_OBSERVE             6
+#define COAP_OPTION_LOCATION_PATH       8
+#define COAP_OPTION_URI_PATH            11
+#define COAP_OPTION_CONTENT_FORMAT      12
+#define COAP_OPTION_URI_QUERY           15
+#define COAP_OPTION_BLOCK1              27
+#define COAP_OPTION_SIZE1               60
+
+#define COAP_FORMAT_TEXT                0
+#define COAP_FORMAT_LINK                40
+#define COAP_FORMAT_OCTETS              42
+
+/* the size exponent of blocks of SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE */
+#define COAP_BLOCK_SZX                  5
+#define COAP_BLOCK_SIZE                 (16 << COAP_BLOCK_SZX)
+
+struct coap_option {
+    uint16_t number;
+    std::string value;
+};
+
+struct coap_msg {
+    uint8_t code;
+    std::string token;
+    /* in ascending order of number, as they are encoded */
+    std::vector<struct coap_option> options;
+    std::string payload;
+};
+
+/* starts an empty message */
+void coap_init(struct coap_msg *msg, uint8_t code, const std::string &token);
+
+/* adds an option, keeping them in order */
+void coap_add(struct coap_msg *msg, uint16_t number, const std::string &value);
+void coap_add_uint(struct coap_msg *msg, uint16_t number, uint32_t value);
+/* one Uri-Path or Location-Path option per segment of path */
+void coap_add_path(struct coap_msg *msg, uint16_t number, const char *path);
+void coap_add_block(struct coap_msg *msg, uint16_t number, uint32_t num,
+                    bool more);
+
+/* the first option of that number, NULL if there is none */
+const struct coap_option *coap_find(const struct coap_msg *msg,
+                                    uint16_t number);
+/* returns false if the option isn't there */
+bool coap_get_uint(const struct coap_msg *msg, uint16_t number,
+                   uint32_t *value);
+bool coap_get_block(const struct coap_msg *msg, uint16_t number,
+                    uint32_t *num, bool *more, unsigned *szx);
+/* the segments of the Uri-Path or Location-Path options, joined by '/' */
+std::string coap_get_path(const struct coap_msg *msg, uint16_t number);
+
+/* appends the message, framed for TCP, to out */
+void coap_encode(const struct coap_msg *msg, std::string *out);
+
+/*
+ * decodes a message from the front of len bytes.  returns the bytes it took,
+ * 0 if they don't hold a whole message yet, or -1 if it is malformed.
+ */
+int coap_decode(const uint8_t *buf, size_t len, struct coap_msg *msg);
+
+/* a connected socket, and what was received of the next message */
+struct coap_conn {
+    int fd;
+    std::string rx;
+    /* messages and bytes sent and received */
+    uint32_t sent;
+    uint32_t received;
+    uint64_t tx_bytes;
+    uint64_t rx_bytes;
+};
+
+void coap_conn_init(struct coap_conn *c, int fd);
+/* returns false if the connection is broken */
+bool coap_send(struct coap_conn *c, const struct coap_msg *msg);
+/*
+ * takes the next message, reading from the socket if a whole one hasn't
+ * been received.  returns 1 for a message, 0 if there is none yet, and -1
+ * if the connection was closed or broken.
+ */
+int coap_recv(struct coap_conn *c, struct coap_msg *msg);
+void coap_close(struct coap_conn *c);
+
+#endif /* FAKE_COAP_H */
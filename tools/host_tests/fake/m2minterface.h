@@ -0,0 +1,28 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FAKE_M2MINTERFACE_H
+#define FAKE_M2MINTERFACE_H
+
+#include "m2mresource.h"
+
+class M2MInterfaceFactory
+{
+public:
+    static M2MObject *create_object(const char *name);
+};
+
+#endif /* FAKE_M2MINTERFACE_H */
@@ -0,0 +1,222 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FAKE_M2MRESOURCE_H
+#define FAKE_M2MRESOURCE_H
+
+/*
+ * the parts of the mbed-client object model that M2MClient uses.  objects,
+ * instances and resources know their path and parent, and resources keep
+ * a copy of their value like the real ones do.  a resource the server
+ * observes passes every new value to its observation handler, the cloud
+ * client, which notifies the server.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class M2MObject;
+class M2MObjectInstance;
+class M2MResource;
+class M2MResourceInstance;
+
+typedef std::vector<M2MObject *> M2MObjectList;
+typedef std::vector<M2MObjectInstance *> M2MObjectInstanceList;
+typedef std::vector<M2MResource *> M2MResourceList;
+
+/* sends the notifications of observed resources */
+class M2MObservationHandler
+{
+public:
+    virtual ~M2MObservationHandler() {}
+    virtual void observation_to_be_sent(M2MResourceInstance *res) = 0;
+};
+
+/* executable resources are never executed */
+class execute_callback
+{
+public:
+    template <typename T>
+    execute_callback(T *object, void (T::*method)(void *)) {}
+};
+
+class M2MBase
+{
+public:
+    enum BaseType {
+        Object = 0x0,
+        Resource = 0x1,
+        ObjectInstance = 0x2,
+        ResourceInstance = 0x3
+    };
+
+    enum Operation {
+        NOT_ALLOWED = 0x00,
+        GET_ALLOWED = 0x01,
+        PUT_ALLOWED = 0x02,
+        GET_PUT_ALLOWED = 0x03,
+        POST_ALLOWED = 0x04,
+        GET_POST_ALLOWED = 0x05,
+        PUT_POST_ALLOWED = 0x06,
+        GET_PUT_POST_ALLOWED = 0x07,
+        DELETE_ALLOWED = 0x08
+    };
+
+    enum NotificationDeliveryStatus {
+        NOTIFICATION_STATUS_INIT = 0,
+        NOTIFICATION_STATUS_BUILD_ERROR,
+        NOTIFICATION_STATUS_RESEND_QUEUE_FULL,
+        NOTIFICATION_STATUS_SENT,
+        NOTIFICATION_STATUS_DELIVERED,
+        NOTIFICATION_STATUS_SEND_FAILED,
+        NOTIFICATION_STATUS_SUBSCRIBED,
+        NOTIFICATION_STATUS_UNSUBSCRIBED
+    };
+
+    typedef void (*notification_delivery_status_cb)(
+        const M2MBase &base, const NotificationDeliveryStatus status,
+        void *client_args);
+
+    M2MBase(const char *parent_path, const char *name);
+    virtual ~M2MBase();
+
+    const char *name() const { return _name.c_str(); }
+    const char *uri_path() const { return _path.c_str(); }
+    const char *resource_type() const { return ""; }
+    void set_operation(Operation operation) { _operation = operation; }
+    Operation operation() const { return _operation; }
+    void set_observable(bool observable) { _observable = observable; }
+    bool is_observable() const { return _observable; }
+
+    /* an observation, and the token its notifications carry */
+    void set_under_observation(bool observed, M2MObservationHandler *handler)
+    {
+        _observation_handler = observed ? handler : NULL;
+        _observation_number = 0;
+    }
+    bool is_under_observation() const { return NULL != _observation_handler; }
+    M2MObservationHandler *observation_handler() const
+    {
+        return _observation_handler;
+    }
+    void set_observation_token(const std::string &token) { _token = token; }
+    const std::string &observation_token() const { return _token; }
+    /* the Observe option of the next notification */
+    uint32_t next_observation_number() { return ++_observation_number; }
+
+    void set_notification_delivery_status_cb(
+        notification_delivery_status_cb callback, void *client_args)
+    {
+        _delivery_cb = callback;
+        _delivery_args = client_args;
+    }
+    void send_notification_delivery_status(NotificationDeliveryStatus status)
+    {
+        if (NULL != _delivery_cb) {
+            _delivery_cb(*this, status, _delivery_args);
+        }
+    }
+
+private:
+    std::string _name;
+    std::string _path;
+    Operation _operation;
+    bool _observable;
+    M2MObservationHandler *_observation_handler;
+    std::string _token;
+    uint32_t _observation_number;
+    notification_delivery_status_cb _delivery_cb;
+    void *_delivery_args;
+};
+
+class M2MResourceInstance : public M2MBase
+{
+public:
+    enum ResourceType {
+        STRING,
+        INTEGER,
+        FLOAT,
+        BOOLEAN,
+        OPAQUE,
+        TIME,
+        OBJLINK
+    };
+
+    M2MResourceInstance(const char *parent_path, const char *name)
+        : M2MBase(parent_path, name), _value(NULL), _value_length(0),
+          _writes(0) {}
+    virtual ~M2MResourceInstance();
+
+    bool set_value(const uint8_t *value, uint32_t value_length);
+    uint8_t *value() const { return _value; }
+    uint32_t value_length() const { return _value_length; }
+
+    /* the number of times the value was set, for the tests */
+    unsigned writes() const { return _writes; }
+
+private:
+    uint8_t *_value;
+    uint32_t _value_length;
+    unsigned _writes;
+};
+
+class M2MResource : public M2MResourceInstance
+{
+public:
+    M2MResource(M2MObjectInstance &parent, const char *name);
+
+    M2MObjectInstance &get_parent_object_instance() const { return _parent; }
+    bool set_execute_function(execute_callback callback) { return true; }
+
+private:
+    M2MObjectInstance &_parent;
+};
+
+class M2MObjectInstance : public M2MBase
+{
+public:
+    M2MObjectInstance(M2MObject &parent, const char *name);
+
+    M2MResource *create_dynamic_resource(const char *resource_name,
+                                         const char *resource_type,
+                                         M2MResourceInstance::ResourceType type,
+                                         bool observable,
+                                         bool multiple_instance = false);
+    M2MResource *resource(const char *resource_name) const;
+    const M2MResourceList &resources() const { return _resources; }
+    M2MObject &get_parent_object() const { return _parent; }
+
+private:
+    M2MObject &_parent;
+    M2MResourceList _resources;
+};
+
+class M2MObject : public M2MBase
+{
+public:
+    explicit M2MObject(const char *name) : M2MBase(NULL, name) {}
+
+    M2MObjectInstance *create_object_instance(uint16_t instance_id = 0);
+    M2MObjectInstance *object_instance(uint16_t instance_id = 0) const;
+    const M2MObjectInstanceList &instances() const { return _instances; }
+
+private:
+    M2MObjectInstanceList _instances;
+};
+
+#endif /* FAKE_M2MRESOURCE_H */
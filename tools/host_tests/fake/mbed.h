@@ -0,0 +1,83 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FAKE_MBED_H
+#define FAKE_MBED_H
+
+/* just enough of mbed OS for the modules built by the host tests */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <string>
+
+/* the host clock in microseconds, wrapping like the ticker does */
+static inline uint32_t us_ticker_read(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+/* the host tests run on one thread */
+static inline void core_util_critical_section_enter(void) {}
+static inline void core_util_critical_section_exit(void) {}
+
+typedef void (*fake_hook)(void);
+
+/* called whenever a Mutex is unlocked, so that a test can run code where
+ * another thread could */
+inline fake_hook &fake_mutex_unlock_hook(void)
+{
+    static fake_hook hook = NULL;
+
+    return hook;
+}
+
+class Mutex
+{
+public:
+    void lock() {}
+
+    void unlock()
+    {
+        if (NULL != fake_mutex_unlock_hook()) {
+            fake_mutex_unlock_hook()();
+        }
+    }
+};
+
+/* a bus without devices: writes succeed and reads return zeros */
+class I2C
+{
+public:
+    int write(int address, const char *data, int length, bool repeated = false)
+    {
+        return 0;
+    }
+
+    int read(int address, char *data, int length, bool repeated = false)
+    {
+        memset(data, 0, length);
+        return 0;
+    }
+};
+
+#endif /* FAKE_MBED_H */
@@ -0,0 +1,566 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MbedCloudClient.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MBED_CLOUD_CLIENT_LIFETIME
+#define MBED_CLOUD_CLIENT_LIFETIME 3600
+#endif
+
+M2MObjectList fake_cloud_objects;
+uint16_t fake_cloud_port;
+
+M2MBase::M2MBase(const char *parent_path, const char *name)
+    : _name(name), _operation(NOT_ALLOWED), _observable(false),
+      _observation_handler(NULL), _observation_number(0), _delivery_cb(NULL),
+      _delivery_args(NULL)
+{
+    if (NULL != parent_path) {
+        _path = std::string(parent_path) + "/";
+    }
+    _path += name;
+}
+
+M2MBase::~M2MBase()
+{
+}
+
+M2MResourceInstance::~M2MResourceInstance()
+{
+    free(_value);
+}
+
+/* like mbed-client, every write replaces the value with a new copy, and is
+ * notified to the server if it observes the resource */
+bool M2MResourceInstance::set_value(const uint8_t *value,
+                                    uint32_t value_length)
+{
+    uint8_t *copy;
+
+    copy = (uint8_t *)malloc(value_length + 1);
+    if (NULL == copy) {
+        return false;
+    }
+    memcpy(copy, value, value_length);
+    copy[value_length] = '\0';
+
+    free(_value);
+    _value = copy;
+    _value_length = value_length;
+    _writes++;
+    if (is_under_observation()) {
+        observation_handler()->observation_to_be_sent(this);
+    }
+    return true;
+}
+
+M2MResource::M2MResource(M2MObjectInstance &parent, const char *name)
+    : M2MResourceInstance(parent.uri_path(), name), _parent(parent)
+{
+}
+
+M2MObjectInstance::M2MObjectInstance(M2MObject &parent, const char *name)
+    : M2MBase(parent.uri_path(), name), _parent(parent)
+{
+}
+
+M2MResource *M2MObjectInstance::create_dynamic_resource(
+    const char *resource_name, const char *resource_type,
+    M2MResourceInstance::ResourceType type, bool observable,
+    bool multiple_instance)
+{
+    M2MResource *res;
+
+    res = new M2MResource(*this, resource_name);
+    res->set_observable(observable);
+    _resources.push_back(res);
+    return res;
+}
+
+M2MResource *M2MObjectInstance::resource(const char *resource_name) const
+{
+    for (size_t i = 0; i < _resources.size(); i++) {
+        if (0 == strcmp(_resources[i]->name(), resource_name)) {
+            return _resources[i];
+        }
+    }
+    return NULL;
+}
+
+M2MObjectInstance *M2MObject::create_object_instance(uint16_t instance_id)
+{
+    char name[8];
+    M2MObjectInstance *inst;
+
+    snprintf(name, sizeof(name), "%u", instance_id);
+    inst = new M2MObjectInstance(*this, name);
+    _instances.push_back(inst);
+    return inst;
+}
+
+M2MObjectInstance *M2MObject::object_instance(uint16_t instance_id) const
+{
+    char name[8];
+
+    snprintf(name, sizeof(name), "%u", instance_id);
+    for (size_t i = 0; i < _instances.size(); i++) {
+        if (0 == strcmp(_instances[i]->name(), name)) {
+            return _instances[i];
+        }
+    }
+    return NULL;
+}
+
+M2MObject *M2MInterfaceFactory::create_object(const char *name)
+{
+    return new M2MObject(name);
+}
+
+MbedCloudClient::MbedCloudClient()
+    : _request(FAKE_REQUEST_NONE), _tokens(0), _block(0), _firmware_size(0),
+      _holding(false), _download_granted(false), _install_granted(false),
+      _update_callback(NULL), _on_registered(NULL), _on_unregistered(NULL),
+      _on_updated(NULL), _on_error(NULL), _authorize_handler(NULL),
+      _progress_handler(NULL)
+{
+    coap_conn_init(&_conn, -1);
+}
+
+MbedCloudClient::~MbedCloudClient()
+{
+    coap_close(&_conn);
+    delete _on_registered;
+    delete _on_unregistered;
+    delete _on_updated;
+    delete _on_error;
+}
+
+bool MbedCloudClient::connect()
+{
+    struct sockaddr_in addr;
+    struct coap_msg csm;
+    int fd;
+    int one = 1;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(fake_cloud_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (0 != ::connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        ::close(fd);
+        return false;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    coap_conn_init(&_conn, fd);
+
+    /* both ends open with their capabilities and settings */
+    coap_init(&csm, COAP_CSM, "");
+    return coap_send(&_conn, &csm);
+}
+
+/* the observations end with the connection, a new registration makes the
+ * server observe again */
+void MbedCloudClient::disconnected()
+{
+    M2MObjectInstanceList::const_iterator inst;
+    M2MResourceList::const_iterator res;
+
+    coap_close(&_conn);
+    _request = FAKE_REQUEST_NONE;
+    _holding = false;
+    for (size_t i = 0; i < _objects.size(); i++) {
+        for (inst = _objects[i]->instances().begin();
+             inst != _objects[i]->instances().end(); ++inst) {
+            for (res = (*inst)->resources().begin();
+                 res != (*inst)->resources().end(); ++res) {
+                (*res)->set_under_observation(false, NULL);
+            }
+        }
+    }
+}
+
+void MbedCloudClient::fake_disconnect()
+{
+    disconnected();
+}
+
+bool MbedCloudClient::setup(void *iface)
+{
+    M2MObjectInstanceList::const_iterator inst;
+    M2MResourceList::const_iterator res;
+
+    if (0 == fake_cloud_port) {
+        return true;
+    }
+    if (!fake_connected() && !connect()) {
+        return false;
+    }
+
+    /* "</3303/0/5700>;obs," for every resource */
+    _links.clear();
+    for (size_t i = 0; i < _objects.size(); i++) {
+        for (inst = _objects[i]->instances().begin();
+             inst != _objects[i]->instances().end(); ++inst) {
+            for (res = (*inst)->resources().begin();
+                 res != (*inst)->resources().end(); ++res) {
+                if (!_links.empty()) {
+                    _links += ',';
+                }
+                _links += "</";
+                _links += (*res)->uri_path();
+                _links += '>';
+                if ((*res)->is_observable()) {
+                    _links += ";obs";
+                }
+            }
+        }
+    }
+    _location.clear();
+    _block = 0;
+    send_registration_block();
+    return true;
+}
+
+void MbedCloudClient::send_request(uint8_t code, const char *path,
+                                   enum fake_request request,
+                                   struct coap_msg *msg)
+{
+    char token[12];
+
+    snprintf(token, sizeof(token), "%lu", (unsigned long)++_tokens);
+    msg->code = code;
+    msg->token = token;
+    coap_add_path(msg, COAP_OPTION_URI_PATH, path);
+    _request = request;
+    _request_token = msg->token;
+    if (!coap_send(&_conn, msg)) {
+        disconnected();
+        run(_on_error, ConnectNetworkError);
+    }
+}
+
+/* the links go in blocks of SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE, each
+ * waiting for the server to take the one before */
+void MbedCloudClient::send_registration_block()
+{
+    struct coap_msg msg;
+    char query[32];
+    size_t offset = _block * COAP_BLOCK_SIZE;
+    bool more = offset + COAP_BLOCK_SIZE < _links.size();
+
+    coap_init(&msg, COAP_POST, "");
+    coap_add(&msg, COAP_OPTION_URI_QUERY, "ep=host");
+    snprintf(query, sizeof(query), "lt=%d", MBED_CLOUD_CLIENT_LIFETIME);
+    coap_add(&msg, COAP_OPTION_URI_QUERY, query);
+    coap_add(&msg, COAP_OPTION_URI_QUERY, "b=T");
+    coap_add_uint(&msg, COAP_OPTION_CONTENT_FORMAT, COAP_FORMAT_LINK);
+    if (_links.size() > COAP_BLOCK_SIZE) {
+        coap_add_block(&msg, COAP_OPTION_BLOCK1, _block, more);
+        if (0 == _block) {
+            coap_add_uint(&msg, COAP_OPTION_SIZE1, _links.size());
+        }
+    }
+    msg.payload = _links.substr(offset, COAP_BLOCK_SIZE);
+    send_request(COAP_POST, "rd", FAKE_REQUEST_REGISTER, &msg);
+}
+
+void MbedCloudClient::register_update()
+{
+    struct coap_msg msg;
+
+    if (0 == fake_cloud_port || _location.empty() ||
+        FAKE_REQUEST_NONE != _request) {
+        return;
+    }
+    if (!fake_connected() && !connect()) {
+        run(_on_error, ConnectNetworkError);
+        return;
+    }
+    coap_init(&msg, COAP_POST, "");
+    send_request(COAP_POST, _location.c_str(), FAKE_REQUEST_UPDATE, &msg);
+}
+
+void MbedCloudClient::close()
+{
+    struct coap_msg msg;
+
+    if (!fake_connected()) {
+        return;
+    }
+    if (_location.empty()) {
+        disconnected();
+        return;
+    }
+    coap_init(&msg, COAP_DELETE, "");
+    send_request(COAP_DELETE, _location.c_str(), FAKE_REQUEST_UNREGISTER,
+                 &msg);
+}
+
+void MbedCloudClient::update_authorize(int32_t request)
+{
+    struct coap_msg held;
+
+    switch (request) {
+        case UpdateRequestDownload:
+            _download_granted = true;
+            if (_holding) {
+                _holding = false;
+                held = _held;
+                handle_firmware(&held);
+            }
+            break;
+        case UpdateRequestInstall:
+            /* where the device would reboot into the new image */
+            _install_granted = true;
+            break;
+        default:
+            break;
+    }
+}
+
+void MbedCloudClient::observation_to_be_sent(M2MResourceInstance *res)
+{
+    struct coap_msg msg;
+
+    if (!fake_connected()) {
+        res->send_notification_delivery_status(
+            M2MBase::NOTIFICATION_STATUS_SEND_FAILED);
+        return;
+    }
+    coap_init(&msg, COAP_CONTENT, res->observation_token());
+    coap_add_uint(&msg, COAP_OPTION_OBSERVE, res->next_observation_number());
+    coap_add_uint(&msg, COAP_OPTION_CONTENT_FORMAT, COAP_FORMAT_TEXT);
+    msg.payload.assign((const char *)res->value(), res->value_length());
+    /* TCP has no acknowledgements, a notification is done once sent */
+    if (coap_send(&_conn, &msg)) {
+        res->send_notification_delivery_status(
+            M2MBase::NOTIFICATION_STATUS_SENT);
+    } else {
+        res->send_notification_delivery_status(
+            M2MBase::NOTIFICATION_STATUS_SEND_FAILED);
+    }
+}
+
+unsigned MbedCloudClient::fake_poll()
+{
+    struct coap_msg msg;
+    unsigned handled = 0;
+    int ret;
+
+    while (fake_connected()) {
+        ret = coap_recv(&_conn, &msg);
+        if (0 == ret) {
+            break;
+        }
+        if (ret < 0) {
+            disconnected();
+            run(_on_error, ConnectNetworkError);
+            break;
+        }
+        handled++;
+        if (7 == msg.code >> 5) {
+            continue;
+        }
+        if (0 == msg.code >> 5) {
+            handle_request(&msg);
+        } else {
+            handle_response(&msg);
+        }
+    }
+    return handled;
+}
+
+void MbedCloudClient::handle_response(const struct coap_msg *msg)
+{
+    enum fake_request request = _request;
+
+    if (FAKE_REQUEST_NONE == request || msg->token != _request_token) {
+        return;
+    }
+    _request = FAKE_REQUEST_NONE;
+
+    switch (request) {
+        case FAKE_REQUEST_REGISTER:
+            if (COAP_CONTINUE == msg->code) {
+                _block++;
+                send_registration_block();
+            } else if (COAP_CREATED == msg->code) {
+                _location = coap_get_path(msg, COAP_OPTION_LOCATION_PATH);
+                run(_on_registered);
+            } else {
+                run(_on_error, ConnectNotAllowed);
+            }
+            break;
+        case FAKE_REQUEST_UPDATE:
+            if (COAP_CHANGED == msg->code) {
+                run(_on_updated);
+            } else {
+                /* the server forgot the registration, make it again */
+                setup(NULL);
+            }
+            break;
+        case FAKE_REQUEST_UNREGISTER:
+            _location.clear();
+            disconnected();
+            run(_on_unregistered);
+            break;
+        default:
+            break;
+    }
+}
+
+M2MResource *MbedCloudClient::find_resource(const std::string &path)
+{
+    M2MObjectInstanceList::const_iterator inst;
+    M2MResourceList::const_iterator res;
+
+    for (size_t i = 0; i < _objects.size(); i++) {
+        for (inst = _objects[i]->instances().begin();
+             inst != _objects[i]->instances().end(); ++inst) {
+            for (res = (*inst)->resources().begin();
+                 res != (*inst)->resources().end(); ++res) {
+                if (path == (*res)->uri_path()) {
+                    return *res;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+void MbedCloudClient::reply(const struct coap_msg *request, uint8_t code,
+                            struct coap_msg *msg)
+{
+    msg->code = code;
+    msg->token = request->token;
+    if (!coap_send(&_conn, msg)) {
+        disconnected();
+        run(_on_error, ConnectNetworkError);
+    }
+}
+
+void MbedCloudClient::handle_request(const struct coap_msg *msg)
+{
+    std::string path = coap_get_path(msg, COAP_OPTION_URI_PATH);
+    struct coap_msg resp;
+    M2MResource *res;
+    uint32_t observe;
+
+    if (COAP_PUT == msg->code && "5/0/0" == path) {
+        handle_firmware(msg);
+        return;
+    }
+
+    coap_init(&resp, 0, "");
+    res = find_resource(path);
+    if (NULL == res) {
+        reply(msg, COAP_NOT_FOUND, &resp);
+        return;
+    }
+
+    switch (msg->code) {
+        case COAP_GET:
+            if (coap_get_uint(msg, COAP_OPTION_OBSERVE, &observe)) {
+                if (0 == observe && res->is_observable()) {
+                    res->set_under_observation(true, this);
+                    res->set_observation_token(msg->token);
+                    coap_add_uint(&resp, COAP_OPTION_OBSERVE,
+                                  res->next_observation_number());
+                } else {
+                    res->set_under_observation(false, NULL);
+                }
+            }
+            coap_add_uint(&resp, COAP_OPTION_CONTENT_FORMAT,
+                          COAP_FORMAT_TEXT);
+            if (NULL != res->value()) {
+                resp.payload.assign((const char *)res->value(),
+                                    res->value_length());
+            }
+            reply(msg, COAP_CONTENT, &resp);
+            break;
+        case COAP_PUT:
+            if (0 == (res->operation() & M2MBase::PUT_ALLOWED)) {
+                reply(msg, COAP_METHOD_NOT_ALLOWED, &resp);
+                break;
+            }
+            res->set_value((const uint8_t *)msg->payload.data(),
+                           msg->payload.size());
+            reply(msg, COAP_CHANGED, &resp);
+            if (NULL != _update_callback) {
+                _update_callback->value_updated(res, M2MBase::Resource);
+            }
+            break;
+        default:
+            reply(msg, COAP_METHOD_NOT_ALLOWED, &resp);
+            break;
+    }
+}
+
+/* an image pushed block-wise, each block acknowledged before the next */
+void MbedCloudClient::handle_firmware(const struct coap_msg *msg)
+{
+    struct coap_msg resp;
+    uint32_t num = 0;
+    bool more = false;
+    unsigned szx = COAP_BLOCK_SZX;
+
+    coap_get_block(msg, COAP_OPTION_BLOCK1, &num, &more, &szx);
+    if (0 == num) {
+        /* the download waits for the application to grant it */
+        if (!_download_granted && NULL != _authorize_handler) {
+            _held = *msg;
+            _holding = true;
+            _authorize_handler(UpdateRequestDownload);
+            return;
+        }
+        _firmware.clear();
+        _firmware_size = msg->payload.size();
+        coap_get_uint(msg, COAP_OPTION_SIZE1, &_firmware_size);
+    }
+
+    coap_init(&resp, 0, "");
+    if (szx != COAP_BLOCK_SZX || num * COAP_BLOCK_SIZE != _firmware.size()) {
+        reply(msg, COAP_REQUEST_INCOMPLETE, &resp);
+        return;
+    }
+    _firmware += msg->payload;
+    if (NULL != _progress_handler) {
+        _progress_handler(_firmware.size(), _firmware_size);
+    }
+    if (more) {
+        coap_add_block(&resp, COAP_OPTION_BLOCK1, num, true);
+        reply(msg, COAP_CONTINUE, &resp);
+        return;
+    }
+    reply(msg, COAP_CHANGED, &resp);
+    _download_granted = false;
+    if (NULL != _authorize_handler) {
+        _authorize_handler(UpdateRequestInstall);
+    }
+}
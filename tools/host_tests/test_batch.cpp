@@ -0,0 +1,116 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * M2MClient update batches: values are held back until the batch ends,
+ * and the last value written to a resource is the one it keeps.
+ */
+
+#include "host_test.h"
+#include "m2mclient.h"
+
+#include <string>
+
+/* longer than a batch holds back */
+static const char long_value[] = "a value too long for the batch";
+
+static std::string value_of(M2MClient &client,
+                            enum M2MClient::M2MClientResource resource)
+{
+    return client.get_resource_value_str(resource);
+}
+
+static void test_deferred(M2MClient &client)
+{
+    uint32_t notifications = client.notifications();
+
+    client.begin_update();
+    client.set_resource_value(M2MClient::M2MClientResourceAppLabel, "one", 3);
+    client.set_resource_value(M2MClient::M2MClientResourceAppLabel, "two", 3);
+    client.set_resource_value(M2MClient::M2MClientResourceNetwork, "net", 3);
+    /* nested batches end with the outer one */
+    client.begin_update();
+    client.set_resource_value(M2MClient::M2MClientResourceNetwork, "wifi", 4);
+    client.end_update();
+    CHECK("two" != value_of(client, M2MClient::M2MClientResourceAppLabel));
+    CHECK(notifications == client.notifications());
+    client.end_update();
+
+    CHECK("two" == value_of(client, M2MClient::M2MClientResourceAppLabel));
+    CHECK("wifi" == value_of(client, M2MClient::M2MClientResourceNetwork));
+    CHECK(notifications + 2 == client.notifications());
+}
+
+static void test_long_value(M2MClient &client)
+{
+    /* a long value written after a short one is not overwritten by it */
+    client.begin_update();
+    client.set_resource_value(M2MClient::M2MClientResourceAppLabel,
+                              "short", 5);
+    client.set_resource_value(M2MClient::M2MClientResourceNetwork, "x", 1);
+    client.set_resource_value(M2MClient::M2MClientResourceAppLabel,
+                              long_value, strlen(long_value));
+    CHECK(long_value ==
+          value_of(client, M2MClient::M2MClientResourceAppLabel));
+    client.end_update();
+
+    CHECK(long_value ==
+          value_of(client, M2MClient::M2MClientResourceAppLabel));
+    CHECK("x" == value_of(client, M2MClient::M2MClientResourceNetwork));
+
+    /* and a short value written after it is */
+    client.begin_update();
+    client.set_resource_value(M2MClient::M2MClientResourceAppLabel,
+                              long_value, strlen(long_value));
+    client.set_resource_value(M2MClient::M2MClientResourceAppLabel,
+                              "after", 5);
+    client.end_update();
+    CHECK("after" == value_of(client, M2MClient::M2MClientResourceAppLabel));
+}
+
+static void test_full(M2MClient &client)
+{
+    char val[8];
+
+    /* values that don't fit the batch are written straight away */
+    client.begin_update();
+    for (int i = 0; i < M2MCLIENT_BATCH_MAX + 1; i++) {
+        snprintf(val, sizeof(val), "%d", i);
+        client.set_resource_value(
+            (enum M2MClient::M2MClientResource)
+            (M2MClient::M2MClientResourceTempValue + i), val, strlen(val));
+    }
+    snprintf(val, sizeof(val), "%d", M2MCLIENT_BATCH_MAX);
+    CHECK(val == value_of(client,
+                          (enum M2MClient::M2MClientResource)
+                          (M2MClient::M2MClientResourceTempValue +
+                           M2MCLIENT_BATCH_MAX)));
+    CHECK("0" != value_of(client, M2MClient::M2MClientResourceTempValue));
+    client.end_update();
+    CHECK("0" == value_of(client, M2MClient::M2MClientResourceTempValue));
+}
+
+int main()
+{
+    M2MClient client;
+
+    CHECK(0 == client.init());
+    test_deferred(client);
+    test_long_value(client);
+    test_full(client);
+
+    return host_test_result("test_batch");
+}
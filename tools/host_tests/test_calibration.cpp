@@ -0,0 +1,75 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * calibration_parse() takes well formed tables and rejects the rest
+ * without touching the calibration in use.
+ */
+
+#include "host_test.h"
+#include "calibration.h"
+
+#include <math.h>
+
+static const char *const valid[] = {
+    "0.68",
+    "0:-1.5,20:19.2,40:40.1",
+    "-10:0,0:1",
+};
+
+static const char *const invalid[] = {
+    "",
+    "nan",
+    "inf",
+    "-inf",
+    "1e39",
+    "0:0",
+    "0:0,1:nan",
+    "0:0,nan:1",
+    "nan:0,1:1",
+    "0:0,inf:1",
+    "0:0,1:1,1:2",
+    "0:0,2:1,1:2",
+    "0:0,1e-45:1",
+    "0:0,1:1,2:2,3:3,4:4,5:5,6:6,7:7,8:8",
+    "0:0;1:1",
+};
+
+int main()
+{
+    struct calibration cal;
+
+    for (unsigned i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+        CHECK(0 == calibration_parse(&cal, valid[i]));
+    }
+
+    CHECK(0 == calibration_parse(&cal, "0:-1.5,20:19.2,40:40.1"));
+    CHECK(fabsf(calibration_apply(&cal, 10.0f) - 8.85f) < 1e-4f);
+    CHECK(fabsf(calibration_apply(&cal, 30.0f) - 29.65f) < 1e-4f);
+    CHECK(fabsf(calibration_apply(&cal, 60.0f) - 61.0f) < 1e-4f);
+
+    /* a rejected table leaves the last one in place */
+    calibration_identity(&cal);
+    for (unsigned i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        if (0 == calibration_parse(&cal, invalid[i])) {
+            printf("accepted \"%s\"\n", invalid[i]);
+            CHECK(false);
+        }
+        CHECK(12.5f == calibration_apply(&cal, 12.5f));
+    }
+
+    return host_test_result("test_calibration");
+}
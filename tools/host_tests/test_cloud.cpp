@@ -0,0 +1,735 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * M2MClient against a stand-in LwM2M server, over CoAP over TCP on the
+ * loopback.  The server takes the registration in blocks, its updates and
+ * the deregistration, observes every observable resource, PUTs values and
+ * pushes a firmware image block-wise to /5/0/0.  The callbacks passed to
+ * M2MClient do what those of main.cpp do with the cloud client, minus the
+ * display, the sensors and the event queue, whose calls run between polls
+ * here.  Checks the registration links against M2MClient's estimate,
+ * notifications and their delivery reports, PUT dispatch, resuming a
+ * registration after a dropped connection, and the firmware authorization
+ * sequence.  Reports the registration and update latency, notifications
+ * per second and the firmware throughput on the host.
+ */
+
+#include "host_test.h"
+#include "m2mclient.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+/* how long a run waits for an exchange before it fails */
+#define RUN_TIMEOUT_US 5000000
+
+#define BENCH_REGISTRATIONS 200
+#define BENCH_UPDATES 1000
+#define BENCH_NOTIFICATIONS 100000
+#define BENCH_FIRMWARE (1024 * 1024)
+/* notifications sent between polls of the server */
+#define NOTIFY_BURST 64
+
+/*
+ * the stand-in server, one client at a time
+ */
+struct server {
+    int listen_fd;
+    struct coap_conn conn;
+    uint32_t tokens;
+
+    /* the registration, its links and the resources that are observable */
+    bool registered;
+    uint32_t reg_id;
+    std::string links;
+    uint32_t reg_blocks;
+    std::vector<std::string> observable;
+    /* the last value notified for each of them */
+    std::vector<std::string> values;
+
+    uint32_t registrations;
+    uint32_t updates;
+    uint32_t rejected_updates;
+    uint32_t deregistrations;
+    uint32_t observed;
+    uint32_t notifications;
+    uint32_t put_changed;
+    uint32_t put_refused;
+
+    /* the image being pushed, and the blocks the client took */
+    std::string image;
+    uint32_t fw_blocks;
+    uint32_t fw_done;
+    uint32_t fw_failed;
+};
+
+static struct server server;
+
+static std::string server_token(char kind, uint32_t n)
+{
+    char token[12];
+
+    snprintf(token, sizeof(token), "%c%lu", kind, (unsigned long)n);
+    return token;
+}
+
+static void server_send(struct coap_msg *msg)
+{
+    CHECK(coap_send(&server.conn, msg));
+}
+
+static void server_reply(const struct coap_msg *req, uint8_t code,
+                         struct coap_msg *resp)
+{
+    resp->code = code;
+    resp->token = req->token;
+    server_send(resp);
+}
+
+static void server_start(void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    server.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(0 == bind(server.listen_fd, (struct sockaddr *)&addr, sizeof(addr)));
+    CHECK(0 == listen(server.listen_fd, 1));
+    fcntl(server.listen_fd, F_SETFL, O_NONBLOCK);
+    getsockname(server.listen_fd, (struct sockaddr *)&addr, &len);
+    coap_conn_init(&server.conn, -1);
+    fake_cloud_port = ntohs(addr.sin_port);
+}
+
+/* lists the resources of the links that may be observed */
+static void server_parse_links(void)
+{
+    size_t start = 0;
+    size_t end;
+    std::string link;
+
+    server.observable.clear();
+    while (start < server.links.size()) {
+        end = server.links.find(',', start);
+        if (std::string::npos == end) {
+            end = server.links.size();
+        }
+        link = server.links.substr(start, end - start);
+        if (std::string::npos != link.find(";obs")) {
+            server.observable.push_back(link.substr(2, link.find('>') - 2));
+        }
+        start = end + 1;
+    }
+    server.values.assign(server.observable.size(), "");
+}
+
+/* POST /rd in blocks, then POST and DELETE of /rd/<id> */
+static void server_handle_request(const struct coap_msg *req)
+{
+    std::string path = coap_get_path(req, COAP_OPTION_URI_PATH);
+    struct coap_msg resp;
+    uint32_t num = 0;
+    bool more = false;
+    unsigned szx;
+    char location[16];
+    char id[12];
+
+    snprintf(location, sizeof(location), "rd/%lu",
+             (unsigned long)server.reg_id);
+    coap_init(&resp, 0, "");
+    if (COAP_POST == req->code && "rd" == path) {
+        if (!coap_get_block(req, COAP_OPTION_BLOCK1, &num, &more, &szx)) {
+            num = 0;
+        }
+        if (0 == num) {
+            server.links.clear();
+            server.reg_blocks = 0;
+        }
+        server.links += req->payload;
+        server.reg_blocks++;
+        if (more) {
+            coap_add_block(&resp, COAP_OPTION_BLOCK1, num, true);
+            server_reply(req, COAP_CONTINUE, &resp);
+            return;
+        }
+        server_parse_links();
+        server.registered = true;
+        server.reg_id++;
+        server.registrations++;
+        snprintf(id, sizeof(id), "%lu", (unsigned long)server.reg_id);
+        coap_add(&resp, COAP_OPTION_LOCATION_PATH, "rd");
+        coap_add(&resp, COAP_OPTION_LOCATION_PATH, id);
+        server_reply(req, COAP_CREATED, &resp);
+    } else if (COAP_POST == req->code) {
+        if (server.registered && path == location) {
+            server.updates++;
+            server_reply(req, COAP_CHANGED, &resp);
+        } else {
+            server.rejected_updates++;
+            server_reply(req, COAP_NOT_FOUND, &resp);
+        }
+    } else if (COAP_DELETE == req->code && path == location) {
+        server.registered = false;
+        server.deregistrations++;
+        server_reply(req, COAP_DELETED, &resp);
+    } else {
+        server_reply(req, COAP_NOT_FOUND, &resp);
+    }
+}
+
+static void server_send_block(uint32_t num)
+{
+    struct coap_msg msg;
+    size_t offset = num * COAP_BLOCK_SIZE;
+
+    coap_init(&msg, COAP_PUT, server_token('f', num));
+    coap_add_path(&msg, COAP_OPTION_URI_PATH, "5/0/0");
+    coap_add_uint(&msg, COAP_OPTION_CONTENT_FORMAT, COAP_FORMAT_OCTETS);
+    coap_add_block(&msg, COAP_OPTION_BLOCK1, num,
+                   offset + COAP_BLOCK_SIZE < server.image.size());
+    if (0 == num) {
+        coap_add_uint(&msg, COAP_OPTION_SIZE1, server.image.size());
+    }
+    msg.payload = server.image.substr(offset, COAP_BLOCK_SIZE);
+    server_send(&msg);
+}
+
+/* the responses to observations, PUTs and firmware blocks, and the
+ * notifications */
+static void server_handle_response(const struct coap_msg *resp)
+{
+    uint32_t n = strtoul(resp->token.c_str() + 1, NULL, 10);
+    uint32_t observe;
+
+    switch (resp->token[0]) {
+        case 'o':
+            if (n >= server.observable.size() || COAP_CONTENT != resp->code) {
+                break;
+            }
+            server.values[n] = resp->payload;
+            if (!coap_get_uint(resp, COAP_OPTION_OBSERVE, &observe)) {
+                break;
+            }
+            if (1 == observe) {
+                server.observed++;
+            } else {
+                server.notifications++;
+            }
+            break;
+        case 'p':
+            if (COAP_CHANGED == resp->code) {
+                server.put_changed++;
+            } else {
+                server.put_refused++;
+            }
+            break;
+        case 'f':
+            if (COAP_CONTINUE == resp->code) {
+                server.fw_blocks++;
+                server_send_block(n + 1);
+            } else if (COAP_CHANGED == resp->code) {
+                server.fw_blocks++;
+                server.fw_done++;
+            } else {
+                server.fw_failed++;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void server_poll(void)
+{
+    struct coap_msg msg;
+    int fd;
+    int one = 1;
+    int ret;
+
+    fd = accept4(server.listen_fd, NULL, NULL, SOCK_NONBLOCK);
+    if (fd >= 0) {
+        coap_close(&server.conn);
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        coap_conn_init(&server.conn, fd);
+        coap_init(&msg, COAP_CSM, "");
+        server_send(&msg);
+    }
+
+    while (server.conn.fd >= 0) {
+        ret = coap_recv(&server.conn, &msg);
+        if (0 == ret) {
+            break;
+        }
+        if (ret < 0) {
+            coap_close(&server.conn);
+            break;
+        }
+        if (7 == msg.code >> 5) {
+            continue;
+        }
+        if (0 == msg.code >> 5) {
+            server_handle_request(&msg);
+        } else {
+            server_handle_response(&msg);
+        }
+    }
+}
+
+static void server_observe_all(void)
+{
+    struct coap_msg msg;
+
+    for (size_t i = 0; i < server.observable.size(); i++) {
+        coap_init(&msg, COAP_GET, server_token('o', i));
+        coap_add_path(&msg, COAP_OPTION_URI_PATH,
+                      server.observable[i].c_str());
+        coap_add_uint(&msg, COAP_OPTION_OBSERVE, 0);
+        server_send(&msg);
+    }
+}
+
+static void server_put(const char *path, const char *value)
+{
+    struct coap_msg msg;
+
+    coap_init(&msg, COAP_PUT, server_token('p', server.tokens++));
+    coap_add_path(&msg, COAP_OPTION_URI_PATH, path);
+    coap_add_uint(&msg, COAP_OPTION_CONTENT_FORMAT, COAP_FORMAT_TEXT);
+    msg.payload = value;
+    server_send(&msg);
+}
+
+static void server_push_firmware(size_t size)
+{
+    server.image.resize(size);
+    for (size_t i = 0; i < size; i++) {
+        server.image[i] = (char)(i * 2654435761U >> 24);
+    }
+    server.fw_blocks = 0;
+    server_send_block(0);
+}
+
+/* the connection goes, and with it the client's observations */
+static void server_drop(void)
+{
+    coap_close(&server.conn);
+}
+
+static std::string server_value(const char *path)
+{
+    for (size_t i = 0; i < server.observable.size(); i++) {
+        if (server.observable[i] == path) {
+            return server.values[i];
+        }
+    }
+    return "";
+}
+
+/*
+ * the application side, the callbacks of main.cpp
+ */
+static M2MClient *m2mclient;
+
+struct app {
+    uint32_t registered;
+    uint32_t unregistered;
+    uint32_t errors;
+    int last_error;
+    uint32_t updated[M2MClient::M2MClientResourceCount];
+    uint32_t progress;
+    uint32_t progress_total;
+    uint32_t delivered;
+    uint32_t undelivered;
+    uint32_t authorizations;
+    /* calls main.cpp queues on its event queue, run unless held */
+    bool download_pending;
+    bool install_pending;
+    bool hold;
+};
+
+static struct app app;
+
+static void app_on_registered(void *context)
+{
+    app.registered++;
+}
+
+static void app_on_unregistered(void *context)
+{
+    M2MClient *m2m = (M2MClient *)context;
+
+    if (m2m->is_fota_install_requested()) {
+        m2m->update_authorize(MbedCloudClient::UpdateRequestInstall);
+    }
+    app.unregistered++;
+}
+
+static void app_on_error(void *context, int err_code, const char *err_name,
+                         const char *err_desc)
+{
+    app.errors++;
+    app.last_error = err_code;
+}
+
+static void app_on_update_authorize(int32_t request)
+{
+    app.authorizations++;
+    switch (request) {
+        case MbedCloudClient::UpdateRequestDownload:
+            m2mclient->set_fota_download_requested();
+            app.download_pending = true;
+            break;
+        case MbedCloudClient::UpdateRequestInstall:
+            m2mclient->set_fota_install_requested();
+            app.install_pending = true;
+            break;
+        default:
+            CHECK(false);
+            break;
+    }
+}
+
+static void app_on_update_progress(uint32_t progress, uint32_t total)
+{
+    app.progress = progress;
+    app.progress_total = total;
+}
+
+static void app_on_resource_updated(void *context,
+                                    M2MClient::M2MClientResource resource)
+{
+    app.updated[resource]++;
+}
+
+static void app_on_delivery(void *context, bool delivered)
+{
+    if (delivered) {
+        app.delivered++;
+    } else {
+        app.undelivered++;
+    }
+}
+
+/* fota_auth_download() and fota_auth_install() */
+static void app_run(void)
+{
+    if (app.hold) {
+        return;
+    }
+    if (app.download_pending) {
+        app.download_pending = false;
+        m2mclient->update_authorize(MbedCloudClient::UpdateRequestDownload);
+    }
+    if (app.install_pending) {
+        app.install_pending = false;
+        m2mclient->close();
+    }
+}
+
+/* polls both ends until *count reaches target, returns false if it
+ * doesn't within RUN_TIMEOUT_US */
+static bool run_until(const uint32_t *count, uint32_t target)
+{
+    uint32_t start = us_ticker_read();
+
+    while (*count < target) {
+        if (us_ticker_read() - start > RUN_TIMEOUT_US) {
+            return false;
+        }
+        server_poll();
+        m2mclient->get_cloud_client().fake_poll();
+        app_run();
+    }
+    return true;
+}
+
+static void test_register(M2MClient &client)
+{
+    uint32_t registrations = server.registrations;
+
+    CHECK(0 == client.init());
+    client.on_registered(NULL, app_on_registered);
+    client.on_unregistered(&client, app_on_unregistered);
+    client.on_error(&client, app_on_error);
+    client.on_update_authorize(app_on_update_authorize);
+    client.on_update_progress(app_on_update_progress);
+    client.on_resource_updated(&client, app_on_resource_updated);
+    client.on_delivery(M2MClient::M2MClientResourceBacklog, NULL,
+                       app_on_delivery);
+
+    CHECK(client.call_register(NULL));
+    CHECK(!client.is_client_registered());
+    CHECK(run_until(&app.registered, 1));
+    CHECK(client.is_client_registered());
+    CHECK(registrations + 1 == server.registrations);
+
+    /* every resource, in blocks, and M2MClient's estimate of their size is
+     * that of the links and their separators */
+    CHECK((ptrdiff_t)client.registration_resources() ==
+          std::count(server.links.begin(), server.links.end(), '<'));
+    CHECK(server.links.size() + 1 == client.registration_size());
+    CHECK((server.links.size() + COAP_BLOCK_SIZE - 1) / COAP_BLOCK_SIZE ==
+          server.reg_blocks);
+    CHECK(server.reg_blocks > 1);
+}
+
+static void test_notify(M2MClient &client)
+{
+    M2MResource *temp = client.get_resource(M2MClient::M2MClientResourceTempValue);
+    M2MResource *label = client.get_resource(M2MClient::M2MClientResourceAppLabel);
+    uint32_t notifications;
+
+    /* nothing is sent before the server observes */
+    CHECK(!client.is_observed(M2MClient::M2MClientResourceTempValue));
+    client.set_float(M2MClient::M2MClientResourceTempValue, 20.0f, 1);
+
+    server_observe_all();
+    CHECK(run_until(&server.observed, server.observable.size()));
+    CHECK(client.is_observed(M2MClient::M2MClientResourceTempValue));
+    CHECK("20.0" == server_value(temp->uri_path()));
+    CHECK(0 == server.notifications);
+
+    client.set_float(M2MClient::M2MClientResourceTempValue, 21.5f, 1);
+    CHECK(run_until(&server.notifications, 1));
+    CHECK("21.5" == server_value(temp->uri_path()));
+
+    /* an unchanged value isn't notified, and a batch sends each value once */
+    notifications = server.notifications;
+    CHECK(!client.set_float(M2MClient::M2MClientResourceTempValue, 21.5f, 1));
+    client.begin_update();
+    client.set_text(M2MClient::M2MClientResourceAppLabel, "one", 3);
+    client.set_text(M2MClient::M2MClientResourceAppLabel, "two", 3);
+    client.set_float(M2MClient::M2MClientResourceTempValue, 22.0f, 1);
+    client.end_update();
+    CHECK(run_until(&server.notifications, notifications + 2));
+    server_poll();
+    CHECK(notifications + 2 == server.notifications);
+    CHECK("two" == server_value(label->uri_path()));
+    CHECK("22.0" == server_value(temp->uri_path()));
+
+    /* notifications of the offline queue report their delivery */
+    client.set_resource_value(M2MClient::M2MClientResourceBacklog, "q", 1);
+    CHECK(1 == app.delivered && 0 == app.undelivered);
+}
+
+static void test_put(M2MClient &client)
+{
+    M2MResource *label = client.get_resource(M2MClient::M2MClientResourceAppLabel);
+    M2MResource *temp = client.get_resource(M2MClient::M2MClientResourceTempValue);
+
+    /* a PUT reaches the handler of its resource, with the value set */
+    server_put(label->uri_path(), "kitchen");
+    CHECK(run_until(&server.put_changed, 1));
+    CHECK(1 == app.updated[M2MClient::M2MClientResourceAppLabel]);
+    CHECK("kitchen" == client.get_resource_value_str(label));
+
+    /* read-only and unknown resources are refused, without a callback */
+    server_put(temp->uri_path(), "99");
+    server_put("3303/0/9999", "1");
+    CHECK(run_until(&server.put_refused, 2));
+    CHECK(0 == app.updated[M2MClient::M2MClientResourceTempValue]);
+    CHECK("22.0" == client.get_resource_value_str(temp));
+}
+
+static void test_resume(M2MClient &client)
+{
+    uint32_t updates = server.updates;
+
+    client.keep_alive();
+    CHECK(run_until(&server.updates, updates + 1));
+    CHECK(client.registration_age_ms() < 1000);
+
+    /* the connection drops, and the registration is restored with an
+     * update on a new one */
+    server_drop();
+    CHECK(run_until(&app.errors, 1));
+    CHECK(MbedCloudClient::ConnectNetworkError == app.last_error);
+    CHECK(!client.is_client_registered());
+    CHECK(client.resume());
+    CHECK(run_until(&app.registered, 2));
+    CHECK(updates + 2 == server.updates);
+    CHECK(1 == client.resumed() && client.is_client_registered());
+    CHECK(1 == server.registrations);
+
+    /* once the server has forgotten it, the update is rejected and the
+     * client registers in full */
+    server_drop();
+    server.registered = false;
+    CHECK(run_until(&app.errors, 2));
+    CHECK(client.resume());
+    CHECK(run_until(&app.registered, 3));
+    CHECK(1 == server.rejected_updates && 2 == server.registrations);
+    CHECK(1 == client.resumed() && client.is_client_registered());
+
+    /* the new registration is observed again */
+    server_observe_all();
+    CHECK(run_until(&server.observed, 2 * server.observable.size()));
+}
+
+static void test_firmware(M2MClient &client)
+{
+    MbedCloudClient &cloud = client.get_cloud_client();
+
+    /* the download waits for the application to grant it, and the install
+     * for the client to deregister */
+    app.hold = true;
+    server_push_firmware(20 * COAP_BLOCK_SIZE + 100);
+    CHECK(run_until(&app.authorizations, 1));
+    CHECK(client.is_fota_download_requested());
+    server_poll();
+    CHECK(0 == server.fw_blocks && 0 == app.progress);
+    app.hold = false;
+    CHECK(run_until(&server.fw_done, 1));
+    CHECK(21 == server.fw_blocks && 0 == server.fw_failed);
+    CHECK(server.image == cloud.fake_firmware());
+    CHECK(app.progress == app.progress_total &&
+          server.image.size() == app.progress_total);
+
+    CHECK(client.is_fota_install_requested());
+    CHECK(run_until(&app.unregistered, 1));
+    CHECK(1 == server.deregistrations && !server.registered);
+    CHECK(cloud.fake_install_granted());
+    CHECK(!cloud.fake_connected());
+}
+
+static uint32_t elapsed_us(uint32_t start)
+{
+    return us_ticker_read() - start;
+}
+
+static void bench_register(M2MClient &client)
+{
+    uint32_t start;
+    uint32_t reg_us;
+    uint32_t update_us;
+    int out;
+    int null;
+
+    /* each registration on a new connection, without the line M2MClient
+     * prints for every one */
+    fflush(stdout);
+    out = dup(STDOUT_FILENO);
+    null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    start = us_ticker_read();
+    for (int i = 0; i < BENCH_REGISTRATIONS; i++) {
+        client.get_cloud_client().fake_disconnect();
+        client.call_register(NULL);
+        CHECK(run_until(&app.registered, app.registered + 1));
+    }
+    reg_us = elapsed_us(start);
+    fflush(stdout);
+    dup2(out, STDOUT_FILENO);
+    close(out);
+    close(null);
+
+    start = us_ticker_read();
+    for (int i = 0; i < BENCH_UPDATES; i++) {
+        client.keep_alive();
+        CHECK(run_until(&server.updates, server.updates + 1));
+    }
+    update_us = elapsed_us(start);
+
+    printf("bench: registration of %u resources, %lu B of links in %lu "
+           "blocks, %lu us, update %lu us\n",
+           client.registration_resources(),
+           (unsigned long)server.links.size(),
+           (unsigned long)server.reg_blocks,
+           (unsigned long)(reg_us / BENCH_REGISTRATIONS),
+           (unsigned long)(update_us / BENCH_UPDATES));
+}
+
+static void bench_notify(M2MClient &client)
+{
+    uint32_t notifications;
+    uint32_t start;
+    uint32_t us;
+
+    server_observe_all();
+    CHECK(run_until(&server.observed, server.observed +
+                    server.observable.size()));
+
+    notifications = server.notifications;
+    start = us_ticker_read();
+    for (int i = 0; i < BENCH_NOTIFICATIONS; i++) {
+        client.set_int(M2MClient::M2MClientResourceLightValue, i + 1);
+        if (0 == i % NOTIFY_BURST) {
+            server_poll();
+        }
+    }
+    CHECK(run_until(&server.notifications,
+                    notifications + BENCH_NOTIFICATIONS));
+    us = elapsed_us(start);
+
+    printf("bench: %d notifications in %lu ms, %lu/s\n", BENCH_NOTIFICATIONS,
+           (unsigned long)(us / 1000),
+           (unsigned long)(BENCH_NOTIFICATIONS * 1000000ULL / us));
+}
+
+static void bench_firmware(M2MClient &client)
+{
+    uint32_t done = server.fw_done;
+    uint32_t start;
+    uint32_t us;
+
+    start = us_ticker_read();
+    server_push_firmware(BENCH_FIRMWARE);
+    CHECK(run_until(&server.fw_done, done + 1));
+    us = elapsed_us(start);
+    CHECK(server.image == client.get_cloud_client().fake_firmware());
+
+    printf("bench: firmware of %d KiB in %lu blocks of %d B, %lu ms, "
+           "%lu KiB/s\n", BENCH_FIRMWARE / 1024,
+           (unsigned long)server.fw_blocks, COAP_BLOCK_SIZE,
+           (unsigned long)(us / 1000),
+           (unsigned long)(BENCH_FIRMWARE * 1000000ULL / 1024 / us));
+}
+
+int main()
+{
+    M2MClient client;
+    M2MClient bench;
+
+    server_start();
+    m2mclient = &client;
+    test_register(client);
+    test_notify(client);
+    test_put(client);
+    test_resume(client);
+    test_firmware(client);
+
+    /* a client of its own, that registers as often as it is told to */
+    memset(&app, 0, sizeof(app));
+    m2mclient = &bench;
+    test_register(bench);
+    bench_register(bench);
+    bench_notify(bench);
+    bench_firmware(bench);
+
+    return host_test_result("test_cloud");
+}
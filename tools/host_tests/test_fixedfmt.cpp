@@ -0,0 +1,199 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * fixed_format() against snprintf("%.*f") for every precision, from small
+ * values to the ends of the int32_t range.  Reports the time and the stack
+ * high-water mark of both, the latter measured on a painted thread stack.
+ */
+
+#include "host_test.h"
+#include "fixedfmt.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_ROUNDS 1000000
+
+/* the painted stack; large enough for snprintf of the host C library */
+#define STACK_SIZE (64 * 1024)
+#define STACK_PAINT 0xA5
+/* left unpainted below the frame of the probe */
+#define STACK_FRAME 64
+
+static void test_values(void)
+{
+    char buf[FIXED_STRLEN];
+    char ref[32];
+    int32_t val;
+    int len;
+
+    srand(1);
+    for (int i = 0; i < 200000; i++) {
+        /* mostly small values, as sensors give, and the extremes */
+        switch (i % 4) {
+            case 0:
+                val = rand() % 2001 - 1000;
+                break;
+            case 1:
+                val = (int32_t)((uint32_t)rand() << 16 ^ rand());
+                break;
+            case 2:
+                val = INT32_MAX - i;
+                break;
+            default:
+                val = INT32_MIN + i;
+                break;
+        }
+        for (int p = 0; p <= FIXED_MAX_PRECISION; p++) {
+            len = fixed_format(buf, sizeof(buf), val, p);
+            /* the double holds every int32_t / 10^p exactly enough */
+            snprintf(ref, sizeof(ref), "%.*f", p,
+                     (double)val / fixed_scale(p));
+            if (0 != strcmp(buf, ref) || len != (int)strlen(ref)) {
+                CHECK(0 == strcmp(buf, ref));
+                printf("  %ld/10^%d: \"%s\", expected \"%s\"\n",
+                       (long)val, p, buf, ref);
+                return;
+            }
+        }
+    }
+
+    /* truncated like snprintf */
+    CHECK(7 == fixed_format(buf, 4, -12345, 2));
+    CHECK(0 == strcmp(buf, "-12"));
+    CHECK(5 == fixed_format(NULL, 0, 2340, 1));
+
+    CHECK(234 == fixed_from_float(23.4f, 1));
+    CHECK(-235 == fixed_from_float(-23.45f, 1));
+    CHECK(INT32_MAX == fixed_from_float(1e12f, 2));
+}
+
+static volatile float bench_value = 23.4f;
+
+static void format_nothing(void)
+{
+}
+
+static void format_fixed(void)
+{
+    char buf[FIXED_STRLEN];
+
+    fixed_format_float(buf, sizeof(buf), bench_value, 1);
+}
+
+static void format_printf(void)
+{
+    char buf[FIXED_STRLEN];
+
+    snprintf(buf, sizeof(buf), "%.1f", bench_value);
+}
+
+struct stack_probe {
+    void (*fn)(void);
+    uint8_t *stack;
+    size_t used;
+};
+
+/* paints the stack below its own frame, calls fn, and measures how far
+ * down fn went */
+static void *stack_probe_run(void *arg)
+{
+    struct stack_probe *probe = (struct stack_probe *)arg;
+    volatile uint8_t top;
+    uint8_t *low;
+
+    /* a loop rather than memset(), whose frame would be in the way; the
+     * bytes just below top are this frame */
+    for (low = probe->stack; low < (uint8_t *)&top - STACK_FRAME; low++) {
+        *(volatile uint8_t *)low = STACK_PAINT;
+    }
+    probe->fn();
+    for (low = probe->stack; STACK_PAINT == *low; low++) {
+    }
+    probe->used = (uint8_t *)&top - low;
+
+    return NULL;
+}
+
+/* the bytes of stack fn uses, on a thread of its own */
+static size_t stack_used(void (*fn)(void))
+{
+    void *stack;
+    pthread_t thread;
+    pthread_attr_t attr;
+    struct stack_probe probe;
+
+    if (0 != posix_memalign(&stack, 4096, STACK_SIZE)) {
+        return 0;
+    }
+    probe.fn = fn;
+    probe.stack = (uint8_t *)stack;
+    probe.used = 0;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, stack, STACK_SIZE);
+    pthread_create(&thread, &attr, stack_probe_run, &probe);
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+    free(stack);
+
+    return probe.used;
+}
+
+static void test_bench(void)
+{
+    uint64_t start;
+    uint64_t fixed_ticks;
+    uint64_t printf_ticks;
+    size_t base;
+    size_t fixed_stack;
+    size_t printf_stack;
+
+    start = bench_ticks();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        format_fixed();
+    }
+    fixed_ticks = bench_ticks() - start;
+
+    start = bench_ticks();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        format_printf();
+    }
+    printf_ticks = bench_ticks() - start;
+
+    /* the call itself, with a function that does nothing */
+    base = stack_used(format_nothing);
+    fixed_stack = stack_used(format_fixed);
+    printf_stack = stack_used(format_printf);
+    CHECK(fixed_stack >= base && fixed_stack < printf_stack);
+
+    printf("bench: \"%%.1f\" of a float, fixed_format_float %.0f %s, "
+           "snprintf %.0f %s\n",
+           (double)fixed_ticks / BENCH_ROUNDS, BENCH_UNIT,
+           (double)printf_ticks / BENCH_ROUNDS, BENCH_UNIT);
+    printf("bench: stack high-water mark of a call, empty %u bytes, "
+           "fixed_format_float %u bytes, snprintf %u bytes\n",
+           (unsigned)base, (unsigned)fixed_stack, (unsigned)printf_stack);
+}
+
+int main()
+{
+    test_values();
+    test_bench();
+
+    return host_test_result("test_fixedfmt");
+}
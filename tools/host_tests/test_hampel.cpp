@@ -0,0 +1,197 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The streaming Hampel identifier against one that sorts the window for
+ * every sample, on noisy readings with spikes and repeated values, and the
+ * cost of both per sample.
+ */
+
+#include "host_test.h"
+#include "hampel.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+
+#define FILTER_K 3.0f
+#define FILTER_MIN_DEV 1.0f
+
+#define CHECK_SAMPLES 1000000
+
+#define BENCH_SAMPLES 4096
+#define BENCH_ROUNDS 500
+
+/* the window in arrival order, for the reference */
+struct window {
+    float val[HAMPEL_WINDOW];
+    int count;
+};
+
+static float median_of(float *v, int n)
+{
+    std::sort(v, v + n);
+    return (v[(n - 1) / 2] + v[n / 2]) / 2.0f;
+}
+
+/* the definition of the identifier, sorting copies of the window */
+static bool reference_add(struct window *w, float val)
+{
+    float tmp[HAMPEL_WINDOW];
+    float median;
+    float mad;
+    float dev;
+    bool outlier = false;
+
+    if (w->count >= HAMPEL_MIN_SAMPLES) {
+        std::copy(w->val, w->val + w->count, tmp);
+        median = median_of(tmp, w->count);
+        for (int i = 0; i < w->count; i++) {
+            tmp[i] = fabsf(w->val[i] - median);
+        }
+        mad = median_of(tmp, w->count);
+        dev = fabsf(val - median);
+        outlier = dev > FILTER_MIN_DEV && dev > FILTER_K * 1.4826f * mad;
+    }
+
+    if (HAMPEL_WINDOW == w->count) {
+        std::copy(w->val + 1, w->val + HAMPEL_WINDOW, w->val);
+        w->count--;
+    }
+    w->val[w->count++] = val;
+
+    return outlier;
+}
+
+/* readings around 50 with one in 20 a spike, and runs of equal values */
+static float next_sample(void)
+{
+    float val;
+
+    val = (rand() % 1000) / 10.0f;
+    if (0 == rand() % 20) {
+        val = rand() % 100000;
+    }
+    if (0 == rand() % 3) {
+        val = floorf(val / 10.0f);
+    }
+    return val;
+}
+
+static void test_reference(void)
+{
+    struct hampel h;
+    struct window w;
+    bool got;
+    bool want;
+    unsigned long mismatches = 0;
+    unsigned long outliers = 0;
+
+    hampel_reset(&h);
+    w.count = 0;
+    srand(1);
+    for (int i = 0; i < CHECK_SAMPLES; i++) {
+        float val = next_sample();
+
+        got = hampel_add(&h, val, FILTER_K, FILTER_MIN_DEV);
+        want = reference_add(&w, val);
+        if (got != want) {
+            mismatches++;
+        }
+        if (want) {
+            outliers++;
+        }
+    }
+
+    printf("reference: %d samples, %lu outliers, %lu mismatches\n",
+           CHECK_SAMPLES, outliers, mismatches);
+    CHECK(0 == mismatches);
+    CHECK(outliers > 0);
+}
+
+static void test_edges(void)
+{
+    struct hampel h;
+
+    hampel_reset(&h);
+    CHECK(0.0f == hampel_median(&h));
+
+    /* nothing is rejected before the window has enough samples */
+    CHECK(!hampel_add(&h, 20.0f, FILTER_K, FILTER_MIN_DEV));
+    CHECK(!hampel_add(&h, 20.0f, FILTER_K, FILTER_MIN_DEV));
+    CHECK(!hampel_add(&h, 20000.0f, FILTER_K, FILTER_MIN_DEV));
+
+    /* a steady signal with a MAD of 0 follows changes within min_dev */
+    hampel_reset(&h);
+    for (int i = 0; i < HAMPEL_WINDOW; i++) {
+        hampel_add(&h, 20.0f, FILTER_K, FILTER_MIN_DEV);
+    }
+    CHECK(!hampel_add(&h, 20.5f, FILTER_K, FILTER_MIN_DEV));
+    CHECK(hampel_add(&h, 0.0f, FILTER_K, FILTER_MIN_DEV));
+    CHECK(20.0f == hampel_median(&h));
+
+    /* NaN is rejected and kept out of the window */
+    CHECK(hampel_add(&h, NAN, FILTER_K, FILTER_MIN_DEV));
+    CHECK(20.0f == hampel_median(&h));
+}
+
+static void test_bench(void)
+{
+    static float samples[BENCH_SAMPLES];
+    struct hampel h;
+    struct window w;
+    uint64_t start;
+    uint64_t stream_ticks;
+    uint64_t sort_ticks;
+    volatile int sink = 0;
+
+    srand(2);
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        samples[i] = 400.0f + (rand() % 50) / 10.0f;
+    }
+
+    hampel_reset(&h);
+    start = bench_ticks();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < BENCH_SAMPLES; i++) {
+            sink += hampel_add(&h, samples[i], FILTER_K, FILTER_MIN_DEV);
+        }
+    }
+    stream_ticks = bench_ticks() - start;
+
+    w.count = 0;
+    start = bench_ticks();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < BENCH_SAMPLES; i++) {
+            sink += reference_add(&w, samples[i]);
+        }
+    }
+    sort_ticks = bench_ticks() - start;
+
+    printf("bench: window %d, hampel_add %.1f %s/sample, "
+           "sorting %.1f %s/sample\n", HAMPEL_WINDOW,
+           (double)stream_ticks / (BENCH_ROUNDS * BENCH_SAMPLES), BENCH_UNIT,
+           (double)sort_ticks / (BENCH_ROUNDS * BENCH_SAMPLES), BENCH_UNIT);
+}
+
+int main()
+{
+    test_reference();
+    test_edges();
+    test_bench();
+
+    return host_test_result("test_hampel");
+}
@@ -0,0 +1,244 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * SensorHistory against a log in build/history: values and timestamps come
+ * back from the varint and zigzag encoding unchanged, queries cover the
+ * ring, the log and the rotated log, and samples added while a flush
+ * writes the log aren't lost.  Reports the bytes per sample of a slowly
+ * changing sensor and the time of a query over a full log.
+ */
+
+#include "host_test.h"
+#include "history.h"
+
+#include <stdlib.h>
+
+#include <vector>
+
+/* samples of the slowly changing sensor, enough to rotate the log twice */
+#define BENCH_SAMPLES 300000
+#define BENCH_CHANNELS 3
+
+struct sample {
+    uint32_t time;
+    int32_t value;
+};
+
+static void collect(void *ctx, uint32_t time, int32_t value)
+{
+    struct sample s;
+
+    s.time = time;
+    s.value = value;
+    ((std::vector<struct sample> *)ctx)->push_back(s);
+}
+
+static std::vector<struct sample> query_all(SensorHistory &h,
+                                            uint8_t channel)
+{
+    std::vector<struct sample> out;
+
+    h.query(channel, 0, 0xFFFFFFFF, collect, &out);
+    return out;
+}
+
+static bool same(const std::vector<struct sample> &a, size_t first,
+                 const std::vector<struct sample> &b)
+{
+    if (a.size() - first != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < b.size(); i++) {
+        if (a[first + i].time != b[i].time ||
+            a[first + i].value != b[i].value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* every length of varint, and differences of both signs */
+static void test_roundtrip(void)
+{
+    static const int32_t values[] = {
+        0, 1, -1, 63, -64, 64, -65, 8191, -8192, 8192, 1 << 20,
+        -(1 << 20), 1 << 29, -(1 << 29), 0, 2150, 2151, 2149,
+    };
+    static const uint32_t deltas[] = {
+        0, 1, 127, 128, 16383, 16384, 0x1FFFFF, 0x200000, 0xFFFFFFF,
+        0x10000000, 1, 0, 1, 1, 2, 60, 1, 1,
+    };
+    std::vector<struct sample> in;
+    std::vector<struct sample> out;
+    struct sample s;
+    SensorHistory h;
+
+    CHECK(0 == h.init());
+    s.time = 0;
+    for (unsigned i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        s.time += deltas[i];
+        s.value = values[i];
+        in.push_back(s);
+        h.add(0, s.time, s.value);
+        h.add(1, s.time, -s.value);
+    }
+    CHECK(0 == h.flush());
+    CHECK(h.samples_saved() == 2 * in.size());
+
+    out = query_all(h, 0);
+    CHECK(same(in, 0, out));
+    out = query_all(h, 1);
+    CHECK(out.size() == in.size());
+    for (size_t i = 0; i < out.size() && i < in.size(); i++) {
+        CHECK(out[i].time == in[i].time && out[i].value == -in[i].value);
+    }
+}
+
+/* a time range over samples in the log and in the ring */
+static void test_query(void)
+{
+    std::vector<struct sample> out;
+    SensorHistory h;
+
+    CHECK(0 == h.init());
+    for (uint32_t t = 0; t < 100; t++) {
+        h.add(t % 2, t, (int32_t)t * 10);
+        if (49 == t) {
+            CHECK(0 == h.flush());
+        }
+    }
+
+    /* 25..74, the even ones, half of them still in the ring */
+    CHECK(25 == h.query(0, 25, 74, collect, &out));
+    CHECK(25 == out.size());
+    for (size_t i = 0; i < out.size(); i++) {
+        CHECK(out[i].time == 26 + 2 * i);
+        CHECK(out[i].value == (int32_t)out[i].time * 10);
+    }
+
+    out.clear();
+    CHECK(0 == h.query(2, 0, 0xFFFFFFFF, collect, &out));
+    CHECK(0 == h.query(0, 200, 300, collect, &out));
+}
+
+static SensorHistory *late_history;
+
+/* adds samples as if the sensors ran while the log was written */
+static void add_late(void)
+{
+    fake_mutex_unlock_hook() = NULL;
+    for (uint32_t t = 1000; t < 1010; t++) {
+        late_history->add(1, t, (int32_t)t);
+    }
+}
+
+/* with the ring full, samples added during a flush reach the next one */
+static void test_concurrent_add(void)
+{
+    std::vector<struct sample> in;
+    std::vector<struct sample> out;
+    struct sample s;
+    SensorHistory h;
+
+    CHECK(0 == h.init());
+    for (uint32_t t = 0; t < HISTORY_RAM_SAMPLES + 72; t++) {
+        h.add(1, t, (int32_t)t);
+        s.time = t;
+        s.value = t;
+        in.push_back(s);
+    }
+    for (uint32_t t = 1000; t < 1010; t++) {
+        s.time = t;
+        s.value = t;
+        in.push_back(s);
+    }
+
+    /* flush() releases the ring before it writes the log */
+    late_history = &h;
+    fake_mutex_unlock_hook() = add_late;
+    CHECK(0 == h.flush());
+    fake_mutex_unlock_hook() = NULL;
+
+    /* the oldest 72 were overwritten before the first flush */
+    out = query_all(h, 1);
+    CHECK(same(in, 72, out));
+
+    CHECK(0 == h.flush());
+    CHECK(h.samples_saved() == HISTORY_RAM_SAMPLES + 10);
+    out = query_all(h, 1);
+    CHECK(same(in, 72, out));
+}
+
+/* a random walk of a temperature in hundredths of a degree, sampled every
+ * few seconds, flushed as the firmware does; reports its cost on flash and
+ * the time of a query over all of it */
+static void test_rotation_bench(void)
+{
+    std::vector<struct sample> in[BENCH_CHANNELS];
+    std::vector<struct sample> out;
+    struct sample s;
+    int32_t value[BENCH_CHANNELS] = {2150, 4500, 30000};
+    uint32_t time = 0;
+    uint64_t start;
+    uint64_t ticks;
+    int n;
+    SensorHistory h;
+
+    CHECK(0 == h.init());
+    srand(1);
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        uint8_t ch = i % BENCH_CHANNELS;
+
+        if (0 == ch) {
+            time += 2 + rand() % 3;
+        }
+        value[ch] += rand() % 5 - 2;
+        s.time = time;
+        s.value = value[ch];
+        in[ch].push_back(s);
+        if (h.add(ch, time, value[ch])) {
+            CHECK(0 == h.flush());
+        }
+    }
+    CHECK(0 == h.flush());
+
+    /* the two newest logs, the older ones rotated away */
+    start = bench_ticks();
+    n = h.query(0, 0, 0xFFFFFFFF, collect, &out);
+    ticks = bench_ticks() - start;
+    CHECK(n == (int)out.size());
+    CHECK(out.size() > HISTORY_RAM_SAMPLES);
+    CHECK(out.size() < in[0].size());
+    CHECK(same(in[0], in[0].size() - out.size(), out));
+
+    printf("bench: %lu samples, %.2f bytes/sample on flash\n",
+           (unsigned long)h.samples_saved(),
+           (double)h.bytes_saved() / h.samples_saved());
+    printf("bench: query of %d samples from two logs of up to %u KiB, "
+           "%.0f %s, %.1f %s/sample\n", n, HISTORY_MAX_LOG_SIZE / 1024,
+           (double)ticks, BENCH_UNIT, (double)ticks / n, BENCH_UNIT);
+}
+
+int main()
+{
+    test_roundtrip();
+    test_query();
+    test_concurrent_add();
+    test_rotation_bench();
+
+    return host_test_result("test_history");
+}
@@ -0,0 +1,233 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The adaptive keep-alive on a simulated connection, checked as
+ * mbed_client_keep_alive() drives it: every check either finds recent
+ * traffic and waits, or sends an update.  A path drops the connection once
+ * it has been idle for its timeout, which the device only finds out on
+ * its next use, and then registers again.  Reports the updates per hour
+ * and the registrations of a day on paths with and without a timeout, and
+ * with and without traffic, against an update every quarter lifetime.
+ */
+
+#include "host_test.h"
+#include "keepalive.h"
+#include "mbed_cloud_client_user_config.h"
+
+#define LIFETIME_MS (MBED_CLOUD_CLIENT_LIFETIME * 1000)
+#define DAY_MS (24ULL * 3600 * 1000)
+
+struct path {
+    /* idle time the path drops the connection after, 0 for never */
+    uint32_t timeout_ms;
+    /* time between publications, 0 for none */
+    uint32_t traffic_ms;
+    uint64_t now;
+    uint64_t last_use;
+    uint64_t next_check;
+    uint64_t next_traffic;
+    uint32_t registrations;
+    uint32_t wakeups;
+};
+
+/* uses the connection, and registers again if the path dropped it */
+static void path_use(struct path *p, struct keepalive *k)
+{
+    uint32_t idle = p->now - p->last_use;
+
+    p->wakeups++;
+    p->last_use = p->now;
+    if (0 != p->timeout_ms && idle >= p->timeout_ms) {
+        keepalive_failed(k, idle);
+        keepalive_registered(k);
+        p->registrations++;
+    }
+}
+
+/* runs the keep-alive checks and the publications for duration ms */
+static void path_run(struct path *p, struct keepalive *k, uint64_t duration)
+{
+    uint64_t end = p->now + duration;
+    uint32_t idle;
+    uint32_t wait_ms;
+
+    for (;;) {
+        p->now = p->next_check < p->next_traffic ?
+                 p->next_check : p->next_traffic;
+        if (p->now >= end) {
+            p->now = end;
+            return;
+        }
+        if (p->now == p->next_traffic) {
+            path_use(p, k);
+            p->next_traffic += p->traffic_ms;
+        }
+        if (p->now == p->next_check) {
+            idle = p->now - p->last_use;
+            wait_ms = keepalive_due(k, idle);
+            if (0 == wait_ms) {
+                /* as the client, the update is recorded before it fails */
+                keepalive_sent(k, idle);
+                path_use(p, k);
+                wait_ms = k->interval_ms;
+            }
+            p->next_check = p->now + wait_ms;
+        }
+    }
+}
+
+static void path_init(struct path *p, struct keepalive *k,
+                      uint32_t timeout_ms, uint32_t traffic_ms)
+{
+    p->timeout_ms = timeout_ms;
+    p->traffic_ms = traffic_ms;
+    p->now = 0;
+    p->last_use = 0;
+    p->registrations = 1;
+    p->wakeups = 0;
+    keepalive_init(k, LIFETIME_MS);
+    keepalive_registered(k);
+    p->next_check = k->interval_ms;
+    p->next_traffic = 0 != traffic_ms ? traffic_ms : UINT64_MAX;
+}
+
+static void test_interval(void)
+{
+    struct keepalive k;
+
+    keepalive_init(&k, LIFETIME_MS);
+    CHECK(LIFETIME_MS / 4 == k.interval_ms);
+    CHECK(LIFETIME_MS / 8 == k.min_ms && LIFETIME_MS / 2 == k.max_ms);
+
+    /* recent traffic postpones the update */
+    CHECK(k.interval_ms - 1000 == keepalive_due(&k, 1000));
+    CHECK(1 == k.skipped);
+    CHECK(0 == keepalive_due(&k, k.interval_ms));
+
+    /* an update only grows the interval once the next one confirms it */
+    keepalive_sent(&k, k.interval_ms);
+    CHECK(LIFETIME_MS / 4 == k.interval_ms);
+    keepalive_sent(&k, k.interval_ms);
+    CHECK(LIFETIME_MS / 4 + LIFETIME_MS / 16 == k.interval_ms);
+    CHECK(LIFETIME_MS / 4 == k.survived_ms);
+
+    /* an update after a shorter idle time doesn't try the interval */
+    keepalive_sent(&k, 1000);
+    keepalive_sent(&k, 1000);
+    CHECK(LIFETIME_MS / 4 + LIFETIME_MS / 16 == k.interval_ms);
+
+    /* a break after an idle time that was survived is the link, not the
+     * path; nor is one shorter than the minimum */
+    keepalive_failed(&k, k.survived_ms);
+    keepalive_failed(&k, LIFETIME_MS / 8 - 1);
+    CHECK(0 == k.timeout_ms);
+    CHECK(LIFETIME_MS / 4 + LIFETIME_MS / 16 == k.interval_ms);
+    CHECK(2 == k.failures);
+
+    /* a break after a longer one halves the interval */
+    keepalive_failed(&k, k.survived_ms + 5000);
+    CHECK(k.survived_ms + 5000 == k.timeout_ms);
+    CHECK((LIFETIME_MS / 4 + LIFETIME_MS / 16) / 2 == k.interval_ms);
+
+    /* and never below the minimum */
+    keepalive_failed(&k, k.survived_ms + 1000);
+    keepalive_failed(&k, k.survived_ms + 1000);
+    CHECK(LIFETIME_MS / 8 == k.interval_ms);
+}
+
+static void test_paths(void)
+{
+    struct keepalive k;
+    struct path p;
+
+    /* an open path: up to half the lifetime, without a failure */
+    path_init(&p, &k, 0, 0);
+    path_run(&p, &k, DAY_MS);
+    CHECK(LIFETIME_MS / 2 == k.interval_ms);
+    CHECK(0 == k.failures && 1 == p.registrations);
+
+    /* a path that drops idle connections after 30 s: one break to learn
+     * it, and the interval stays below it from then on */
+    path_init(&p, &k, 30000, 0);
+    path_run(&p, &k, 3600 * 1000);
+    CHECK(1 == k.failures && 2 == p.registrations);
+    CHECK(0 != k.timeout_ms && k.timeout_ms >= 30000);
+    CHECK(k.interval_ms < 30000);
+    path_run(&p, &k, DAY_MS);
+    CHECK(1 == k.failures && 2 == p.registrations);
+
+    /* one shorter than the minimum interval can't be learnt, every update
+     * registers again */
+    path_init(&p, &k, LIFETIME_MS / 8 - 1000, 0);
+    path_run(&p, &k, 3600 * 1000);
+    CHECK(LIFETIME_MS / 8 == k.interval_ms);
+    CHECK(k.updates + 1 == p.registrations);
+
+    /* publications every 10 s keep the connection open, no updates */
+    path_init(&p, &k, 30000, 10000);
+    path_run(&p, &k, DAY_MS);
+    CHECK(0 == k.updates && 0 == k.failures && 1 == p.registrations);
+    CHECK(0 != k.skipped);
+}
+
+static void bench_path(const char *name, uint32_t timeout_ms,
+                       uint32_t traffic_ms)
+{
+    struct keepalive k;
+    struct path p;
+    struct path fixed;
+    uint32_t traffic = 0;
+
+    path_init(&p, &k, timeout_ms, traffic_ms);
+    path_run(&p, &k, DAY_MS);
+
+    /* an update every quarter lifetime, whatever the traffic */
+    path_init(&fixed, &k, timeout_ms, 0);
+    for (fixed.now = LIFETIME_MS / 4; fixed.now < DAY_MS;
+         fixed.now += LIFETIME_MS / 4) {
+        path_use(&fixed, &k);
+    }
+    /* the publications before the end of the day */
+    if (0 != traffic_ms) {
+        traffic = (DAY_MS - 1) / traffic_ms;
+    }
+
+    printf("bench: %s, keep-alive %lu updates/h %lu registrations, "
+           "fixed %lu updates/h %lu registrations\n", name,
+           (unsigned long)((p.wakeups - traffic) / 24),
+           (unsigned long)(p.registrations - 1),
+           (unsigned long)(fixed.wakeups / 24),
+           (unsigned long)(fixed.registrations - 1));
+}
+
+static void test_bench(void)
+{
+    bench_path("open path", 0, 0);
+    bench_path("30 s idle timeout", 30000, 0);
+    bench_path("20 s idle timeout", 20000, 0);
+    bench_path("publishing every 10 s", 30000, 10000);
+    bench_path("publishing every 60 s", 0, 60000);
+}
+
+int main()
+{
+    test_interval();
+    test_paths();
+    test_bench();
+
+    return host_test_result("test_keepalive");
+}
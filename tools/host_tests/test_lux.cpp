@@ -0,0 +1,162 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * TSL2591::calcLux() against the floating point formula it replaced, for
+ * every gain and integration time over the raw range, and the cost of
+ * both per sample.
+ */
+
+#include "host_test.h"
+#include "TSL2591.h"
+
+#include <stdlib.h>
+
+/* calcLux() may be off the float formula by this many lux */
+#define LUX_TOLERANCE 1
+
+/* the raw range is walked in these steps, plus its edges */
+#define FULL_STEP 37
+#define IR_STEP 11
+
+#define BENCH_SAMPLES 4096
+#define BENCH_ROUNDS 200
+
+static const float again[] = {1.0F, 25.0F, 428.0F, 9876.0F};
+
+/* the float formula calcLux() used before, negative results clamped */
+static uint32_t lux_float(int gain, int integ, uint16_t full, uint16_t ir)
+{
+    float atime, cpl, lux1, lux2, lux3;
+
+    atime = 100.0F * (integ + 1);
+    cpl = (atime * again[gain]) / TSL2591_LUX_DF;
+    lux1 = ((float)full - (TSL2591_LUX_COEFB * (float)ir)) / cpl;
+    lux2 = ((TSL2591_LUX_COEFC * (float)full) -
+            (TSL2591_LUX_COEFD * (float)ir)) / cpl;
+    lux3 = lux1 > lux2 ? lux1 : lux2;
+    return lux3 > 0.0F ? (uint32_t)lux3 : 0;
+}
+
+static uint32_t next_raw(uint32_t raw, uint32_t step)
+{
+    /* visit the largest valid count too */
+    if (raw < 0xFFFE && raw + step > 0xFFFE) {
+        return 0xFFFE;
+    }
+    return raw + step;
+}
+
+static void test_accuracy(I2C &i2c)
+{
+    uint32_t full;
+    uint32_t ir;
+    uint32_t ref;
+    long err;
+    long worst = 0;
+    unsigned long n = 0;
+    TSL2591 tsl(i2c);
+
+    for (int gain = TSL2591_GAIN_LOW; gain <= TSL2591_GAIN_MAX; gain++) {
+        tsl.setGain((tsl2591Gain_t)gain);
+        for (int integ = TSL2591_INTT_100MS; integ <= TSL2591_INTT_600MS;
+             integ++) {
+            tsl.setTime((tsl2591IntegrationTime_t)integ);
+            for (full = 0; full <= 0xFFFE; full = next_raw(full, FULL_STEP)) {
+                for (ir = 0; ir <= 0xFFFE; ir = next_raw(ir, IR_STEP)) {
+                    tsl.full = full;
+                    tsl.ir = ir;
+                    tsl.calcLux();
+                    ref = lux_float(gain, integ, full, ir);
+                    err = labs((long)tsl.lux - (long)ref);
+                    if (err > worst) {
+                        worst = err;
+                    }
+                    if (err > LUX_TOLERANCE) {
+                        printf("gain=%d integ=%d full=%lu ir=%lu: "
+                               "lux=%lu float=%lu\n", gain, integ,
+                               (unsigned long)full, (unsigned long)ir,
+                               (unsigned long)tsl.lux, (unsigned long)ref);
+                    }
+                    n++;
+                }
+            }
+        }
+    }
+
+    printf("accuracy: %lu samples, worst error %ld lux\n", n, worst);
+    CHECK(worst <= LUX_TOLERANCE);
+
+    /* a saturated channel leaves the last value alone */
+    tsl.lux = 1234;
+    tsl.full = 0xFFFF;
+    tsl.ir = 100;
+    tsl.calcLux();
+    CHECK(1234 == tsl.lux);
+}
+
+static void test_bench(I2C &i2c)
+{
+    static uint16_t full[BENCH_SAMPLES];
+    static uint16_t ir[BENCH_SAMPLES];
+    uint64_t start;
+    uint64_t fixed_ticks;
+    uint64_t float_ticks;
+    volatile uint32_t sink = 0;
+    TSL2591 tsl(i2c);
+
+    srand(1);
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        full[i] = rand() % 0xFFFF;
+        ir[i] = full[i] / 2 + rand() % (full[i] / 2 + 1);
+    }
+    tsl.setGain(TSL2591_GAIN_MED);
+    tsl.setTime(TSL2591_INTT_200MS);
+
+    start = bench_ticks();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < BENCH_SAMPLES; i++) {
+            tsl.full = full[i];
+            tsl.ir = ir[i];
+            tsl.calcLux();
+            sink += tsl.lux;
+        }
+    }
+    fixed_ticks = bench_ticks() - start;
+
+    start = bench_ticks();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < BENCH_SAMPLES; i++) {
+            sink += lux_float(TSL2591_GAIN_MED, TSL2591_INTT_200MS,
+                              full[i], ir[i]);
+        }
+    }
+    float_ticks = bench_ticks() - start;
+
+    printf("bench: calcLux %.1f %s/sample, float formula %.1f %s/sample\n",
+           (double)fixed_ticks / (BENCH_ROUNDS * BENCH_SAMPLES), BENCH_UNIT,
+           (double)float_ticks / (BENCH_ROUNDS * BENCH_SAMPLES), BENCH_UNIT);
+}
+
+int main()
+{
+    I2C i2c;
+
+    test_accuracy(i2c);
+    test_bench(i2c);
+
+    return host_test_result("test_lux");
+}
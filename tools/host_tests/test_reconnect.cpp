@@ -0,0 +1,241 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The retry schedule of the reconnect state machine: delays that double
+ * from the base to the cap with equal jitter, a backoff that starts over
+ * with each stage of recovery, and the outage and recovery counts.  Then
+ * a fleet of devices loses a shared access point, and the retries are
+ * replayed until it comes back.  Reports the time to recover and the
+ * largest burst of retries the access point sees, against the fixed 2 s
+ * retry loop the state machine replaced.
+ */
+
+#include "host_test.h"
+#include "reconnect.h"
+
+#define BASE_MS 1000
+#define MAX_MS 60000
+
+#define FLEET 1000
+/* the access point is away for 5 minutes */
+#define OUTAGE_MS (5 * 60 * 1000)
+#define FIXED_RETRY_MS 2000
+/* bursts are counted in windows of */
+#define BURST_MS 100
+
+static void test_schedule(void)
+{
+    struct reconnect r;
+    uint32_t delay;
+    uint32_t cap;
+    uint32_t low[8];
+    uint32_t high[8];
+
+    /* every delay in [d/2, d], d doubling from the base to the cap */
+    for (int i = 0; i < 8; i++) {
+        low[i] = 0xFFFFFFFF;
+        high[i] = 0;
+    }
+    for (uint32_t seed = 1; seed <= 1000; seed++) {
+        reconnect_init(&r, BASE_MS, MAX_MS, seed);
+        reconnect_net_down(&r, 0);
+        for (int i = 0; i < 40; i++) {
+            cap = i < 6 ? BASE_MS << i : MAX_MS;
+            delay = reconnect_delay(&r);
+            CHECK(delay >= cap / 2 && delay <= cap);
+            if (i < 8) {
+                low[i] = delay < low[i] ? delay : low[i];
+                high[i] = delay > high[i] ? delay : high[i];
+            }
+        }
+    }
+    /* and the jitter covers the range */
+    for (int i = 0; i < 8; i++) {
+        cap = i < 6 ? BASE_MS << i : MAX_MS;
+        CHECK(low[i] < cap / 2 + cap / 20 && high[i] > cap - cap / 20);
+    }
+
+    /* a zero seed still jitters */
+    reconnect_init(&r, BASE_MS, MAX_MS, 0);
+    CHECK(reconnect_delay(&r) != reconnect_delay(&r) ||
+          reconnect_delay(&r) != reconnect_delay(&r));
+
+    /* a cap below the base */
+    reconnect_init(&r, BASE_MS, BASE_MS / 2, 1);
+    CHECK(reconnect_delay(&r) <= BASE_MS / 2);
+}
+
+static void test_states(void)
+{
+    struct reconnect r;
+
+    reconnect_init(&r, BASE_MS, MAX_MS, 1);
+    CHECK(RECONNECT_NET_DOWN == r.state && !r.outage);
+
+    /* the first registration isn't a recovery */
+    reconnect_net_up(&r);
+    CHECK(RECONNECT_CLOUD_DOWN == r.state);
+    reconnect_cloud_up(&r, 500);
+    CHECK(RECONNECT_UP == r.state && 0 == r.recoveries);
+
+    /* the network goes, the backoff grows, and starts over when it comes
+     * back and the cloud has to be reached */
+    reconnect_net_down(&r, 1000);
+    CHECK(1 == r.net_outages && r.outage);
+    reconnect_delay(&r);
+    reconnect_delay(&r);
+    reconnect_delay(&r);
+    CHECK(3 == r.attempts);
+    reconnect_net_down(&r, 9000);
+    CHECK(1 == r.net_outages && 3 == r.attempts);
+    reconnect_net_up(&r);
+    CHECK(RECONNECT_CLOUD_DOWN == r.state && 0 == r.attempts);
+    CHECK(reconnect_delay(&r) <= BASE_MS);
+
+    /* the cloud failing within the same outage isn't another one */
+    reconnect_cloud_down(&r, 12000);
+    CHECK(0 == r.cloud_outages && 1 == r.attempts);
+    reconnect_cloud_up(&r, 21000);
+    CHECK(RECONNECT_UP == r.state && !r.outage);
+    CHECK(1 == r.recoveries && 20000 == r.last_recover_ms);
+
+    /* a cloud outage, then the network goes too */
+    reconnect_cloud_down(&r, 30000);
+    CHECK(1 == r.cloud_outages && RECONNECT_CLOUD_DOWN == r.state);
+    reconnect_delay(&r);
+    reconnect_net_down(&r, 31000);
+    CHECK(1 == r.net_outages && 0 == r.attempts);
+    reconnect_net_up(&r);
+    reconnect_cloud_up(&r, 70000);
+    CHECK(2 == r.recoveries && 40000 == r.last_recover_ms);
+    CHECK(40000 == r.max_recover_ms);
+    CHECK(30000 == reconnect_mean_recover_ms(&r));
+}
+
+struct fleet_result {
+    uint32_t mean_recover_ms;
+    uint32_t max_recover_ms;
+    uint32_t retries;
+    uint32_t burst;
+};
+
+/* retries in each BURST_MS window after the access point comes back */
+static uint16_t bursts[(OUTAGE_MS + 2 * MAX_MS) / BURST_MS];
+
+static void fleet_note(struct fleet_result *res, uint32_t t)
+{
+    res->retries++;
+    if (t >= OUTAGE_MS && (t - OUTAGE_MS) / BURST_MS < sizeof(bursts) /
+        sizeof(bursts[0])) {
+        bursts[(t - OUTAGE_MS) / BURST_MS]++;
+    }
+}
+
+static void fleet_burst(struct fleet_result *res)
+{
+    res->burst = 0;
+    for (size_t i = 0; i < sizeof(bursts) / sizeof(bursts[0]); i++) {
+        if (bursts[i] > res->burst) {
+            res->burst = bursts[i];
+        }
+        bursts[i] = 0;
+    }
+}
+
+/* every device retries on its own schedule until the access point is back,
+ * and registers on its first retry after that */
+static void fleet_backoff(struct fleet_result *res)
+{
+    struct reconnect r;
+    uint64_t total = 0;
+    uint32_t t;
+
+    res->max_recover_ms = 0;
+    res->retries = 0;
+    for (uint32_t dev = 0; dev < FLEET; dev++) {
+        reconnect_init(&r, BASE_MS, MAX_MS, dev * 2654435761U);
+        reconnect_net_down(&r, 0);
+        t = 0;
+        do {
+            t += reconnect_delay(&r);
+            fleet_note(res, t);
+        } while (t < OUTAGE_MS);
+        reconnect_net_up(&r);
+        reconnect_cloud_up(&r, t);
+        total += t - OUTAGE_MS;
+        if (t - OUTAGE_MS > res->max_recover_ms) {
+            res->max_recover_ms = t - OUTAGE_MS;
+        }
+    }
+    res->mean_recover_ms = total / FLEET;
+    fleet_burst(res);
+}
+
+/* the devices lost the access point together, and retry in step */
+static void fleet_fixed(struct fleet_result *res)
+{
+    uint32_t t;
+
+    res->retries = 0;
+    for (uint32_t dev = 0; dev < FLEET; dev++) {
+        for (t = FIXED_RETRY_MS; t < OUTAGE_MS + FIXED_RETRY_MS;
+             t += FIXED_RETRY_MS) {
+            fleet_note(res, t);
+        }
+    }
+    /* by the first retry after it is back, all at the same time */
+    res->mean_recover_ms = FIXED_RETRY_MS / 2;
+    res->max_recover_ms = FIXED_RETRY_MS;
+    fleet_burst(res);
+}
+
+static void test_fleet(void)
+{
+    struct fleet_result backoff;
+    struct fleet_result fixed;
+
+    fleet_backoff(&backoff);
+    fleet_fixed(&fixed);
+
+    /* nobody waits more than one capped retry once it is back */
+    CHECK(backoff.max_recover_ms <= MAX_MS);
+    CHECK(backoff.burst < FLEET / 10);
+    CHECK(backoff.retries < fixed.retries / 10);
+    CHECK(FLEET == fixed.burst);
+
+    printf("bench: %d devices, %u s outage, backoff recovers in %lu ms "
+           "mean %lu ms max, %lu retries each, largest burst %lu in "
+           "%d ms\n", FLEET, OUTAGE_MS / 1000,
+           (unsigned long)backoff.mean_recover_ms,
+           (unsigned long)backoff.max_recover_ms,
+           (unsigned long)(backoff.retries / FLEET),
+           (unsigned long)backoff.burst, BURST_MS);
+    printf("bench: fixed %d ms retries recover within %lu ms, %lu retries "
+           "each, largest burst %lu\n", FIXED_RETRY_MS,
+           (unsigned long)fixed.max_recover_ms,
+           (unsigned long)(fixed.retries / FLEET),
+           (unsigned long)fixed.burst);
+}
+
+int main()
+{
+    test_schedule();
+    test_states();
+    test_fleet();
+
+    return host_test_result("test_reconnect");
+}
@@ -0,0 +1,273 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The resources M2MClient builds from its schema table against the
+ * hand-built ones it replaced.  The hand-built client created the same
+ * objects, one add_*() function per object, and kept every resource in a
+ * std::map keyed by URI, which it scanned to find a resource by
+ * M2MClientResource.  That map is rebuilt here from the client's
+ * resources.  Reports the time and heap of init() and of the map, and the
+ * time of the lookups by enum, by URI and by pointer with both.
+ */
+
+#include "host_test.h"
+#include "m2mclient.h"
+
+#include <stdlib.h>
+
+#include <map>
+#include <new>
+#include <string>
+
+#define BENCH_ROUNDS 2000
+
+static size_t heap_allocs;
+static size_t heap_bytes;
+
+void *operator new(size_t size) throw(std::bad_alloc)
+{
+    void *p = malloc(0 == size ? 1 : size);
+
+    if (NULL == p) {
+        throw std::bad_alloc();
+    }
+    heap_allocs++;
+    heap_bytes += size;
+    return p;
+}
+
+/* the warning takes this delete for the default one */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *p) throw()
+{
+    free(p);
+}
+#pragma GCC diagnostic pop
+
+/* as the map of the hand-built client */
+struct resource_entry {
+    M2MResource *res;
+    enum M2MClient::M2MClientResource type;
+};
+
+typedef std::map<std::string, struct resource_entry> resource_map;
+
+static void map_build(resource_map &map, M2MClient &client)
+{
+    M2MResource *res;
+
+    for (int i = 0; i < M2MClient::M2MClientResourceCount; i++) {
+        res = client.get_resource((enum M2MClient::M2MClientResource)i);
+        if (NULL != res) {
+            struct resource_entry entry = {
+                res, (enum M2MClient::M2MClientResource)i
+            };
+            map[res->uri_path()] = entry;
+        }
+    }
+}
+
+/* get_resource_entry(enum) of the hand-built client */
+static M2MResource *map_find_enum(resource_map &map,
+                                  enum M2MClient::M2MClientResource type)
+{
+    resource_map::iterator it;
+
+    for (it = map.begin(); it != map.end(); ++it) {
+        if (type == it->second.type) {
+            return it->second.res;
+        }
+    }
+    return NULL;
+}
+
+static M2MResource *map_find_uri(resource_map &map, const char *uri_path)
+{
+    resource_map::iterator it;
+
+    it = map.find(uri_path);
+    return it == map.end() ? NULL : it->second.res;
+}
+
+/* value_updated() of the hand-built client looked the URI up */
+static int map_find_base(resource_map &map, M2MBase *base)
+{
+    resource_map::iterator it;
+
+    it = map.find(base->uri_path());
+    return it == map.end() ? -1 : it->second.type;
+}
+
+static int array_find_base(M2MClient &client, M2MBase *base)
+{
+    for (int i = 0; i < M2MClient::M2MClientResourceCount; i++) {
+        if (base == client.get_resource((enum M2MClient::M2MClientResource)i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void test_lookups(void)
+{
+    M2MClient client;
+    M2MResource *res;
+    resource_map map;
+    unsigned resources = 0;
+
+    CHECK(0 == client.init());
+    map_build(map, client);
+
+    /* the table gives every resource its own URI, and both find it */
+    for (int i = 0; i < M2MClient::M2MClientResourceCount; i++) {
+        enum M2MClient::M2MClientResource type =
+            (enum M2MClient::M2MClientResource)i;
+
+        res = client.get_resource(type);
+        if (NULL == res) {
+            continue;
+        }
+        resources++;
+        CHECK(res == map_find_enum(map, type));
+        CHECK(res == map_find_uri(map, res->uri_path()));
+        CHECK(res == client.get_resource(res->uri_path()));
+        CHECK(i == map_find_base(map, res));
+        CHECK(i == array_find_base(client, res));
+    }
+    CHECK(resources == map.size());
+    CHECK(NULL == client.get_resource("3301/0/9999"));
+    CHECK(NULL == map_find_uri(map, "3301/0/9999"));
+}
+
+static void test_bench(void)
+{
+    size_t allocs;
+    size_t bytes;
+    size_t map_allocs;
+    size_t map_bytes;
+    uint64_t start;
+    uint64_t init_ticks;
+    uint64_t map_ticks;
+    uint64_t ticks[6];
+    unsigned found = 0;
+    M2MResource *res[M2MClient::M2MClientResourceCount];
+    int n = 0;
+    M2MClient client;
+    resource_map map;
+
+    allocs = heap_allocs;
+    bytes = heap_bytes;
+    start = bench_ticks();
+    CHECK(0 == client.init());
+    init_ticks = bench_ticks() - start;
+    allocs = heap_allocs - allocs;
+    bytes = heap_bytes - bytes;
+
+    map_allocs = heap_allocs;
+    map_bytes = heap_bytes;
+    start = bench_ticks();
+    map_build(map, client);
+    map_ticks = bench_ticks() - start;
+    map_allocs = heap_allocs - map_allocs;
+    map_bytes = heap_bytes - map_bytes;
+
+    for (int i = 0; i < M2MClient::M2MClientResourceCount; i++) {
+        res[n] = client.get_resource((enum M2MClient::M2MClientResource)i);
+        if (NULL != res[n]) {
+            n++;
+        }
+    }
+
+    start = bench_ticks();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < M2MClient::M2MClientResourceCount; i++) {
+            found += NULL != client.get_resource(
+                (enum M2MClient::M2MClientResource)i);
+        }
+    }
+    ticks[0] = bench_ticks() - start;
+    start = bench_ticks();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < M2MClient::M2MClientResourceCount; i++) {
+            found += NULL != map_find_enum(
+                map, (enum M2MClient::M2MClientResource)i);
+        }
+    }
+    ticks[1] = bench_ticks() - start;
+
+    start = bench_ticks();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < n; i++) {
+            found += NULL != client.get_resource(res[i]->uri_path());
+        }
+    }
+    ticks[2] = bench_ticks() - start;
+    start = bench_ticks();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < n; i++) {
+            found += NULL != map_find_uri(map, res[i]->uri_path());
+        }
+    }
+    ticks[3] = bench_ticks() - start;
+
+    start = bench_ticks();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < n; i++) {
+            found += 0 <= array_find_base(client, res[i]);
+        }
+    }
+    ticks[4] = bench_ticks() - start;
+    start = bench_ticks();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (int i = 0; i < n; i++) {
+            found += 0 <= map_find_base(map, res[i]);
+        }
+    }
+    ticks[5] = bench_ticks() - start;
+
+    CHECK(found == 6U * BENCH_ROUNDS * n);
+
+    printf("bench: %d resources, init %.0f %s with %lu allocations of "
+           "%lu bytes\n", n, (double)init_ticks, BENCH_UNIT,
+           (unsigned long)allocs, (unsigned long)bytes);
+    printf("bench: table index %lu bytes; the hand-built map %.0f %s, "
+           "%lu allocations of %lu bytes\n",
+           (unsigned long)(M2MClient::M2MClientResourceCount *
+                           sizeof(M2MResource *)),
+           (double)map_ticks, BENCH_UNIT, (unsigned long)map_allocs,
+           (unsigned long)map_bytes);
+    printf("bench: lookup by enum %.1f %s, map scan %.1f %s\n",
+           (double)ticks[0] / BENCH_ROUNDS / M2MClient::M2MClientResourceCount,
+           BENCH_UNIT,
+           (double)ticks[1] / BENCH_ROUNDS / M2MClient::M2MClientResourceCount,
+           BENCH_UNIT);
+    printf("bench: lookup by URI %.1f %s, map %.1f %s\n",
+           (double)ticks[2] / BENCH_ROUNDS / n, BENCH_UNIT,
+           (double)ticks[3] / BENCH_ROUNDS / n, BENCH_UNIT);
+    printf("bench: value_updated() lookup %.1f %s, map %.1f %s\n",
+           (double)ticks[4] / BENCH_ROUNDS / n, BENCH_UNIT,
+           (double)ticks[5] / BENCH_ROUNDS / n, BENCH_UNIT);
+}
+
+int main()
+{
+    test_lookups();
+    test_bench();
+
+    return host_test_result("test_resources");
+}
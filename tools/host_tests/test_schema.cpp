@@ -0,0 +1,115 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * M2MClient registers every object of its schema once, with all of its
+ * resources, against a fake of the cloud client, and how long building
+ * and registering the objects takes.
+ */
+
+#include "host_test.h"
+#include "m2mclient.h"
+
+#define BENCH_ROUNDS 20
+
+/* returns how many times obj is in the registered objects */
+static int registered_count(const M2MObject *obj)
+{
+    int n = 0;
+
+    for (size_t i = 0; i < fake_cloud_objects.size(); i++) {
+        if (fake_cloud_objects[i] == obj) {
+            n++;
+        }
+    }
+    return n;
+}
+
+static void test_registration(void)
+{
+    M2MClient client;
+    M2MResource *res;
+    M2MObject *obj;
+    unsigned resources = 0;
+
+    CHECK(0 == client.init());
+    CHECK(client.call_register(NULL));
+    CHECK(!fake_cloud_objects.empty());
+
+    /* no object is listed twice, by pointer or by name */
+    for (size_t i = 0; i < fake_cloud_objects.size(); i++) {
+        for (size_t j = 0; j < i; j++) {
+            if (fake_cloud_objects[i] == fake_cloud_objects[j] ||
+                0 == strcmp(fake_cloud_objects[i]->name(),
+                            fake_cloud_objects[j]->name())) {
+                printf("object %s listed twice\n",
+                       fake_cloud_objects[i]->name());
+                CHECK(false);
+            }
+        }
+    }
+
+    /* and every resource goes out with the object it belongs to */
+    for (int i = 0; i < M2MClient::M2MClientResourceCount; i++) {
+        res = client.get_resource((enum M2MClient::M2MClientResource)i);
+        if (NULL == res) {
+            continue;
+        }
+        resources++;
+        obj = &res->get_parent_object_instance().get_parent_object();
+        if (1 != registered_count(obj)) {
+            printf("%s: object listed %d times\n", res->uri_path(),
+                   registered_count(obj));
+            CHECK(false);
+        }
+        CHECK(res == client.get_resource(res->uri_path()));
+    }
+
+    printf("registration: %lu objects, %u resources, %lu byte link format\n",
+           (unsigned long)fake_cloud_objects.size(), resources,
+           (unsigned long)client.registration_size());
+    CHECK(resources == client.registration_resources());
+}
+
+static void test_bench(void)
+{
+    uint64_t start;
+    uint64_t ticks;
+
+    start = bench_ticks();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        M2MClient client;
+
+        client.init();
+        client.call_register(NULL);
+    }
+    ticks = bench_ticks() - start;
+
+    printf("bench: init and register %.0f %s\n",
+           (double)ticks / BENCH_ROUNDS, BENCH_UNIT);
+}
+
+int main()
+{
+    test_registration();
+    test_bench();
+
+#if MBED_CONF_APP_SOUND_ENABLED
+    return host_test_result("test_schema_full");
+#else
+    return host_test_result("test_schema");
+#endif
+}
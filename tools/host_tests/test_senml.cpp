@@ -0,0 +1,277 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The SenML-CBOR writer against the examples of RFC 8949 appendix A, and a
+ * pack of the light, temperature and humidity channels laid out as
+ * sensors_write_pack() writes it.  Reports the bytes on the wire and the
+ * encode time of the pack against the per-resource strings it replaced,
+ * "412 lux", "23.4 C" and "41%", each sent in its own notification.
+ */
+
+#include "host_test.h"
+#include "senml.h"
+
+#include <math.h>
+#include <string.h>
+
+#define BENCH_ROUNDS 100000
+
+/* a CoAP notification without its payload: the 4 byte header, a 4 byte
+ * token, the Observe and Content-Format options and the payload marker;
+ * the (D)TLS record around it is left out */
+#define COAP_NOTIFY_OVERHEAD 13
+
+#define BASE_NAME "urn:dev:mac:0002f7f0c0de:"
+
+struct channel {
+    const char *path;
+    const char *unit;
+    float value;
+    int32_t age;
+};
+
+static const struct channel channels[] = {
+    {"3301/0/5700", "lx", 412.0f, 0},
+    {"3303/0/5700", "Cel", 23.4f, 3},
+    {"3304/0/5700", "%RH", 41.0f, 3},
+};
+
+#define CHANNELS ((int)(sizeof(channels) / sizeof(channels[0])))
+
+static bool written(void (*write)(struct senml_writer *, int32_t),
+                    int32_t val, const char *hex)
+{
+    uint8_t buf[16];
+    char out[40];
+    struct senml_writer w;
+
+    senml_writer_init(&w, buf, sizeof(buf));
+    write(&w, val);
+    for (size_t i = 0; i < w.len; i++) {
+        sprintf(&out[2 * i], "%02x", buf[i]);
+    }
+    out[2 * w.len] = '\0';
+    return 0 == strcmp(out, hex);
+}
+
+static void write_int(struct senml_writer *w, int32_t val)
+{
+    senml_write_int(w, val);
+}
+
+/* the float is passed as its bits, to share written() */
+static void write_number(struct senml_writer *w, int32_t bits)
+{
+    float val;
+
+    memcpy(&val, &bits, sizeof(val));
+    senml_write_number(w, val);
+}
+
+static int32_t float_bits(float val)
+{
+    int32_t bits;
+
+    memcpy(&bits, &val, sizeof(bits));
+    return bits;
+}
+
+static void test_items(void)
+{
+    uint8_t buf[8];
+    struct senml_writer w;
+
+    CHECK(written(write_int, 0, "00"));
+    CHECK(written(write_int, 23, "17"));
+    CHECK(written(write_int, 24, "1818"));
+    CHECK(written(write_int, 255, "18ff"));
+    CHECK(written(write_int, 256, "190100"));
+    CHECK(written(write_int, 1000000, "1a000f4240"));
+    CHECK(written(write_int, -1, "20"));
+    CHECK(written(write_int, -100, "3863"));
+    CHECK(written(write_int, -1000, "3903e7"));
+    CHECK(written(write_int, INT32_MIN, "3a7fffffff"));
+
+    /* integral values go out as integers */
+    CHECK(written(write_number, float_bits(41.0f), "1829"));
+    CHECK(written(write_number, float_bits(-3.0f), "22"));
+    CHECK(written(write_number, float_bits(100000.0f), "1a000186a0"));
+    CHECK(written(write_number, float_bits(0.5f), "fa3f000000"));
+    CHECK(written(write_number, float_bits(23.4f), "fa41bb3333"));
+    CHECK(written(write_number, float_bits(3.0e9f), "fa4f32d05e"));
+
+    /* "IETF", then a write that doesn't fit */
+    senml_writer_init(&w, buf, sizeof(buf));
+    senml_write_text(&w, "IETF");
+    CHECK(5 == w.len && 0 == memcmp(buf, "\x64IETF", 5));
+    CHECK(!w.overflow);
+    senml_write_text(&w, "IETF");
+    CHECK(w.overflow);
+    CHECK(w.len <= sizeof(buf));
+}
+
+/* as sensors_write_pack() */
+static size_t write_pack(uint8_t *buf, size_t size)
+{
+    struct senml_writer w;
+
+    senml_writer_init(&w, buf, size);
+    senml_write_array(&w, CHANNELS);
+    for (int i = 0; i < CHANNELS; i++) {
+        senml_write_map(&w, 3 + (0 == i ? 2 : 0) +
+                        (0 != channels[i].age ? 1 : 0));
+        if (0 == i) {
+            senml_write_int(&w, SENML_LABEL_BASE_NAME);
+            senml_write_text(&w, BASE_NAME);
+            senml_write_int(&w, SENML_LABEL_BASE_TIME);
+            senml_write_int(&w, 0);
+        }
+        senml_write_int(&w, SENML_LABEL_NAME);
+        senml_write_text(&w, channels[i].path);
+        senml_write_int(&w, SENML_LABEL_UNIT);
+        senml_write_text(&w, channels[i].unit);
+        senml_write_int(&w, SENML_LABEL_VALUE);
+        senml_write_number(&w, channels[i].value);
+        if (0 != channels[i].age) {
+            senml_write_int(&w, SENML_LABEL_TIME);
+            senml_write_int(&w, -channels[i].age);
+        }
+    }
+
+    return w.overflow ? 0 : w.len;
+}
+
+/* the end of the well-formed item at p, or NULL */
+static const uint8_t *cbor_skip(const uint8_t *p, const uint8_t *end)
+{
+    uint8_t type;
+    uint8_t info;
+    uint32_t val = 0;
+    size_t len;
+
+    if (p >= end) {
+        return NULL;
+    }
+    type = *p >> 5;
+    info = *p++ & 0x1F;
+    if (7 == type) {
+        return 26 == info && end - p >= 4 ? p + 4 : NULL;
+    }
+    if (info < 24) {
+        val = info;
+    } else if (info <= 26) {
+        len = 1 << (info - 24);
+        if ((size_t)(end - p) < len) {
+            return NULL;
+        }
+        while (len--) {
+            val = val << 8 | *p++;
+        }
+    } else {
+        return NULL;
+    }
+
+    switch (type) {
+        case 0:
+        case 1:
+            return p;
+        case 3:
+            return (size_t)(end - p) >= val ? p + val : NULL;
+        case 4:
+        case 5:
+            for (uint32_t i = 0; p && i < (4 == type ? val : 2 * val); i++) {
+                p = cbor_skip(p, end);
+            }
+            return p;
+        default:
+            return NULL;
+    }
+}
+
+static void test_pack(void)
+{
+    uint8_t pack[256];
+    size_t len;
+
+    len = write_pack(pack, sizeof(pack));
+    CHECK(104 == len);
+    CHECK(pack + len == cbor_skip(pack, pack + len));
+    CHECK(0x83 == pack[0] && 0xA5 == pack[1] && 0x21 == pack[2]);
+    CHECK(NULL != memmem(pack, len, "\x02\xfa\x41\xbb\x33\x33\x06\x22", 8));
+
+    /* a pack that doesn't fit is reported as such */
+    CHECK(0 == write_pack(pack, 103));
+    CHECK(104 == write_pack(pack, 104));
+}
+
+/* the strings of the light, temperature and humidity resources before the
+ * pack, with float printf */
+static size_t write_strings(char (*buf)[33])
+{
+    size_t len;
+
+    len = snprintf(buf[0], sizeof(buf[0]), "%u lux",
+                   (unsigned)lroundf(channels[0].value));
+    len += snprintf(buf[1], sizeof(buf[1]), "%.1f C", channels[1].value);
+    len += snprintf(buf[2], sizeof(buf[2]), "%.0f%%", channels[2].value);
+    return len;
+}
+
+static void test_bench(void)
+{
+    uint8_t pack[256];
+    char strings[CHANNELS][33];
+    size_t pack_len = 0;
+    size_t strings_len = 0;
+    uint64_t start;
+    uint64_t pack_ticks;
+    uint64_t strings_ticks;
+
+    start = bench_ticks();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        pack_len += write_pack(pack, sizeof(pack));
+    }
+    pack_ticks = bench_ticks() - start;
+
+    start = bench_ticks();
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        strings_len += write_strings(strings);
+    }
+    strings_ticks = bench_ticks() - start;
+
+    CHECK(0 == strcmp(strings[1], "23.4 C"));
+    pack_len /= BENCH_ROUNDS;
+    strings_len /= BENCH_ROUNDS;
+
+    printf("bench: %d channels, pack %u bytes in 1 notification, %u with "
+           "CoAP; strings %u bytes in %d, %u with CoAP\n", CHANNELS,
+           (unsigned)pack_len, (unsigned)(pack_len + COAP_NOTIFY_OVERHEAD),
+           (unsigned)strings_len, CHANNELS,
+           (unsigned)(strings_len + CHANNELS * COAP_NOTIFY_OVERHEAD));
+    printf("bench: encode pack %.0f %s, strings %.0f %s\n",
+           (double)pack_ticks / BENCH_ROUNDS, BENCH_UNIT,
+           (double)strings_ticks / BENCH_ROUNDS, BENCH_UNIT);
+}
+
+int main()
+{
+    test_items();
+    test_pack();
+    test_bench();
+
+    return host_test_result("test_senml");
+}
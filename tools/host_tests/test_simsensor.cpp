@@ -0,0 +1,328 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The simulated sensors and a replay of them, as "sim replay" runs on the
+ * device.  Traces in build/sim hold and loop their rows as documented, and
+ * a trace or the waveforms give the same readings at the same times.  The
+ * replay feeds the readings through the board independent stages of the
+ * pipeline: calibration with the default tables, the outlier filter, the
+ * deadband, fixed-point formatting and the SenML pack.  It reports the
+ * throughput and the time of each stage.
+ */
+
+#include "host_test.h"
+#include "simsensor.h"
+#include "calibration.h"
+#include "fixedfmt.h"
+#include "hampel.h"
+#include "senml.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define TRACE_DIR FS_MOUNT_POINT "/sim"
+
+#define REPLAY_SAMPLES 1000000
+#define REPLAY_STEP_MS 1000
+#define REPLAY_FILTER_K 3.0f
+/* rows of the replayed trace, one a second */
+#define REPLAY_TRACE_ROWS 3600
+
+enum STAGES {
+    STAGE_SOURCE = 0,
+    STAGE_CALIBRATE,
+    STAGE_UPDATE,
+    STAGE_PACK,
+    STAGE_COUNT
+};
+
+/* the default calibration and precision of each channel, see main.cpp */
+static const struct {
+    const char *path;
+    const char *unit;
+    const char *cal;
+    int precision;
+} channels[SIM_VALUE_COUNT] = {
+    {"3301/0/5700", "lx", "3.7", 0},
+    {"3303/0/5700", "Cel", "0.68", 1},
+    {"3304/0/5700", "%RH", "1.9", 0},
+};
+
+static void write_file(const char *path, const char *text)
+{
+    FILE *fp = fopen(path, "w");
+
+    CHECK(NULL != fp);
+    if (NULL != fp) {
+        fputs(text, fp);
+        fclose(fp);
+    }
+}
+
+static bool read_is(struct sim_source *src, uint32_t time_ms, float lux,
+                    float temp, float humidity)
+{
+    float values[SIM_VALUE_COUNT];
+
+    sim_read(src, time_ms, values);
+    return values[SIM_VALUE_LUX] == lux && values[SIM_VALUE_TEMP] == temp &&
+           values[SIM_VALUE_HUMIDITY] == humidity;
+}
+
+static void test_trace(void)
+{
+    struct sim_source src;
+
+    mkdir(TRACE_DIR, 0755);
+    write_file(TRACE_DIR "/trace.csv",
+               "time_ms,lux,temp,humidity\n"
+               "1000,10,20.5,30\n"
+               "1500,11,21.5,31\n"
+               "2000,1,2\n"
+               "2500,12,22.5,32\n");
+
+    /* rows are held until the next one, the malformed one is skipped */
+    CHECK(0 == sim_open(&src, TRACE_DIR "/trace.csv"));
+    CHECK(read_is(&src, 0, 10, 20.5f, 30));
+    CHECK(read_is(&src, 499, 10, 20.5f, 30));
+    CHECK(read_is(&src, 500, 11, 21.5f, 31));
+    CHECK(read_is(&src, 1499, 11, 21.5f, 31));
+    CHECK(read_is(&src, 1500, 12, 22.5f, 32));
+
+    /* the last row is held as long as the gap before it, then it loops */
+    CHECK(read_is(&src, 2499, 12, 22.5f, 32));
+    CHECK(read_is(&src, 2500, 10, 20.5f, 30));
+    CHECK(read_is(&src, 3000, 11, 21.5f, 31));
+
+    /* a jump skips whole passes */
+    CHECK(read_is(&src, 2500 * 40 + 1500, 12, 22.5f, 32));
+    sim_close(&src);
+
+    /* a single row is held forever */
+    write_file(TRACE_DIR "/single.csv", "5,1,2,3\n");
+    CHECK(0 == sim_open(&src, TRACE_DIR "/single.csv"));
+    CHECK(read_is(&src, 0, 1, 2, 3));
+    CHECK(read_is(&src, 0xFFFFFFF0UL, 1, 2, 3));
+    sim_close(&src);
+
+    write_file(TRACE_DIR "/empty.csv", "time_ms,lux,temp,humidity\n");
+    CHECK(0 != sim_open(&src, TRACE_DIR "/empty.csv"));
+    CHECK(0 != sim_open(&src, TRACE_DIR "/missing.csv"));
+}
+
+static void test_waveforms(void)
+{
+    float a[SIM_VALUE_COUNT];
+    float b[SIM_VALUE_COUNT];
+    struct sim_source one;
+    struct sim_source two;
+
+    CHECK(0 == sim_open(&one, NULL));
+    CHECK(0 == sim_open(&two, NULL));
+    for (uint32_t t = 0; t < 3600000; t += 997) {
+        sim_read(&one, t, a);
+        sim_read(&two, t, b);
+        CHECK(0 == memcmp(a, b, sizeof(a)));
+        if (0 != memcmp(a, b, sizeof(a))) {
+            break;
+        }
+        CHECK(a[SIM_VALUE_LUX] >= 13.0f && a[SIM_VALUE_LUX] <= 207.0f);
+        CHECK(a[SIM_VALUE_TEMP] >= 29.9f && a[SIM_VALUE_TEMP] <= 36.1f);
+        CHECK(a[SIM_VALUE_HUMIDITY] >= 15.7f &&
+              a[SIM_VALUE_HUMIDITY] <= 26.3f);
+    }
+}
+
+/* an hour of a random walk, at the scale of raw readings */
+static void write_replay_trace(const char *path)
+{
+    float v[SIM_VALUE_COUNT] = {110.0f, 33.0f, 21.0f};
+    FILE *fp = fopen(path, "w");
+
+    CHECK(NULL != fp);
+    if (NULL == fp) {
+        return;
+    }
+    srand(1);
+    fputs("time_ms,lux,temp,humidity\n", fp);
+    for (int i = 0; i < REPLAY_TRACE_ROWS; i++) {
+        v[SIM_VALUE_LUX] += (rand() % 201 - 100) / 100.0f;
+        v[SIM_VALUE_TEMP] += (rand() % 201 - 100) / 2000.0f;
+        v[SIM_VALUE_HUMIDITY] += (rand() % 201 - 100) / 500.0f;
+        fprintf(fp, "%d,%.2f,%.3f,%.2f\n", i * 1000, v[SIM_VALUE_LUX],
+                v[SIM_VALUE_TEMP], v[SIM_VALUE_HUMIDITY]);
+    }
+    fclose(fp);
+}
+
+struct replay_channel {
+    struct calibration cal;
+    struct hampel filter;
+    float reported;
+    bool has_reported;
+    uint32_t sent;
+    uint32_t suppressed;
+    uint32_t rejected;
+    char str[FIXED_STRLEN];
+};
+
+/* as sensors_write_pack(), all channels and without their ages */
+static size_t replay_pack(struct replay_channel *rc, uint8_t *pack,
+                          size_t size)
+{
+    struct senml_writer w;
+
+    senml_writer_init(&w, pack, size);
+    senml_write_array(&w, SIM_VALUE_COUNT);
+    for (int i = 0; i < SIM_VALUE_COUNT; i++) {
+        senml_write_map(&w, 0 == i ? 5 : 3);
+        if (0 == i) {
+            senml_write_int(&w, SENML_LABEL_BASE_NAME);
+            senml_write_text(&w, "urn:dev:mac:0002f7f0c0de:");
+            senml_write_int(&w, SENML_LABEL_BASE_TIME);
+            senml_write_int(&w, 0);
+        }
+        senml_write_int(&w, SENML_LABEL_NAME);
+        senml_write_text(&w, channels[i].path);
+        senml_write_int(&w, SENML_LABEL_UNIT);
+        senml_write_text(&w, channels[i].unit);
+        senml_write_int(&w, SENML_LABEL_VALUE);
+        senml_write_number(&w, rc[i].reported);
+    }
+
+    return w.overflow ? 0 : w.len;
+}
+
+static void replay(const char *name, const char *path)
+{
+    uint64_t t[STAGE_COUNT + 1];
+    uint64_t stages[STAGE_COUNT] = {0};
+    uint64_t total;
+    double secs;
+    struct timespec start;
+    struct timespec end;
+    uint32_t packs = 0;
+    uint32_t sent = 0;
+    uint32_t suppressed = 0;
+    uint32_t rejected = 0;
+    float values[SIM_VALUE_COUNT];
+    float min_change;
+    bool changed;
+    uint8_t pack[256];
+    struct replay_channel rc[SIM_VALUE_COUNT];
+    struct sim_source src;
+
+    CHECK(0 == sim_open(&src, path));
+    for (int i = 0; i < SIM_VALUE_COUNT; i++) {
+        CHECK(0 == calibration_parse(&rc[i].cal, channels[i].cal));
+        hampel_reset(&rc[i].filter);
+        rc[i].has_reported = false;
+        rc[i].sent = 0;
+        rc[i].suppressed = 0;
+        rc[i].rejected = 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t n = 0; n < REPLAY_SAMPLES; n++) {
+        t[STAGE_SOURCE] = bench_ticks();
+        sim_read(&src, n * REPLAY_STEP_MS, values);
+
+        t[STAGE_CALIBRATE] = bench_ticks();
+        for (int i = 0; i < SIM_VALUE_COUNT; i++) {
+            values[i] = calibration_apply(&rc[i].cal, values[i]);
+        }
+
+        /* the filter, the deadband of one unit of the last digit and the
+         * string of the resource */
+        t[STAGE_UPDATE] = bench_ticks();
+        changed = false;
+        for (int i = 0; i < SIM_VALUE_COUNT; i++) {
+            min_change = 1.0f / fixed_scale(channels[i].precision);
+            if (hampel_add(&rc[i].filter, values[i], REPLAY_FILTER_K,
+                           min_change)) {
+                rc[i].rejected++;
+                continue;
+            }
+            if (rc[i].has_reported &&
+                fabsf(values[i] - rc[i].reported) < min_change) {
+                rc[i].suppressed++;
+                continue;
+            }
+            rc[i].reported = values[i];
+            rc[i].has_reported = true;
+            rc[i].sent++;
+            fixed_format_float(rc[i].str, sizeof(rc[i].str), values[i],
+                               channels[i].precision);
+            changed = true;
+        }
+
+        t[STAGE_PACK] = bench_ticks();
+        if (changed && rc[0].has_reported && rc[1].has_reported &&
+            rc[2].has_reported) {
+            CHECK(0 != replay_pack(rc, pack, sizeof(pack)));
+            packs++;
+        }
+
+        t[STAGE_COUNT] = bench_ticks();
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            stages[i] += t[i + 1] - t[i];
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sim_close(&src);
+
+    secs = end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) / 1e9;
+    total = 0;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        total += stages[i];
+    }
+    for (int i = 0; i < SIM_VALUE_COUNT; i++) {
+        sent += rc[i].sent;
+        suppressed += rc[i].suppressed;
+        rejected += rc[i].rejected;
+    }
+    CHECK(sent + suppressed + rejected == REPLAY_SAMPLES * SIM_VALUE_COUNT);
+    CHECK(packs > 0);
+
+    printf("bench: %s, %u samples of %lu s in %.0f ms, %.0f readings/s, "
+           "%.0f %s/sample\n", name, REPLAY_SAMPLES,
+           (unsigned long)((uint64_t)REPLAY_SAMPLES * REPLAY_STEP_MS / 1000),
+           secs * 1000, REPLAY_SAMPLES * SIM_VALUE_COUNT / secs,
+           (double)total / REPLAY_SAMPLES, BENCH_UNIT);
+    printf("bench: %s, reported %lu suppressed %lu rejected %lu, %lu packs\n",
+           name, (unsigned long)sent, (unsigned long)suppressed,
+           (unsigned long)rejected, (unsigned long)packs);
+    printf("bench: %s, source %.0f calibrate %.0f update %.0f pack %.0f "
+           "%s/sample\n", name,
+           (double)stages[STAGE_SOURCE] / REPLAY_SAMPLES,
+           (double)stages[STAGE_CALIBRATE] / REPLAY_SAMPLES,
+           (double)stages[STAGE_UPDATE] / REPLAY_SAMPLES,
+           (double)stages[STAGE_PACK] / REPLAY_SAMPLES, BENCH_UNIT);
+}
+
+int main()
+{
+    test_trace();
+    test_waveforms();
+    replay("waveforms", NULL);
+    write_replay_trace(TRACE_DIR "/replay.csv");
+    replay("trace", TRACE_DIR "/replay.csv");
+
+    return host_test_result("test_simsensor");
+}
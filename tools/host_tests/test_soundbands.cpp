@@ -0,0 +1,151 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The octave band levels of tones, and the cost of the fixed-point FFT
+ * per frame and the memory it needs.
+ */
+
+#include "host_test.h"
+#include "soundbands.h"
+#include "soundlevel.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/* a second of frames */
+#define TONE_FRAMES (SOUND_SAMPLE_RATE / SOUND_FFT_SIZE)
+
+#define TONE_AMPLITUDE 32000.0f
+
+/* error of the level of a tone in its own band, in hundredths of a dB */
+#define BAND_TOLERANCE_CDB 10
+
+/* how far below a tone the bands that don't touch its band must be */
+#define BAND_REJECTION_CDB 4000
+
+#define BENCH_FRAMES 10000
+
+/*
+ * a tone in every band, on a bin so the window spreads it over three bins.
+ * the 63 Hz band is the single bin at 62.5 Hz, and the 4 kHz band ends at
+ * the Nyquist frequency.
+ */
+static const float band_tone_hz[SOUND_BANDS] = {
+    62.5f, 125.0f, 250.0f, 500.0f, 1000.0f, 2000.0f, 3500.0f
+};
+
+/* fills a frame with a sine of the given amplitude, phase in cycles */
+static void fill_tone(int16_t *pcm, float hz, float amplitude, double *phase)
+{
+    for (int i = 0; i < SOUND_FFT_SIZE; i++) {
+        pcm[i] = (int16_t)lrintf(amplitude * sinf(2.0f * (float)M_PI * *phase));
+        *phase += hz / SOUND_SAMPLE_RATE;
+        *phase -= floor(*phase);
+    }
+}
+
+static void test_tones(void)
+{
+    int16_t pcm[SOUND_FFT_SIZE];
+    int32_t cdb[SOUND_BANDS];
+    long expected;
+    double phase;
+    struct sound_bands b;
+
+    expected = lrint(2000.0 * log10(TONE_AMPLITUDE / 32767.0));
+    for (int band = 0; band < SOUND_BANDS; band++) {
+        sound_bands_reset(&b);
+        phase = 0.0;
+        for (int i = 0; i < TONE_FRAMES; i++) {
+            fill_tone(pcm, band_tone_hz[band], TONE_AMPLITUDE, &phase);
+            sound_bands_add(&b, pcm);
+        }
+        sound_bands_take(&b, cdb);
+
+        printf("%6.1f Hz:", band_tone_hz[band]);
+        for (int i = 0; i < SOUND_BANDS; i++) {
+            printf(" %6ld", (long)cdb[i]);
+        }
+        printf(" cdB\n");
+
+        /* the 63 Hz band misses the two bins the window spreads into */
+        if (0 == band) {
+            CHECK(cdb[0] < expected && cdb[0] > expected - 200);
+        } else {
+            CHECK(labs(cdb[band] - expected) <= BAND_TOLERANCE_CDB);
+        }
+        for (int i = 0; i < SOUND_BANDS; i++) {
+            if (i != band) {
+                CHECK(cdb[i] < cdb[band]);
+            }
+            if (abs(i - band) > 1) {
+                CHECK(cdb[i] <= cdb[band] - BAND_REJECTION_CDB);
+            }
+        }
+    }
+
+    /* taking the levels starts over */
+    sound_bands_take(&b, cdb);
+    for (int i = 0; i < SOUND_BANDS; i++) {
+        CHECK(SOUND_LEVEL_MIN_CDB == cdb[i]);
+    }
+}
+
+static void test_bench(void)
+{
+    static int16_t pcm[4][SOUND_FFT_SIZE];
+    double phase = 0.0;
+    uint64_t start;
+    uint64_t add_ticks;
+    uint64_t take_ticks;
+    int32_t cdb[SOUND_BANDS];
+    struct sound_bands b;
+
+    srand(1);
+    for (int i = 0; i < 4; i++) {
+        fill_tone(pcm[i], 440.0f * (i + 1), 8000.0f, &phase);
+        for (int j = 0; j < SOUND_FFT_SIZE; j++) {
+            pcm[i][j] += rand() % 2001 - 1000;
+        }
+    }
+
+    sound_bands_reset(&b);
+    start = bench_ticks();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        sound_bands_add(&b, pcm[i % 4]);
+    }
+    add_ticks = bench_ticks() - start;
+
+    start = bench_ticks();
+    sound_bands_take(&b, cdb);
+    take_ticks = bench_ticks() - start;
+
+    printf("bench: %d-point frames, sound_bands_add %.0f %s/frame, "
+           "sound_bands_take %lu %s\n", SOUND_FFT_SIZE,
+           (double)add_ticks / BENCH_FRAMES, BENCH_UNIT,
+           (unsigned long)take_ticks, BENCH_UNIT);
+    printf("memory: %lu bytes of state per channel\n",
+           (unsigned long)sizeof(struct sound_bands));
+}
+
+int main()
+{
+    test_tones();
+    test_bench();
+
+    return host_test_result("test_soundbands");
+}
@@ -0,0 +1,223 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * The fixed-point sound level against the A-weighting curve for tones,
+ * and its cost per sample over PCM blocks.  A recording, 16-bit little
+ * endian mono PCM at 8 kHz, can be given to benchmark instead of the
+ * generated tones:
+ *
+ *     build/test_soundlevel recording.raw
+ */
+
+#include "host_test.h"
+#include "soundlevel.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/* the size of the blocks the microphone driver hands over */
+#define BLOCK_SAMPLES 256
+
+/* one second of settling, then one second measured */
+#define TONE_BLOCKS (SOUND_SAMPLE_RATE / BLOCK_SAMPLES)
+
+/* the response the header promises up to 3.9 kHz, in hundredths of a dB */
+#define A_TOLERANCE_CDB 80
+
+/* error of the flat level of a tone, in hundredths of a dB */
+#define FLAT_TOLERANCE_CDB 5
+
+#define BENCH_SECONDS 60
+
+/* IEC 61672 A-weighting, in hundredths of a dB */
+static const struct {
+    float hz;
+    int32_t a_cdb;
+} tones[] = {
+    {63.0f, -2620},
+    {125.0f, -1610},
+    {250.0f, -860},
+    {500.0f, -320},
+    {1000.0f, 0},
+    {2000.0f, 120},
+    {3150.0f, 120},
+};
+
+/* returns the level of a sine relative to full scale, in hundredths of a dB */
+static long full_scale_cdb(float amplitude)
+{
+    return lrint(2000.0 * log10(amplitude / 32767.0));
+}
+
+/* fills a block with a sine of the given amplitude, phase in cycles */
+static void fill_tone(int16_t *pcm, float hz, float amplitude, double *phase)
+{
+    for (int i = 0; i < BLOCK_SAMPLES; i++) {
+        pcm[i] = (int16_t)lrintf(amplitude * sinf(2.0f * (float)M_PI * *phase));
+        *phase += hz / SOUND_SAMPLE_RATE;
+        *phase -= floor(*phase);
+    }
+}
+
+/* returns the flat and A-weighted levels of a tone */
+static void tone_level(float hz, float amplitude, int32_t *z_cdb,
+                       int32_t *a_cdb)
+{
+    int16_t pcm[BLOCK_SAMPLES];
+    double phase = 0.0;
+    struct sound_level l;
+
+    sound_level_reset(&l);
+    for (int i = 0; i < 2 * TONE_BLOCKS; i++) {
+        if (TONE_BLOCKS == i) {
+            sound_level_restart(&l);
+        }
+        fill_tone(pcm, hz, amplitude, &phase);
+        sound_level_add(&l, pcm, BLOCK_SAMPLES);
+    }
+    sound_level_take(&l, z_cdb, a_cdb);
+}
+
+static void test_weighting(void)
+{
+    int32_t z_cdb;
+    int32_t a_cdb;
+
+    for (unsigned i = 0; i < sizeof(tones) / sizeof(tones[0]); i++) {
+        tone_level(tones[i].hz, 32000.0f, &z_cdb, &a_cdb);
+        printf("%6.0f Hz: flat %ld cdB, A %ld cdB, curve %ld cdB\n",
+               tones[i].hz, (long)z_cdb, (long)a_cdb, (long)tones[i].a_cdb);
+        CHECK(labs(z_cdb - full_scale_cdb(32000.0f)) <= FLAT_TOLERANCE_CDB);
+        CHECK(labs(a_cdb - z_cdb - tones[i].a_cdb) <= A_TOLERANCE_CDB);
+    }
+
+    /* the flat level follows the amplitude over 40 dB, below that the
+     * rounding of the test tone to whole samples shows */
+    for (float amplitude = 16000.0f; amplitude >= 100.0f; amplitude /= 10.0f) {
+        tone_level(1000.0f, amplitude, &z_cdb, &a_cdb);
+        CHECK(labs(z_cdb - full_scale_cdb(amplitude)) <= FLAT_TOLERANCE_CDB);
+        CHECK(labs(a_cdb - z_cdb) <= A_TOLERANCE_CDB);
+    }
+}
+
+static void test_interval(void)
+{
+    int16_t pcm[BLOCK_SAMPLES];
+    double phase = 0.0;
+    int32_t z1, a1, z2, a2;
+    struct sound_level l;
+
+    sound_level_reset(&l);
+    sound_level_get(&l, &z1, &a1);
+    CHECK(SOUND_LEVEL_MIN_CDB == z1);
+    CHECK(SOUND_LEVEL_MIN_CDB == a1);
+
+    /* reading the level leaves the interval running */
+    fill_tone(pcm, 1000.0f, 10000.0f, &phase);
+    sound_level_add(&l, pcm, BLOCK_SAMPLES);
+    sound_level_get(&l, &z1, &a1);
+    sound_level_take(&l, &z2, &a2);
+    CHECK(z1 == z2);
+    CHECK(a1 == a2);
+
+    sound_level_get(&l, &z1, &a1);
+    CHECK(SOUND_LEVEL_MIN_CDB == z1);
+    CHECK(SOUND_LEVEL_MIN_CDB == a1);
+}
+
+/* returns a recording, or a minute of noise and tones, and its length */
+static int16_t *bench_pcm(const char *path, size_t *samples)
+{
+    FILE *fp;
+    long size;
+    int16_t *pcm;
+    double phase = 0.0;
+
+    if (NULL != path) {
+        fp = fopen(path, "rb");
+        if (NULL == fp) {
+            return NULL;
+        }
+        fseek(fp, 0, SEEK_END);
+        size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        *samples = size / 2 / BLOCK_SAMPLES * BLOCK_SAMPLES;
+        pcm = (int16_t *)malloc(*samples * 2);
+        if (NULL != pcm && fread(pcm, 2, *samples, fp) != *samples) {
+            free(pcm);
+            pcm = NULL;
+        }
+        fclose(fp);
+        return pcm;
+    }
+
+    *samples = BENCH_SECONDS * SOUND_SAMPLE_RATE / BLOCK_SAMPLES *
+               BLOCK_SAMPLES;
+    pcm = (int16_t *)malloc(*samples * 2);
+    if (NULL == pcm) {
+        return NULL;
+    }
+    srand(1);
+    for (size_t i = 0; i < *samples; i += BLOCK_SAMPLES) {
+        fill_tone(&pcm[i], 100.0f + (i / SOUND_SAMPLE_RATE) * 50.0f, 8000.0f,
+                  &phase);
+        for (int j = 0; j < BLOCK_SAMPLES; j++) {
+            pcm[i + j] += rand() % 2001 - 1000;
+        }
+    }
+    return pcm;
+}
+
+static void test_bench(const char *path)
+{
+    int16_t *pcm;
+    size_t samples;
+    uint64_t start;
+    uint64_t ticks;
+    int32_t z_cdb;
+    int32_t a_cdb;
+    struct sound_level l;
+
+    pcm = bench_pcm(path, &samples);
+    CHECK(NULL != pcm && samples > 0);
+    if (NULL == pcm || 0 == samples) {
+        return;
+    }
+
+    sound_level_reset(&l);
+    start = bench_ticks();
+    for (size_t i = 0; i < samples; i += BLOCK_SAMPLES) {
+        sound_level_add(&l, &pcm[i], BLOCK_SAMPLES);
+    }
+    ticks = bench_ticks() - start;
+    sound_level_take(&l, &z_cdb, &a_cdb);
+
+    printf("bench: %lu samples, flat %ld cdB, A %ld cdB, "
+           "%.1f %s/sample, %.0f %s/block\n", (unsigned long)samples,
+           (long)z_cdb, (long)a_cdb, (double)ticks / samples, BENCH_UNIT,
+           (double)ticks * BLOCK_SAMPLES / samples, BENCH_UNIT);
+    free(pcm);
+}
+
+int main(int argc, char *argv[])
+{
+    test_weighting();
+    test_interval();
+    test_bench(argc > 1 ? argv[1] : NULL);
+
+    return host_test_result("test_soundlevel");
+}
@@ -0,0 +1,383 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * TLS session resumption by tls_session.cpp, on the mbed TLS of mbed-os
+ * with the configuration of the firmware.  The client connects to a
+ * stand-in server, built on the same mbed TLS, over an in-memory
+ * connection, and sets up a new TLS context for every connection as the
+ * PAL does.  Both sides authenticate with ECDSA P-256 certificates and use
+ * the ECDHE-ECDSA suites of MBEDTLS_SSL_CIPHERSUITES.  The handshakes go
+ * through __wrap_mbedtls_ssl_handshake() as on the device.
+ *
+ * Checks that the second connection resumes the session of the first, by
+ * ticket and by session id, that a server that keeps no sessions gets a
+ * full handshake, and that a session isn't offered to another host.
+ * Reports the client's time and the round trips of full and resumed
+ * handshakes.
+ */
+
+#include "host_test.h"
+#include "tls_session.h"
+
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/ecp.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/ssl_cache.h>
+#include <mbedtls/ssl_ticket.h>
+#include <mbedtls/x509_crt.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_ROUNDS 20
+
+#define SERVER_NAME "wem-stand-in"
+
+/* one direction of the connection */
+struct pipe {
+    unsigned char buf[8192];
+    size_t head;
+    size_t tail;
+    /* bytes ever written */
+    size_t total;
+};
+
+/* the end of the connection one side has */
+struct link {
+    struct pipe *out;
+    struct pipe *in;
+};
+
+struct peer {
+    mbedtls_pk_context key;
+    mbedtls_x509_crt cert;
+};
+
+struct handshake {
+    int ret;
+    /* the client's share, as on the device */
+    uint64_t client_ticks;
+    unsigned round_trips;
+};
+
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context drbg;
+static struct peer server;
+static struct peer device;
+
+static int urandom_poll(void *data, unsigned char *out, size_t len,
+                        size_t *olen)
+{
+    FILE *f = (FILE *)data;
+
+    *olen = fread(out, 1, len, f);
+    return 0 == *olen ? MBEDTLS_ERR_ENTROPY_SOURCE_FAILED : 0;
+}
+
+static int link_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    struct pipe *p = ((struct link *)ctx)->out;
+
+    if (p->tail + len > sizeof(p->buf)) {
+        memmove(p->buf, p->buf + p->head, p->tail - p->head);
+        p->tail -= p->head;
+        p->head = 0;
+    }
+    if (p->tail + len > sizeof(p->buf)) {
+        len = sizeof(p->buf) - p->tail;
+    }
+    if (0 == len) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    memcpy(p->buf + p->tail, buf, len);
+    p->tail += len;
+    p->total += len;
+    return len;
+}
+
+static int link_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    struct pipe *p = ((struct link *)ctx)->in;
+
+    if (p->head == p->tail) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    if (len > p->tail - p->head) {
+        len = p->tail - p->head;
+    }
+    memcpy(buf, p->buf + p->head, len);
+    p->head += len;
+    return len;
+}
+
+/* a P-256 key and a certificate for it, signed by itself */
+static bool peer_init(struct peer *peer, const char *name)
+{
+    unsigned char der[1024];
+    mbedtls_x509write_cert crt;
+    mbedtls_mpi serial;
+    int len;
+    bool ok;
+
+    mbedtls_pk_init(&peer->key);
+    mbedtls_x509_crt_init(&peer->cert);
+    if (0 != mbedtls_pk_setup(&peer->key,
+                              mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY)) ||
+        0 != mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1,
+                                 mbedtls_pk_ec(peer->key),
+                                 mbedtls_ctr_drbg_random, &drbg)) {
+        return false;
+    }
+
+    mbedtls_x509write_crt_init(&crt);
+    mbedtls_mpi_init(&serial);
+    mbedtls_mpi_lset(&serial, 1);
+    mbedtls_x509write_crt_set_version(&crt, MBEDTLS_X509_CRT_VERSION_3);
+    mbedtls_x509write_crt_set_md_alg(&crt, MBEDTLS_MD_SHA256);
+    mbedtls_x509write_crt_set_subject_key(&crt, &peer->key);
+    mbedtls_x509write_crt_set_issuer_key(&crt, &peer->key);
+    mbedtls_x509write_crt_set_serial(&crt, &serial);
+    ok = 0 == mbedtls_x509write_crt_set_subject_name(&crt, name) &&
+         0 == mbedtls_x509write_crt_set_issuer_name(&crt, name) &&
+         0 == mbedtls_x509write_crt_set_validity(&crt, "20180101000000",
+                                                 "20491231235959");
+    /* written at the end of the buffer */
+    len = ok ? mbedtls_x509write_crt_der(&crt, der, sizeof(der),
+                                         mbedtls_ctr_drbg_random, &drbg) : 0;
+    ok = len > 0 && 0 == mbedtls_x509_crt_parse_der(&peer->cert,
+                                                    der + sizeof(der) - len,
+                                                    len);
+    mbedtls_mpi_free(&serial);
+    mbedtls_x509write_crt_free(&crt);
+    return ok;
+}
+
+static void conf_init(mbedtls_ssl_config *conf, int endpoint,
+                      struct peer *own, struct peer *other)
+{
+    mbedtls_ssl_config_init(conf);
+    mbedtls_ssl_config_defaults(conf, endpoint, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                MBEDTLS_SSL_PRESET_DEFAULT);
+    mbedtls_ssl_conf_rng(conf, mbedtls_ctr_drbg_random, &drbg);
+    mbedtls_ssl_conf_authmode(conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(conf, &other->cert, NULL);
+    mbedtls_ssl_conf_own_cert(conf, &own->cert, &own->key);
+}
+
+/* one connection, until both sides completed the handshake */
+static void tls_connect(mbedtls_ssl_config *client_conf,
+                        mbedtls_ssl_config *server_conf, const char *host,
+                        struct handshake *hs)
+{
+    static struct pipe up;
+    static struct pipe down;
+    struct link client_link = {&up, &down};
+    struct link server_link = {&down, &up};
+    mbedtls_ssl_context client;
+    mbedtls_ssl_context srv;
+    bool client_done = false;
+    bool server_done = false;
+    size_t sent = 0;
+    uint64_t start;
+    int ret;
+
+    memset(&up, 0, sizeof(up));
+    memset(&down, 0, sizeof(down));
+    memset(hs, 0, sizeof(*hs));
+
+    mbedtls_ssl_init(&client);
+    mbedtls_ssl_init(&srv);
+    mbedtls_ssl_setup(&client, client_conf);
+    mbedtls_ssl_setup(&srv, server_conf);
+    mbedtls_ssl_set_hostname(&client, host);
+    mbedtls_ssl_set_bio(&client, &client_link, link_send, link_recv, NULL);
+    mbedtls_ssl_set_bio(&srv, &server_link, link_send, link_recv, NULL);
+
+    for (int i = 0; i < 100 && !(client_done && server_done); i++) {
+        if (!client_done) {
+            start = bench_ticks();
+            ret = mbedtls_ssl_handshake(&client);
+            hs->client_ticks += bench_ticks() - start;
+            if (0 == ret) {
+                client_done = true;
+            } else if (MBEDTLS_ERR_SSL_WANT_READ != ret) {
+                hs->ret = ret;
+                break;
+            } else if (sent != up.total) {
+                /* waits for the answer to what it just sent */
+                sent = up.total;
+                hs->round_trips++;
+            }
+        }
+        if (!server_done) {
+            ret = mbedtls_ssl_handshake(&srv);
+            if (0 == ret) {
+                server_done = true;
+            } else if (MBEDTLS_ERR_SSL_WANT_READ != ret) {
+                hs->ret = ret;
+                break;
+            }
+        }
+    }
+    if (0 == hs->ret && !(client_done && server_done)) {
+        hs->ret = -1;
+    }
+
+    mbedtls_ssl_free(&client);
+    mbedtls_ssl_free(&srv);
+}
+
+static int compare_ticks(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* the median client time and the round trips of BENCH_ROUNDS connections
+ * after a first, full one; returns the number resumed */
+static uint32_t connect_rounds(mbedtls_ssl_config *client_conf,
+                               mbedtls_ssl_config *server_conf,
+                               uint64_t *first_ticks, uint64_t *ticks,
+                               unsigned *first_trips, unsigned *trips)
+{
+    uint64_t t[BENCH_ROUNDS];
+    uint32_t resumed = tls_session_get_stats()->resumed;
+    struct handshake hs;
+
+    tls_connect(client_conf, server_conf, SERVER_NAME, &hs);
+    CHECK(0 == hs.ret);
+    *first_ticks = hs.client_ticks;
+    *first_trips = hs.round_trips;
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        tls_connect(client_conf, server_conf, SERVER_NAME, &hs);
+        CHECK(0 == hs.ret);
+        t[i] = hs.client_ticks;
+        *trips = hs.round_trips;
+    }
+    qsort(t, BENCH_ROUNDS, sizeof(t[0]), compare_ticks);
+    *ticks = t[BENCH_ROUNDS / 2];
+
+    return tls_session_get_stats()->resumed - resumed;
+}
+
+static void test_resume(void)
+{
+    mbedtls_ssl_config client_conf;
+    mbedtls_ssl_config server_conf;
+    mbedtls_ssl_config plain_conf;
+    mbedtls_ssl_cache_context cache;
+    mbedtls_ssl_ticket_context ticket;
+    struct tls_session_stats before;
+    struct handshake hs;
+    uint64_t full_ticks;
+    uint64_t ticks;
+    unsigned full_trips;
+    unsigned trips;
+
+    conf_init(&client_conf, MBEDTLS_SSL_IS_CLIENT, &device, &server);
+
+    /* a server that keeps sessions, by ticket and by id */
+    conf_init(&server_conf, MBEDTLS_SSL_IS_SERVER, &server, &device);
+    mbedtls_ssl_cache_init(&cache);
+    mbedtls_ssl_conf_session_cache(&server_conf, &cache,
+                                   mbedtls_ssl_cache_get,
+                                   mbedtls_ssl_cache_set);
+    mbedtls_ssl_ticket_init(&ticket);
+    CHECK(0 == mbedtls_ssl_ticket_setup(&ticket, mbedtls_ctr_drbg_random,
+                                        &drbg, MBEDTLS_CIPHER_AES_256_GCM,
+                                        86400));
+    mbedtls_ssl_conf_session_tickets_cb(&server_conf, mbedtls_ssl_ticket_write,
+                                        mbedtls_ssl_ticket_parse, &ticket);
+
+    /* and one that doesn't */
+    conf_init(&plain_conf, MBEDTLS_SSL_IS_SERVER, &server, &device);
+
+    /* by ticket */
+    CHECK(BENCH_ROUNDS == connect_rounds(&client_conf, &server_conf,
+                                         &full_ticks, &ticks, &full_trips,
+                                         &trips));
+    CHECK(2 == full_trips && 1 == trips);
+    printf("bench: by ticket, full handshake %.0f k%s in %u round trips, "
+           "resumed %.0f k%s in %u\n", (double)full_ticks / 1000,
+           BENCH_UNIT, full_trips, (double)ticks / 1000, BENCH_UNIT, trips);
+
+    /* by session id, starting over with a server that hasn't seen the
+     * device */
+    mbedtls_ssl_cache_free(&cache);
+    mbedtls_ssl_cache_init(&cache);
+    mbedtls_ssl_conf_session_tickets(&client_conf,
+                                     MBEDTLS_SSL_SESSION_TICKETS_DISABLED);
+    CHECK(BENCH_ROUNDS == connect_rounds(&client_conf, &server_conf,
+                                         &full_ticks, &ticks, &full_trips,
+                                         &trips));
+    CHECK(2 == full_trips && 1 == trips);
+    printf("bench: by session id, full handshake %.0f k%s in %u round "
+           "trips, resumed %.0f k%s in %u\n", (double)full_ticks / 1000,
+           BENCH_UNIT, full_trips, (double)ticks / 1000, BENCH_UNIT, trips);
+    mbedtls_ssl_conf_session_tickets(&client_conf,
+                                     MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+
+    /* a server that declines gets full handshakes, and nothing fails */
+    before = *tls_session_get_stats();
+    CHECK(0 == connect_rounds(&client_conf, &plain_conf, &full_ticks,
+                              &ticks, &full_trips, &trips));
+    CHECK(2 == trips);
+    CHECK(before.full + BENCH_ROUNDS + 1 == tls_session_get_stats()->full);
+    CHECK(before.failed == tls_session_get_stats()->failed);
+    printf("bench: server without sessions, full handshake %.0f k%s in %u "
+           "round trips\n", (double)ticks / 1000, BENCH_UNIT, trips);
+
+    /* the session isn't offered to another host */
+    tls_connect(&client_conf, &server_conf, SERVER_NAME, &hs);
+    before = *tls_session_get_stats();
+    tls_connect(&client_conf, &server_conf, "wem-other", &hs);
+    /* the name isn't in the certificate */
+    CHECK(0 != hs.ret);
+    CHECK(before.resumed == tls_session_get_stats()->resumed);
+    CHECK(before.failed + 1 == tls_session_get_stats()->failed);
+
+    mbedtls_ssl_ticket_free(&ticket);
+    mbedtls_ssl_cache_free(&cache);
+    mbedtls_ssl_config_free(&plain_conf);
+    mbedtls_ssl_config_free(&server_conf);
+    mbedtls_ssl_config_free(&client_conf);
+}
+
+int main()
+{
+    FILE *urandom = fopen("/dev/urandom", "rb");
+
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&drbg);
+    CHECK(NULL != urandom);
+    CHECK(0 == mbedtls_entropy_add_source(&entropy, urandom_poll, urandom, 32,
+                                          MBEDTLS_ENTROPY_SOURCE_STRONG));
+    CHECK(0 == mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+                                     NULL, 0));
+    CHECK(peer_init(&server, "CN=" SERVER_NAME));
+    CHECK(peer_init(&device, "CN=wem-device"));
+
+    if (0 == host_test_failures) {
+        test_resume();
+    }
+
+    return host_test_result("test_tls");
+}
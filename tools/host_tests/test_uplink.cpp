@@ -0,0 +1,157 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * UplinkQueue packs the oldest readings, keeps those of the pack in flight
+ * when it fills up, and only removes them on their own delivery report,
+ * not on the late report of a pack it gave up on.
+ */
+
+#include "host_test.h"
+#include "uplink.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PACK_SAMPLES 16
+
+static char pack[1024];
+
+static void push(UplinkQueue &q, uint32_t first, uint32_t count)
+{
+    for (uint32_t t = first; t < first + count; t++) {
+        q.push("3303/0/5700", t, (int32_t)t, 1);
+    }
+}
+
+/* the time of the oldest reading, from the first "t" of a pack */
+static uint32_t oldest(UplinkQueue &q, uint32_t now)
+{
+    size_t count;
+    const char *t;
+
+    if (0 == q.pack(pack, sizeof(pack), now, 1, &count)) {
+        return 0xFFFFFFFF;
+    }
+    t = strstr(pack, "\"t\":-");
+    return NULL == t ? 0xFFFFFFFF : now - strtoul(t + 5, NULL, 10);
+}
+
+static void test_pack(void)
+{
+    size_t len;
+    size_t count;
+    UplinkQueue q;
+
+    CHECK(0 == q.pack(pack, sizeof(pack), 100, PACK_SAMPLES, &count));
+    CHECK(0 == count);
+
+    q.push("3303/0/5700", 88, 234, 1);
+    q.push("3304/0/5700", 95, 41, 0);
+    len = q.pack(pack, sizeof(pack), 400, PACK_SAMPLES, &count);
+    CHECK(2 == count);
+    CHECK(len == strlen(pack));
+    CHECK(0 == strcmp(pack, "[{\"n\":\"3303/0/5700\",\"v\":23.4,\"t\":-312},"
+                            "{\"n\":\"3304/0/5700\",\"v\":41,\"t\":-305}]"));
+
+    /* a pack that doesn't fit takes the readings that do */
+    len = q.pack(pack, 50, 400, PACK_SAMPLES, &count);
+    CHECK(1 == count);
+    CHECK(len < 50 && ']' == pack[len - 1]);
+    CHECK(2 == q.depth());
+}
+
+static void test_overflow(void)
+{
+    size_t count;
+    UplinkQueue q;
+
+    /* nothing in flight, the oldest go */
+    push(q, 0, UPLINK_QUEUE_SAMPLES + 44);
+    CHECK(UPLINK_QUEUE_SAMPLES == q.depth());
+    CHECK(44 == q.dropped());
+    CHECK(44 == oldest(q, 1000));
+
+    /* the readings in flight stay, the new ones go */
+    q.pack(pack, sizeof(pack), 1000, PACK_SAMPLES, &count);
+    q.sent(count);
+    push(q, 1000, 10);
+    CHECK(54 == q.dropped());
+    CHECK(44 == oldest(q, 2000));
+    CHECK(q.report(true));
+    CHECK(UPLINK_QUEUE_SAMPLES - PACK_SAMPLES == q.depth());
+    CHECK(44 + PACK_SAMPLES == oldest(q, 2000));
+
+    /* and once it is delivered, the oldest go again */
+    push(q, 2000, PACK_SAMPLES + 1);
+    CHECK(UPLINK_QUEUE_SAMPLES == q.depth());
+    CHECK(45 + PACK_SAMPLES == oldest(q, 3000));
+}
+
+static void test_reports(void)
+{
+    UplinkQueue q;
+
+    /* nothing in flight */
+    CHECK(!q.report(true));
+
+    /* a failed pack stays queued */
+    push(q, 0, 10);
+    q.sent(10);
+    CHECK(q.report(false));
+    CHECK(10 == q.depth());
+    CHECK(0 == q.in_flight());
+    CHECK(!q.report(true));
+    CHECK(10 == q.depth());
+
+    /* the late report of an expired pack of 10 doesn't take the 16 of
+     * the next one */
+    q.sent(10);
+    q.expire();
+    push(q, 10, 6);
+    q.sent(16);
+    CHECK(!q.report(true));
+    CHECK(16 == q.depth());
+    CHECK(16 == q.in_flight());
+    CHECK(q.report(true));
+    CHECK(0 == q.depth());
+    CHECK(16 == q.drained());
+
+    /* a report that never comes costs a resend, not readings: the report
+     * of the second pack is taken for the lost one, the second pack
+     * expires and the third is matched again */
+    push(q, 100, 10);
+    q.sent(10);
+    q.expire();
+    q.sent(10);
+    CHECK(!q.report(true));
+    CHECK(10 == q.depth());
+    q.expire();
+    q.sent(10);
+    CHECK(!q.report(true));
+    CHECK(10 == q.depth());
+    CHECK(q.report(true));
+    CHECK(0 == q.depth());
+}
+
+int main()
+{
+    test_pack();
+    test_overflow();
+    test_reports();
+
+    return host_test_result("test_uplink");
+}
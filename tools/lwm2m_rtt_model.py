@@ -0,0 +1,626 @@
+#!/usr/bin/env python3
+"""
+mbed tools
+Copyright (c) 2018 ARM Limited
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# Protocol-level model of the cloud path, between a minimal LwM2M server and
+# an emulated device: how many round trips each exchange takes, and how long
+# it takes under an emulated round trip time.
+#
+# The server accepts registrations, updates and deregistrations on /rd,
+# observes resources and pushes a firmware image block-wise to /5/0/0.  The
+# device registers the resources of m2m_schema in m2mclient.cpp, with the
+# same lifetime, binding and block size as the firmware, answers GET and
+# PUT, and sends notifications.  Both speak CoAP over TCP (RFC 8323), as the
+# firmware is configured to, or over UDP (RFC 7252) with confirmable
+# messages, one outstanding at a time.  An optional delay line adds a round
+# trip time.
+#
+# The device is emulated because M2MClient needs mbed-cloud-client, which
+# only builds for mbed OS targets.  The times are those of Python on the
+# host plus the emulated delay, not those of the device or its network, so
+# only the round trips carry over.
+
+import argparse
+import os
+import queue
+import random
+import re
+import socket
+import statistics
+import struct
+import sys
+import threading
+import time
+
+# message types, UDP only
+CON, NON, ACK, RST = 0, 1, 2, 3
+
+# codes
+EMPTY = 0x00
+GET, POST, PUT, DELETE = 0x01, 0x02, 0x03, 0x04
+CREATED, DELETED, CHANGED, CONTENT = 0x41, 0x42, 0x44, 0x45
+CONTINUE = 0x5f
+NOT_FOUND, NOT_ALLOWED = 0x84, 0x85
+CSM = 0xe1
+
+# options
+OBSERVE = 6
+LOCATION_PATH = 8
+URI_PATH = 11
+CONTENT_FORMAT = 12
+URI_QUERY = 15
+BLOCK1 = 27
+
+LINK_FORMAT = 40
+TEXT_PLAIN = 0
+
+def uint_opt(value):
+    return value.to_bytes((value.bit_length() + 7) // 8, 'big')
+
+def opt_uint(data):
+    return int.from_bytes(data, 'big')
+
+def block_opt(num, more, size):
+    szx = size.bit_length() - 5
+    return uint_opt(num << 4 | (8 if more else 0) | szx)
+
+def opt_block(data):
+    value = opt_uint(data)
+    return value >> 4, bool(value & 8), 1 << ((value & 7) + 4)
+
+class Message(object):
+    def __init__(self, code, options=None, payload=b'', token=b'',
+                 mtype=CON, mid=0):
+        self.code = code
+        self.options = options or []
+        self.payload = payload
+        self.token = token
+        self.mtype = mtype
+        self.mid = mid
+
+    def opts(self, num):
+        return [v for n, v in self.options if n == num]
+
+    def opt(self, num):
+        values = self.opts(num)
+        return values[0] if values else None
+
+    def path(self):
+        return '/'.join(v.decode() for v in self.opts(URI_PATH))
+
+    def is_request(self):
+        return 0 < self.code < 0x20
+
+    def is_signal(self):
+        return self.code >= 0xe0
+
+def path_opts(path):
+    return [(URI_PATH, p.encode()) for p in path.strip('/').split('/')]
+
+def nibble(n):
+    if n < 13:
+        return n, b''
+    if n < 269:
+        return 13, bytes([n - 13])
+    return 14, struct.pack('!H', n - 269)
+
+def encode_options(options):
+    out = bytearray()
+    last = 0
+    # a stable sort keeps repeated options in order
+    for num, value in sorted(options, key=lambda o: o[0]):
+        delta, dext = nibble(num - last)
+        length, lext = nibble(len(value))
+        out.append(delta << 4 | length)
+        out += dext + lext + value
+        last = num
+    return bytes(out)
+
+def decode_options(data):
+    options = []
+    num = 0
+    i = 0
+    while i < len(data) and data[i] != 0xff:
+        delta, length = data[i] >> 4, data[i] & 15
+        i += 1
+        values = []
+        for n in (delta, length):
+            if n == 13:
+                n = data[i] + 13
+                i += 1
+            elif n == 14:
+                n = struct.unpack('!H', data[i:i + 2])[0] + 269
+                i += 2
+            values.append(n)
+        num += values[0]
+        options.append((num, bytes(data[i:i + values[1]])))
+        i += values[1]
+    payload = bytes(data[i + 1:]) if i < len(data) else b''
+    return options, payload
+
+def encode_body(msg):
+    body = encode_options(msg.options)
+    if msg.payload:
+        body += b'\xff' + msg.payload
+    return body
+
+def encode_udp(msg):
+    return (struct.pack('!BBH', 0x40 | msg.mtype << 4 | len(msg.token),
+                        msg.code, msg.mid) + msg.token + encode_body(msg))
+
+def decode_udp(data):
+    tkl = data[0] & 15
+    msg = Message(data[1], token=bytes(data[4:4 + tkl]),
+                  mtype=data[0] >> 4 & 3,
+                  mid=struct.unpack('!H', data[2:4])[0])
+    msg.options, msg.payload = decode_options(data[4 + tkl:])
+    return msg
+
+def encode_tcp(msg):
+    body = encode_body(msg)
+    length, ext = nibble(len(body))
+    if len(body) >= 65805:
+        length, ext = 15, struct.pack('!I', len(body) - 65805)
+    elif len(body) >= 269:
+        length, ext = 14, struct.pack('!H', len(body) - 269)
+    return (bytes([length << 4 | len(msg.token)]) + ext +
+            bytes([msg.code]) + msg.token + body)
+
+class UdpLink(object):
+    reliable = False
+
+    def __init__(self, sock, peer=None):
+        self.sock = sock
+        self.peer = peer
+
+    def send(self, msg):
+        self.sock.sendto(encode_udp(msg), self.peer)
+
+    def recv(self):
+        data, self.peer = self.sock.recvfrom(65536)
+        return decode_udp(data)
+
+class TcpLink(object):
+    reliable = True
+
+    def __init__(self, sock):
+        self.sock = sock
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.lock = threading.Lock()
+
+    def send(self, msg):
+        with self.lock:
+            self.sock.sendall(encode_tcp(msg))
+
+    def read(self, n):
+        data = b''
+        while len(data) < n:
+            chunk = self.sock.recv(n - len(data))
+            if not chunk:
+                raise EOFError
+            data += chunk
+        return data
+
+    def recv(self):
+        first = self.read(1)[0]
+        length, tkl = first >> 4, first & 15
+        if length == 13:
+            length = self.read(1)[0] + 13
+        elif length == 14:
+            length = struct.unpack('!H', self.read(2))[0] + 269
+        elif length == 15:
+            length = struct.unpack('!I', self.read(4))[0] + 65805
+        code = self.read(1)[0]
+        token = self.read(tkl)
+        options, payload = decode_options(self.read(length))
+        return Message(code, options, payload, token)
+
+class DelayLink(object):
+    """delivers every message a fixed time after it was sent"""
+
+    def __init__(self, link, delay):
+        self.link = link
+        self.reliable = link.reliable
+        self.delay = delay
+        self.queue = queue.Queue()
+        t = threading.Thread(target=self.run)
+        t.daemon = True
+        t.start()
+
+    def send(self, msg):
+        self.queue.put((time.perf_counter() + self.delay, msg))
+
+    def recv(self):
+        return self.link.recv()
+
+    def run(self):
+        while True:
+            due, msg = self.queue.get()
+            wait = due - time.perf_counter()
+            if wait > 0:
+                time.sleep(wait)
+            self.link.send(msg)
+
+class Endpoint(object):
+    """
+    one end of a CoAP connection, which both sends and serves requests.
+    a receive thread serves requests and hands responses to the waiting
+    requester.
+    """
+
+    def __init__(self, link, on_request, on_notify=None):
+        self.link = link
+        self.on_request = on_request
+        self.on_notify = on_notify
+        self.mid = random.randint(0, 0xffff)
+        self.token = random.randint(0, 0xffffffff)
+        self.pending = {}
+        self.round_trips = 0
+        self.lock = threading.Lock()
+        t = threading.Thread(target=self.run)
+        t.daemon = True
+        t.start()
+        if link.reliable:
+            link.send(Message(CSM))
+
+    def next_mid(self):
+        with self.lock:
+            self.mid = (self.mid + 1) & 0xffff
+            return self.mid
+
+    def next_token(self):
+        with self.lock:
+            self.token = (self.token + 1) & 0xffffffff
+            return struct.pack('!I', self.token)
+
+    def wait_for(self, key, msg, timeout):
+        q = queue.Queue()
+        self.pending[key] = q
+        self.round_trips += 1
+        self.link.send(msg)
+        try:
+            return q.get(timeout=timeout)
+        finally:
+            self.pending.pop(key, None)
+
+    def request(self, msg, timeout=10.0):
+        msg.token = self.next_token()
+        msg.mtype = CON
+        msg.mid = self.next_mid()
+        return self.wait_for(('token', msg.token), msg, timeout)
+
+    def notify(self, token, seq, payload, timeout=10.0):
+        msg = Message(CONTENT, [(OBSERVE, uint_opt(seq & 0xffffff)),
+                                (CONTENT_FORMAT, uint_opt(TEXT_PLAIN))],
+                      payload, token, CON, self.next_mid())
+        if self.link.reliable:
+            self.link.send(msg)
+        else:
+            # confirmable, one at a time
+            self.wait_for(('ack', msg.mid), msg, timeout)
+
+    def run(self):
+        while True:
+            try:
+                msg = self.link.recv()
+            except (OSError, EOFError):
+                return
+            if msg.is_signal():
+                continue
+            if msg.code == EMPTY:
+                q = self.pending.pop(('ack', msg.mid), None)
+                if q:
+                    q.put(msg)
+                continue
+            if msg.is_request():
+                resp = self.on_request(msg)
+                resp.token = msg.token
+                if not self.link.reliable:
+                    resp.mtype = ACK if msg.mtype == CON else NON
+                    resp.mid = msg.mid if msg.mtype == CON else self.next_mid()
+                self.link.send(resp)
+                continue
+            if not self.link.reliable and msg.mtype == CON:
+                self.link.send(Message(EMPTY, mtype=ACK, mid=msg.mid))
+            q = self.pending.pop(('token', msg.token), None)
+            if q:
+                q.put(msg)
+            elif self.on_notify:
+                self.on_notify(msg)
+
+def parse_schema(fname, defines):
+    """
+    returns the (path, observable, value) rows of m2m_schema, with the
+    rows under #if included only if their macro is in defines
+    """
+    rows = []
+    text = open(fname).read()
+    start = text.index('m2m_schema[]')
+    text = text[start:text.index('};', start)]
+    row = re.compile(r'\{"(\d+)",\s*(\d+),\s*"(\d+)",\s*"[^"]*",\s*'
+                     r'M2MResourceInstance::\w+,\s*M2MBase::\w+,\s*'
+                     r'(true|false),\s*M2MClient::\w+,\s*'
+                     r'(NULL|"[^"]*"|\w+)\}', re.S)
+    # rows span lines, so match them on the text and look up the
+    # conditions in effect at their start
+    events = []
+    for m in re.finditer(r'^\s*#(if|endif).*$', text, re.M):
+        events.append((m.start(), m.group(0).strip()))
+    for m in row.finditer(text):
+        active = []
+        for at, directive in events:
+            if at > m.start():
+                break
+            if directive.startswith('#if'):
+                macro = re.findall(r'[A-Z_][A-Z0-9_]+', directive[3:])
+                active.append(bool(macro) and macro[0] in defines)
+            else:
+                active.pop()
+        if all(active):
+            value = m.group(5)
+            value = value.strip('"') if value.startswith('"') else ''
+            rows.append(('/%s/%s/%s' % (m.group(1), m.group(2), m.group(3)),
+                         m.group(4) == 'true', value))
+    return rows
+
+class Device(object):
+    def __init__(self, link, schema, block_size, lifetime):
+        self.values = dict((p, v.encode()) for p, _, v in schema)
+        self.observable = set(p for p, obs, _ in schema if obs)
+        self.links = ','.join('<%s>%s' % (p, ';obs' if obs else '')
+                              for p, obs, _ in schema).encode()
+        self.block_size = block_size
+        self.lifetime = lifetime
+        self.observers = {}
+        self.firmware = bytearray()
+        self.firmware_done = threading.Event()
+        self.location = None
+        self.ep = Endpoint(link, self.on_request)
+
+    def on_request(self, msg):
+        path = '/' + msg.path()
+        if msg.code == GET and path in self.values:
+            options = [(CONTENT_FORMAT, uint_opt(TEXT_PLAIN))]
+            if msg.opt(OBSERVE) is not None and path in self.observable:
+                self.observers[path] = [msg.token, 0]
+                options.append((OBSERVE, uint_opt(0)))
+            return Message(CONTENT, options, self.values[path])
+        if msg.code == PUT and path == '/5/0/0':
+            num, more, size = opt_block(msg.opt(BLOCK1))
+            if num == 0:
+                self.firmware = bytearray()
+                self.firmware_done.clear()
+            self.firmware += msg.payload
+            if more:
+                return Message(CONTINUE, [(BLOCK1, msg.opt(BLOCK1))])
+            self.firmware_done.set()
+            return Message(CHANGED, [(BLOCK1, msg.opt(BLOCK1))])
+        if msg.code == PUT and path in self.values:
+            self.values[path] = msg.payload
+            return Message(CHANGED)
+        if path in self.values:
+            return Message(NOT_ALLOWED)
+        return Message(NOT_FOUND)
+
+    def register(self):
+        """registers, sending the links in blocks, returns the blocks"""
+        query = [(URI_QUERY, b'ep=wem-bench'),
+                 (URI_QUERY, ('lt=%d' % self.lifetime).encode()),
+                 (URI_QUERY, b'b=T' if self.ep.link.reliable else b'b=U')]
+        blocks = [self.links[i:i + self.block_size]
+                  for i in range(0, len(self.links), self.block_size)]
+        for num, block in enumerate(blocks):
+            more = num < len(blocks) - 1
+            options = path_opts('rd') + query + [
+                (CONTENT_FORMAT, uint_opt(LINK_FORMAT))]
+            if len(blocks) > 1:
+                options.append((BLOCK1, block_opt(num, more, self.block_size)))
+            resp = self.ep.request(Message(POST, options, block))
+            expected = CONTINUE if more else CREATED
+            if resp.code != expected:
+                sys.exit('ERROR: registration failed with %x' % resp.code)
+        self.location = '/'.join(v.decode() for v in resp.opts(LOCATION_PATH))
+        return len(blocks)
+
+    def update(self):
+        resp = self.ep.request(Message(POST, path_opts(self.location)))
+        if resp.code != CHANGED:
+            sys.exit('ERROR: update failed with %x' % resp.code)
+
+    def deregister(self):
+        self.ep.request(Message(DELETE, path_opts(self.location)))
+
+    def notify(self, path, value):
+        token, seq = self.observers[path]
+        self.observers[path][1] = seq + 1
+        self.values[path] = value
+        self.ep.notify(token, seq + 1, value)
+
+class Server(object):
+    def __init__(self, link):
+        self.registrations = {}
+        self.uploads = {}
+        self.notifications = 0
+        self.lock = threading.Lock()
+        self.ep = Endpoint(link, self.on_request, self.on_notify)
+
+    def on_request(self, msg):
+        path = msg.path().split('/')
+        if msg.code == POST and path == ['rd']:
+            block = msg.opt(BLOCK1)
+            num, more, _ = opt_block(block) if block is not None else (0, False, 0)
+            if num == 0:
+                self.uploads[msg.token] = b''
+            self.uploads[msg.token] = self.uploads.get(msg.token, b'') + msg.payload
+            if more:
+                return Message(CONTINUE, [(BLOCK1, block)])
+            links = self.uploads.pop(msg.token)
+            reg = '%x' % random.getrandbits(32)
+            self.registrations[reg] = links
+            return Message(CREATED, [(LOCATION_PATH, b'rd'),
+                                     (LOCATION_PATH, reg.encode())])
+        if len(path) == 2 and path[0] == 'rd' and path[1] in self.registrations:
+            if msg.code == POST:
+                return Message(CHANGED)
+            if msg.code == DELETE:
+                del self.registrations[path[1]]
+                return Message(DELETED)
+        return Message(NOT_FOUND)
+
+    def on_notify(self, msg):
+        with self.lock:
+            self.notifications += 1
+
+    def observe(self, path):
+        resp = self.ep.request(Message(GET, path_opts(path) +
+                                       [(OBSERVE, uint_opt(0))]))
+        return resp.code == CONTENT
+
+    def push_firmware(self, image, block_size):
+        blocks = (len(image) + block_size - 1) // block_size
+        for num in range(blocks):
+            more = num < blocks - 1
+            resp = self.ep.request(Message(
+                PUT, path_opts('5/0/0') +
+                [(BLOCK1, block_opt(num, more, block_size))],
+                image[num * block_size:(num + 1) * block_size]))
+            if resp.code != (CONTINUE if more else CHANGED):
+                sys.exit('ERROR: firmware block %d failed with %x' %
+                         (num, resp.code))
+        return blocks
+
+def connect(transport, rtt):
+    """returns the server and device links, over loopback"""
+    if transport == 'tcp':
+        listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        listener.bind(('127.0.0.1', 0))
+        listener.listen(1)
+        device = socket.create_connection(listener.getsockname())
+        server, _ = listener.accept()
+        listener.close()
+        links = [TcpLink(server), TcpLink(device)]
+    else:
+        server = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        server.bind(('127.0.0.1', 0))
+        device = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        device.bind(('127.0.0.1', 0))
+        links = [UdpLink(server, device.getsockname()),
+                 UdpLink(device, server.getsockname())]
+    if rtt > 0:
+        links = [DelayLink(l, rtt / 2000.0) for l in links]
+    return links
+
+def ms(values):
+    values = sorted(values)
+    return 'median %.2f ms, p90 %.2f ms' % (
+        statistics.median(values) * 1000,
+        values[int(len(values) * 0.9)] * 1000)
+
+def trips(n):
+    return '%d round trip%s' % (n, '' if n == 1 else 's')
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(
+        description='Count the round trips of registration, notifications '
+                    'and firmware download against a local LwM2M server, '
+                    'and time them under an emulated round trip time.')
+    parser.add_argument('--schema', default=os.path.join(here, '..',
+                                                         'm2mclient.cpp'),
+                        help='source of m2m_schema')
+    parser.add_argument('-D', dest='defines', action='append', default=[],
+                        help='macro enabling #if rows of the schema, '
+                             'ie MBED_CONF_APP_SOUND_ENABLED')
+    parser.add_argument('--transport', choices=['tcp', 'udp'], default='tcp')
+    parser.add_argument('--rtt', type=float, default=0.0,
+                        help='round trip time to emulate, in ms')
+    parser.add_argument('--block', type=int, default=512,
+                        help='block size, SN_COAP_MAX_BLOCKWISE_PAYLOAD_SIZE')
+    parser.add_argument('--lifetime', type=int, default=90)
+    parser.add_argument('-n', type=int, default=50,
+                        help='registrations and updates to time')
+    parser.add_argument('--firmware', type=int, default=256 * 1024,
+                        help='size of the firmware image, in bytes')
+    args = parser.parse_args()
+
+    schema = parse_schema(args.schema, set(args.defines))
+    server_link, device_link = connect(args.transport, args.rtt)
+    server = Server(server_link)
+    device = Device(device_link, schema, args.block, args.lifetime)
+    print('transport=%s rtt=%g ms block=%d B' %
+          (args.transport, args.rtt, args.block))
+
+    # registration, as after every reboot or expired registration
+    times = []
+    for i in range(args.n):
+        start = time.perf_counter()
+        before = device.ep.round_trips
+        device.register()
+        times.append(time.perf_counter() - start)
+        count = device.ep.round_trips - before
+        if i < args.n - 1:
+            device.deregister()
+    print('registration: %d resources, %d B of links, %s, %s' %
+          (len(schema), len(device.links), trips(count), ms(times)))
+
+    # registration update, as sent by the keep-alive and on resume
+    times = []
+    for i in range(args.n):
+        start = time.perf_counter()
+        before = device.ep.round_trips
+        device.update()
+        times.append(time.perf_counter() - start)
+        count = device.ep.round_trips - before
+    print('update: %s, %s' % (trips(count), ms(times)))
+
+    # observations, as the portal sets them up
+    start = time.perf_counter()
+    before = server.ep.round_trips
+    observed = [p for p, obs, _ in schema if obs and server.observe(p)]
+    print('observe: %d resources, %s, %.1f ms' %
+          (len(observed), trips(server.ep.round_trips - before),
+           (time.perf_counter() - start) * 1000))
+
+    # one notification of a sensor-sized value per observed resource, the
+    # time taken once the last one arrived
+    start = time.perf_counter()
+    before = device.ep.round_trips
+    for path in observed:
+        device.notify(path, ('%.2f' % random.uniform(0, 1000)).encode())
+    deadline = time.perf_counter() + 5 + args.rtt / 1000.0
+    while (server.notifications < len(observed) and
+           time.perf_counter() < deadline):
+        time.sleep(0.001)
+    if server.notifications < len(observed):
+        sys.exit('ERROR: %d of %d notifications arrived' %
+                 (server.notifications, len(observed)))
+    print('notify: %d values, %s, %.1f ms' %
+          (len(observed), trips(device.ep.round_trips - before),
+           (time.perf_counter() - start) * 1000))
+
+    # firmware download to the device
+    image = os.urandom(args.firmware)
+    start = time.perf_counter()
+    before = server.ep.round_trips
+    blocks = server.push_firmware(image, args.block)
+    device.firmware_done.wait(5)
+    elapsed = time.perf_counter() - start
+    if bytes(device.firmware) != image:
+        sys.exit('ERROR: firmware image corrupted')
+    print('firmware: %d B in %d blocks, %s, %.2f s' %
+          (len(image), blocks, trips(server.ep.round_trips - before),
+           elapsed))
+
+if __name__ == '__main__':
+    main()
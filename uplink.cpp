@@ -0,0 +1,149 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uplink.h"
+#include "fixedfmt.h"
+
+#include <stdio.h>
+#include <string.h>
+
+UplinkQueue::UplinkQueue()
+    : _tail(0), _depth(0), _max_depth(0), _in_flight(0), _sent_seq(0),
+      _reported_seq(0), _queued(0), _dropped(0), _drained(0)
+{
+    memset(_ring, 0, sizeof(_ring));
+}
+
+void UplinkQueue::push(const char *name, uint32_t time, int32_t value,
+                       uint8_t precision)
+{
+    struct reading *r;
+
+    if (UPLINK_QUEUE_SAMPLES == _depth) {
+        /* a reading in flight may be delivered yet, keep it */
+        if (_in_flight > 0) {
+            _dropped++;
+            return;
+        }
+        /* overwrite the oldest reading */
+        _tail = (_tail + 1) % UPLINK_QUEUE_SAMPLES;
+        _depth--;
+        _dropped++;
+    }
+
+    r = &_ring[(_tail + _depth) % UPLINK_QUEUE_SAMPLES];
+    r->name = name;
+    r->time = time;
+    r->value = value;
+    r->precision = precision;
+
+    _depth++;
+    _queued++;
+    if (_depth > _max_depth) {
+        _max_depth = _depth;
+    }
+}
+
+size_t UplinkQueue::pack(char *buf, size_t size, uint32_t now, size_t max,
+                         size_t *count)
+{
+    int ret;
+    size_t i;
+    size_t len;
+    char value[FIXED_STRLEN];
+    struct reading *r;
+
+    *count = 0;
+    if (0 == _depth || size < 3) {
+        return 0;
+    }
+
+    len = 0;
+    buf[len++] = '[';
+    for (i = 0; i < _depth && i < max; i++) {
+        r = &_ring[(_tail + i) % UPLINK_QUEUE_SAMPLES];
+
+        fixed_format(value, sizeof(value), r->value, r->precision);
+        ret = snprintf(&buf[len], size - len,
+                       "%s{\"n\":\"%s\",\"v\":%s,\"t\":-%lu}",
+                       i > 0 ? "," : "", r->name, value,
+                       (unsigned long)(now - r->time));
+        /* leave room for the closing bracket */
+        if (ret < 0 || (size_t)ret >= size - len - 1) {
+            break;
+        }
+        len += ret;
+    }
+
+    if (0 == i) {
+        return 0;
+    }
+
+    buf[len++] = ']';
+    buf[len] = '\0';
+    *count = i;
+
+    return len;
+}
+
+void UplinkQueue::pop(size_t count)
+{
+    if (count > _depth) {
+        count = _depth;
+    }
+
+    _tail = (_tail + count) % UPLINK_QUEUE_SAMPLES;
+    _depth -= count;
+    _drained += count;
+    _in_flight = _in_flight > count ? _in_flight - count : 0;
+}
+
+void UplinkQueue::sent(size_t count)
+{
+    _in_flight = count < _depth ? count : _depth;
+    _sent_seq++;
+}
+
+bool UplinkQueue::report(bool delivered)
+{
+    /* no pack is waiting for a report */
+    if (_reported_seq == _sent_seq) {
+        return false;
+    }
+
+    _reported_seq++;
+    if (_reported_seq != _sent_seq || 0 == _in_flight) {
+        return false;
+    }
+
+    if (delivered) {
+        pop(_in_flight);
+    }
+    _in_flight = 0;
+
+    return true;
+}
+
+void UplinkQueue::expire()
+{
+    if (0 == _in_flight) {
+        return;
+    }
+
+    /* only this pack may still be reported */
+    _reported_seq = _sent_seq - 1;
+    _in_flight = 0;
+}
@@ -0,0 +1,165 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2018 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* number of readings buffered while the cloud is unreachable */
+#ifndef UPLINK_QUEUE_SAMPLES
+#define UPLINK_QUEUE_SAMPLES 256
+#endif
+
+/*
+    class: UplinkQueue
+
+    store-and-forward buffer for sensor readings
+
+    readings that could not be sent because the client was not registered
+    are timestamped and queued here.  once the client is registered again
+    the backlog is drained, oldest first, as SenML JSON packs.  when the
+    queue is full the oldest reading is dropped, unless it is in flight,
+    and then the new reading is.
+
+    one pack is in flight at a time, and its readings stay queued until
+    the report of its delivery.  reports don't say which notification they
+    are about, so packs are numbered and reports are matched to them in
+    order.  a pack given up on with expire() may still be reported, and
+    the next report is taken as its own and ignored: if it was in fact
+    that of the next pack, that pack expires in turn and is sent again.
+
+    timestamps are seconds since boot.  packs use SenML relative time, so a
+    reading's "t" is the (negative) number of seconds between when it was
+    taken and when the pack was built.
+*/
+class UplinkQueue
+{
+public:
+    UplinkQueue();
+
+    /*
+        Function: push
+
+        queues a reading
+
+        Params:
+        const char *name - SenML name, usually the resource path.  must
+                           outlive the queue.
+        uint32_t time    - seconds since boot
+        int32_t value    - the value, scaled by 10^precision
+        uint8_t precision - number of decimal places in value
+    */
+    void push(const char *name, uint32_t time, int32_t value,
+              uint8_t precision);
+
+    /*
+        Function: pack
+
+        formats the oldest queued readings as a SenML JSON array.  the
+        readings stay queued until pop() is called.
+
+        Params:
+        char *buf      - output buffer
+        size_t size    - size of buf
+        uint32_t now   - current time in seconds since boot
+        size_t max     - maximum number of readings to pack
+        size_t *count  - set to the number of readings packed
+
+        Returns:
+        the length of the pack, 0 if nothing was packed
+    */
+    size_t pack(char *buf, size_t size, uint32_t now, size_t max,
+                size_t *count);
+
+    /*
+        Function: pop
+
+        removes the oldest readings, normally after they were packed
+    */
+    void pop(size_t count);
+
+    /*
+        Function: sent
+
+        marks the oldest readings as the pack in flight, normally those
+        just packed.  they are neither dropped nor sent again until the
+        pack is reported or expired.
+    */
+    void sent(size_t count);
+
+    /*
+        Function: report
+
+        takes the next delivery report, and removes the readings of the
+        pack in flight if the report is its own and says it was delivered
+
+        Returns:
+        true if the report was that of the pack in flight
+    */
+    bool report(bool delivered);
+
+    /*
+        Function: expire
+
+        gives up on the pack in flight, whose readings are sent again
+    */
+    void expire();
+
+    /* number of readings in flight, 0 if no pack is */
+    size_t in_flight() const { return _in_flight; }
+
+    /* number of readings currently queued */
+    size_t depth() const { return _depth; }
+
+    /* highest depth seen since boot */
+    size_t max_depth() const { return _max_depth; }
+
+    /* total number of readings queued since boot */
+    uint32_t queued() const { return _queued; }
+
+    /* number of readings dropped because the queue was full */
+    uint32_t dropped() const { return _dropped; }
+
+    /* number of readings popped after being sent */
+    uint32_t drained() const { return _drained; }
+
+private:
+    struct reading {
+        const char *name;
+        uint32_t time;
+        int32_t value;
+        uint8_t precision;
+    };
+
+    struct reading _ring[UPLINK_QUEUE_SAMPLES];
+    /* index of the oldest reading */
+    size_t _tail;
+    size_t _depth;
+    size_t _max_depth;
+    /* readings of the pack in flight, at the tail */
+    size_t _in_flight;
+    /* number of the last pack sent, and of the last one reported */
+    uint32_t _sent_seq;
+    uint32_t _reported_seq;
+
+    uint32_t _queued;
+    uint32_t _dropped;
+    uint32_t _drained;
+};
+
+#endif /* UPLINK_H */